@@ -0,0 +1,212 @@
+#ifndef BenchmarkUtils_hxx
+    #define BenchmarkUtils_hxx
+
+    #include <algorithm>
+    #include <chrono>
+    #include <cmath>
+    #include <cstddef>
+    #include <ostream>
+    #include <random>
+    #include <sstream>
+    #include <stdexcept>
+    #include <string>
+    #include <utility>
+    #include <vector>
+
+    #include "Point.hxx"
+
+    namespace Benchmarks
+    {
+        /**
+         * @brief Object stored in the benchmarked trees (the identifier makes operator== cheap and exact)
+         *
+         */
+        struct Object
+        {
+            std::size_t id;
+            [[nodiscard]] bool operator==(const Object &other) const noexcept {return id == other.id;}
+        };
+
+        template <std::size_t Dims> using BenchPoint = JJDataStruct::KDTree::Point<Object,double,Dims>;
+
+        /**
+         * @brief Wall-clock time of a code section in nanoseconds
+         *
+         */
+        class Stopwatch
+        {
+            private:
+                std::chrono::steady_clock::time_point m_start;
+
+            public:
+                Stopwatch() : m_start(std::chrono::steady_clock::now()) {}
+                void Restart() noexcept {m_start = std::chrono::steady_clock::now();}
+                [[nodiscard]] double Nanoseconds() const noexcept
+                {
+                    return std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now() - m_start).count();
+                }
+        };
+
+        /**
+         * @brief Summary of the latencies of many calls of one operation
+         *
+         */
+        struct Latencies
+        {
+            double mean, p50, p90, p99, max;
+
+            [[nodiscard]] static Latencies From(std::vector<double> samples)
+            {
+                if (samples.empty())
+                    return {0.,0.,0.,0.,0.};
+
+                std::sort(samples.begin(),samples.end());
+                auto percentile = [&samples](double fraction)
+                {
+                    return samples[static_cast<std::size_t>(fraction * static_cast<double>(samples.size() - 1))];
+                };
+                double sum = 0.;
+                for (double sample : samples)
+                    sum += sample;
+
+                return {sum / static_cast<double>(samples.size()),percentile(0.5),percentile(0.9),percentile(0.99),samples.back()};
+            }
+        };
+
+        /**
+         * @brief Flat JSON object written field by field (numbers and strings only)
+         *
+         */
+        class JsonRecord
+        {
+            private:
+                std::ostringstream m_stream;
+                bool m_empty;
+
+                void Key(const std::string &key)
+                {
+                    m_stream << (m_empty ? "{" : ",") << '"' << Escape(key) << "\":";
+                    m_empty = false;
+                }
+                /**
+                 * @brief Escape the quotes, backslashes and control characters of a string value (e.g. a distribution name given on the command line)
+                 *
+                 */
+                [[nodiscard]] static std::string Escape(const std::string &value)
+                {
+                    std::string escaped;
+                    for (const char c : value)
+                    {
+                        if (c == '"' || c == '\\')
+                        {
+                            escaped += '\\';
+                            escaped += c;
+                        }
+                        else if (static_cast<unsigned char>(c) < 0x20)
+                        {
+                            static constexpr char hex[] = "0123456789abcdef";
+                            escaped += "\\u00";
+                            escaped += hex[(c >> 4) & 0xf];
+                            escaped += hex[c & 0xf];
+                        }
+                        else
+                        {
+                            escaped += c;
+                        }
+                    }
+
+                    return escaped;
+                }
+
+            public:
+                JsonRecord() : m_stream(), m_empty(true) {}
+                JsonRecord& Add(const std::string &key, const std::string &value) {Key(key); m_stream << '"' << Escape(value) << '"'; return *this;}
+                JsonRecord& Add(const std::string &key, const char *value) {return Add(key,std::string(value));}
+                JsonRecord& Add(const std::string &key, double value) {Key(key); m_stream << (std::isfinite(value) ? value : 0.); return *this;}
+                JsonRecord& Add(const std::string &key, std::size_t value) {Key(key); m_stream << value; return *this;}
+                JsonRecord& Add(const std::string &key, const Latencies &latencies)
+                {
+                    Add(key + "_mean_ns",latencies.mean).Add(key + "_p50_ns",latencies.p50).Add(key + "_p90_ns",latencies.p90);
+                    return Add(key + "_p99_ns",latencies.p99).Add(key + "_max_ns",latencies.max);
+                }
+                [[nodiscard]] std::string str() const {return m_stream.str() + (m_empty ? "{}" : "}");}
+        };
+
+        /**
+         * @brief Generate n points of the given distribution: "uniform" in the unit cube, "clustered" around 16 random centres, or "vertex" (a narrow Gaussian across the beam axis, the last dimension, and a wide one along it)
+         *
+         * @throws std::runtime_error for an unknown distribution
+         */
+        template <std::size_t Dims>
+        [[nodiscard]] std::vector<BenchPoint<Dims> > Generate(const std::string &distribution, std::size_t n, std::size_t firstId, std::mt19937_64 &gen)
+        {
+            std::vector<BenchPoint<Dims> > points;
+            points.reserve(n);
+            if (distribution == "uniform")
+            {
+                std::uniform_real_distribution<double> coord(0.,1.);
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    BenchPoint<Dims> point{{firstId + i},{}};
+                    for (auto &x : point.coords)
+                        x = coord(gen);
+                    points.push_back(point);
+                }
+            }
+            else if (distribution == "clustered")
+            {
+                std::mt19937_64 centreGen(12345); // the same clusters for every batch of points
+                std::uniform_real_distribution<double> coord(0.,1.);
+                std::vector<std::array<double,Dims> > centres(16);
+                for (auto &centre : centres)
+                    for (auto &x : centre)
+                        x = coord(centreGen);
+
+                std::uniform_int_distribution<std::size_t> cluster(0,centres.size() - 1);
+                std::normal_distribution<double> offset(0.,0.02);
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    BenchPoint<Dims> point{{firstId + i},centres[cluster(gen)]};
+                    for (auto &x : point.coords)
+                        x += offset(gen);
+                    points.push_back(point);
+                }
+            }
+            else if (distribution == "vertex")
+            {
+                std::normal_distribution<double> transverse(0.,0.05), longitudinal(0.,5.);
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    BenchPoint<Dims> point{{firstId + i},{}};
+                    for (std::size_t dim = 0; dim + 1 < Dims; ++dim)
+                        point.coords[dim] = transverse(gen);
+                    point.coords[Dims - 1] = longitudinal(gen);
+                    points.push_back(point);
+                }
+            }
+            else
+            {
+                throw std::runtime_error("Generate - unknown distribution " + distribution);
+            }
+
+            return points;
+        }
+
+        /**
+         * @brief Split a comma separated list
+         *
+         */
+        [[nodiscard]] inline std::vector<std::string> SplitList(const std::string &list)
+        {
+            std::vector<std::string> items;
+            std::istringstream stream(list);
+            for (std::string item; std::getline(stream,item,',');)
+                if (!item.empty())
+                    items.push_back(item);
+
+            return items;
+        }
+
+    } // namespace Benchmarks
+
+#endif
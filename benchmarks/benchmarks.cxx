@@ -0,0 +1,282 @@
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#include "BenchmarkUtils.hxx"
+#include "DynamicKDTree.hxx"
+#include "KDTree.hxx"
+
+using namespace Benchmarks;
+using JJDataStruct::KDTree::KDTree;
+using JJDataStruct::KDTree::DynamicKDTree;
+using JJDataStruct::KDTree::SquaredDist;
+
+namespace
+{
+    /**
+     * @brief Parameters of a benchmark run, set on the command line as --name=value (lists are comma separated)
+     *
+     */
+    struct Options
+    {
+        std::vector<std::size_t> sizes = {10000, 100000, 1000000};
+        std::vector<std::size_t> dims = {2, 3, 6};
+        std::vector<std::size_t> bucketSizes = {8, 32, 128};
+        std::vector<std::string> distributions = {"uniform", "clustered", "vertex"};
+        std::size_t nQueries = 1000;
+        std::size_t k = 10;
+        std::size_t nUpdates = 10000;
+        std::size_t bruteForceLimit = 1000000; // the brute force reference is skipped for larger data sets
+        std::size_t nChecked = 100; // number of queries whose results are compared with the brute force reference
+        std::uint64_t seed = 42;
+        std::string output; // JSON goes to standard output if empty
+    };
+
+    std::vector<std::size_t> ParseSizes(const std::string &list)
+    {
+        std::vector<std::size_t> values;
+        for (const auto &item : SplitList(list))
+            values.push_back(static_cast<std::size_t>(std::stod(item))); // accepts 1e8
+
+        return values;
+    }
+
+    Options Parse(int argc, char **argv)
+    {
+        Options options;
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const auto equals = arg.find('=');
+            if (arg.rfind("--",0) != 0 || equals == std::string::npos)
+                throw std::runtime_error("unknown argument " + arg + " (expected --name=value)");
+
+            const std::string name = arg.substr(2,equals - 2), value = arg.substr(equals + 1);
+            if (name == "sizes") options.sizes = ParseSizes(value);
+            else if (name == "dims") options.dims = ParseSizes(value);
+            else if (name == "buckets") options.bucketSizes = ParseSizes(value);
+            else if (name == "distributions") options.distributions = SplitList(value);
+            else if (name == "queries") options.nQueries = ParseSizes(value).at(0);
+            else if (name == "k") options.k = ParseSizes(value).at(0);
+            else if (name == "updates") options.nUpdates = ParseSizes(value).at(0);
+            else if (name == "brute-force-limit") options.bruteForceLimit = ParseSizes(value).at(0);
+            else if (name == "checked") options.nChecked = ParseSizes(value).at(0);
+            else if (name == "seed") options.seed = std::stoull(value);
+            else if (name == "output") options.output = value;
+            else throw std::runtime_error("unknown option --" + name);
+        }
+
+        return options;
+    }
+
+    std::size_t g_sink = 0; // results are summed here, so the searches cannot be optimised away
+
+    /**
+     * @brief Time func(query) for every query
+     *
+     */
+    template <typename Queries, typename Func>
+    Latencies Measure(const Queries &queries, Func func)
+    {
+        std::vector<double> samples;
+        samples.reserve(queries.size());
+        Stopwatch stopwatch;
+        for (const auto &query : queries)
+        {
+            stopwatch.Restart();
+            g_sink += func(query);
+            samples.push_back(stopwatch.Nanoseconds());
+        }
+
+        return Latencies::From(std::move(samples));
+    }
+
+    /**
+     * @brief Distances of the k points nearest to query, in increasing order
+     *
+     */
+    template <typename Points, typename Query>
+    std::vector<double> SortedDistances(const Points &points, const Query &query, std::size_t k)
+    {
+        std::vector<double> distances;
+        distances.reserve(points.size());
+        for (const auto &point : points)
+            distances.push_back(SquaredDist::distance(point,query));
+        k = std::min(k,distances.size());
+        std::partial_sort(distances.begin(),distances.begin() + static_cast<std::ptrdiff_t>(k),distances.end());
+        distances.resize(k);
+
+        return distances;
+    }
+
+    template <std::size_t Dims>
+    void Run(const Options &options, const std::string &distribution, std::size_t size, std::size_t bucketSize, std::ostream &out, bool &first)
+    {
+        std::mt19937_64 gen(options.seed);
+        const auto points = Generate<Dims>(distribution,size,0,gen);
+        const auto queries = Generate<Dims>(distribution,options.nQueries,size,gen);
+        const auto updates = Generate<Dims>(distribution,options.nUpdates,size + options.nQueries,gen);
+
+        JsonRecord record;
+        record.Add("dims",Dims).Add("distribution",distribution).Add("size",size).Add("bucket_size",bucketSize).Add("queries",options.nQueries).Add("k",options.k);
+
+        // build
+        Stopwatch stopwatch;
+        KDTree<Object,Dims,double,SquaredDist> tree(bucketSize,points.begin(),points.end());
+        record.Add("build_ms",stopwatch.Nanoseconds() / 1e6);
+
+        // the radius is chosen to hold about k points around a typical query
+        std::vector<double> kthDistances;
+        for (const auto &query : queries)
+        {
+            const auto nearest = tree.FindNNearest(query,static_cast<unsigned>(options.k));
+            if (!nearest.empty())
+                kthDistances.push_back(SquaredDist::distance(nearest.back(),query));
+        }
+        const double radius = Latencies::From(kthDistances).p50;
+        record.Add("radius",radius);
+
+        // queries
+        record.Add("nearest",Measure(queries,[&tree](const BenchPoint<Dims> &query){return tree.FindNearest(query)->object.id;}));
+        record.Add("knn",Measure(queries,[&tree,&options](const BenchPoint<Dims> &query){return tree.FindNNearest(query,static_cast<unsigned>(options.k)).size();}));
+        record.Add("radius_search",Measure(queries,[&tree,radius](const BenchPoint<Dims> &query){return tree.FindWithinDistance(query,radius).size();}));
+
+        // standard container baseline: points sorted along the first axis, a radius search scans the slab around the query
+        std::vector<BenchPoint<Dims> > sorted(points.begin(),points.end());
+        std::sort(sorted.begin(),sorted.end(),[](const BenchPoint<Dims> &p1, const BenchPoint<Dims> &p2){return p1.coords[0] < p2.coords[0];});
+        const double halfWidth = std::sqrt(radius);
+        auto slabRadius = [&sorted,radius,halfWidth](const BenchPoint<Dims> &query)
+        {
+            auto byX = [](const BenchPoint<Dims> &p, double x){return p.coords[0] < x;};
+            std::vector<BenchPoint<Dims> > found;
+            for (auto it = std::lower_bound(sorted.begin(),sorted.end(),query.coords[0] - halfWidth,byX); it != sorted.end() && it->coords[0] <= query.coords[0] + halfWidth; ++it)
+                if (SquaredDist::distance(*it,query) <= radius)
+                    found.push_back(*it);
+            return found.size();
+        };
+        record.Add("sorted_slab_radius",Measure(queries,slabRadius));
+
+        // brute force reference
+        if (size <= options.bruteForceLimit)
+        {
+            std::vector<std::pair<double,std::size_t> > distances(points.size());
+            record.Add("brute_knn",Measure(queries,[&points,&distances,&options](const BenchPoint<Dims> &query)
+            {
+                for (std::size_t i = 0; i < points.size(); ++i)
+                    distances[i] = {SquaredDist::distance(points[i],query),i};
+                const std::size_t k = std::min(options.k,distances.size());
+                std::partial_sort(distances.begin(),distances.begin() + static_cast<std::ptrdiff_t>(k),distances.end());
+                return k;
+            }));
+            auto bruteRadius = [&points,radius](const BenchPoint<Dims> &query)
+            {
+                std::vector<BenchPoint<Dims> > found;
+                for (const auto &point : points)
+                    if (SquaredDist::distance(point,query) <= radius)
+                        found.push_back(point);
+                return found.size();
+            };
+            record.Add("brute_radius",Measure(queries,bruteRadius));
+
+            // the timings mean nothing if the answers differ: the first queries are checked against the brute force results
+            const std::size_t nChecked = std::min(options.nChecked,queries.size());
+            std::size_t knnMismatches = 0, radiusMismatches = 0, slabMismatches = 0;
+            for (std::size_t i = 0; i < nChecked; ++i)
+            {
+                const auto &query = queries[i];
+                std::vector<double> treeDistances;
+                for (const auto &point : tree.FindNNearest(query,static_cast<unsigned>(options.k)))
+                    treeDistances.push_back(SquaredDist::distance(point,query));
+                knnMismatches += (treeDistances != SortedDistances(points,query,options.k));
+
+                const std::size_t nWithin = bruteRadius(query);
+                radiusMismatches += (tree.FindWithinDistance(query,radius).size() != nWithin);
+                slabMismatches += (slabRadius(query) != nWithin);
+            }
+            record.Add("checked_queries",nChecked).Add("knn_mismatches",knnMismatches).Add("radius_mismatches",radiusMismatches).Add("slab_mismatches",slabMismatches);
+            if (knnMismatches + radiusMismatches + slabMismatches > 0)
+                std::cerr << "warning: " << knnMismatches << " kNN, " << radiusMismatches << " radius and " << slabMismatches << " slab results differ from the brute force reference" << std::endl;
+        }
+
+        // updates of the built tree
+        const auto nUpdates = static_cast<double>(updates.size());
+        stopwatch.Restart();
+        for (const auto &point : updates)
+            g_sink += tree.AddPoint(point);
+        record.Add("insert_per_s",nUpdates / (stopwatch.Nanoseconds() / 1e9));
+
+        stopwatch.Restart();
+        for (const auto &point : updates)
+            g_sink += tree.RemovePoint(point).has_value();
+        record.Add("remove_per_s",nUpdates / (stopwatch.Nanoseconds() / 1e9));
+
+        std::vector<JJDataStruct::KDTree::PointHandle> handles;
+        handles.reserve(updates.size());
+        stopwatch.Restart();
+        for (const auto &point : updates)
+            handles.push_back(tree.AddPointWithHandle(point));
+        record.Add("insert_with_handle_per_s",nUpdates / (stopwatch.Nanoseconds() / 1e9));
+
+        stopwatch.Restart();
+        for (const auto &handle : handles)
+            g_sink += tree.RemovePoint(handle).has_value();
+        record.Add("remove_by_handle_per_s",nUpdates / (stopwatch.Nanoseconds() / 1e9));
+
+        // the same insertions into a forest of balanced trees
+        DynamicKDTree<Object,Dims,double,SquaredDist> dynamic(bucketSize,points.begin(),points.end());
+        stopwatch.Restart();
+        for (const auto &point : updates)
+            g_sink += dynamic.AddPoint(point);
+        record.Add("dynamic_insert_per_s",nUpdates / (stopwatch.Nanoseconds() / 1e9));
+        record.Add("dynamic_knn",Measure(queries,[&dynamic,&options](const BenchPoint<Dims> &query){return dynamic.FindNNearest(query,static_cast<unsigned>(options.k)).size();}));
+
+        out << (first ? "[\n  " : ",\n  ") << record.str();
+        out.flush();
+        first = false;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        const Options options = Parse(argc,argv);
+        std::ofstream file;
+        if (!options.output.empty())
+        {
+            file.open(options.output);
+            if (!file)
+                throw std::runtime_error("cannot open " + options.output);
+        }
+        std::ostream &out = options.output.empty() ? std::cout : file;
+
+        // the dimension is a template argument, so only the instantiated ones can be benchmarked
+        const std::map<std::size_t,void (*)(const Options&, const std::string&, std::size_t, std::size_t, std::ostream&, bool&)> runners = {
+            {2, &Run<2>}, {3, &Run<3>}, {6, &Run<6>}};
+
+        bool first = true;
+        for (std::size_t dims : options.dims)
+        {
+            const auto runner = runners.find(dims);
+            if (runner == runners.end())
+                throw std::runtime_error("unsupported number of dimensions " + std::to_string(dims) + " (2, 3 or 6)");
+
+            for (const auto &distribution : options.distributions)
+                for (std::size_t size : options.sizes)
+                    for (std::size_t bucketSize : options.bucketSizes)
+                    {
+                        std::cerr << "dims=" << dims << " distribution=" << distribution << " size=" << size << " bucket=" << bucketSize << std::endl;
+                        runner->second(options,distribution,size,bucketSize,out,first);
+                    }
+        }
+        out << (first ? "[]\n" : "\n]\n");
+        std::cerr << "checksum " << g_sink << std::endl;
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << "benchmarks: " << error.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -3,12 +3,228 @@
 
     #include <deque>
 
-    #include "Node.hxx"
+    #include "NodeArray.hxx"
+    #include "QueryStats.hxx"
 
     namespace JJDataStruct
     {
         namespace KDTree
         {
+            /**
+             * @brief Condition accepting every point. Finders recognise it and skip turning the stored points into Point objects just to check it.
+             * 
+             */
+            struct AcceptAll
+            {
+                template <typename P>
+                constexpr bool operator()(const P&, const P&) const noexcept {return true;}
+            };
+
+            /**
+             * @brief Options of an approximate search for the nearest points (see NearestFinder::FindApproximate)
+             * 
+             */
+            struct SearchOptions
+            {
+                double epsilon = 0.; // the points found are at most (1 + epsilon) times further away than the true nearest ones (negative values count as 0)
+                std::size_t maxLeaves = 0; // the search stops after scanning this many leaves (0 for no limit)
+                std::size_t maxDistanceEvaluations = 0; // the search stops after evaluating this many distances, even in the middle of a leaf (0 for no limit)
+            };
+
+            /**
+             * @brief Pruning of an exact search: a cell is skipped only if it lies further away than the points found so far. Finders recognise it, so the exact searches do not pay for the approximate ones.
+             * 
+             */
+            struct ExactSearch
+            {
+                template <typename T>
+                static constexpr T Bound(T distToCell) noexcept {return distToCell;}
+                static constexpr bool IsExhausted() noexcept {return false;}
+                static constexpr std::size_t Scan(std::size_t nPoints, bool) noexcept {return nPoints;}
+            };
+
+            /**
+             * @brief Pruning of an approximate search (Arya & Mount): a cell is skipped if it lies further away than the points found so far divided by (1 + epsilon), and the whole search stops once its budget of leaves or distance evaluations is spent. 
+             * The budget of distance evaluations is hard: a leaf is scanned only up to the evaluations that remain. Only while nothing has been found yet (e.g. a conditional search rejecting every point) is a leaf scanned past the budget, so the search never comes back empty-handed from a non-empty tree.
+             * 
+             * @tparam T Arithmetic type of point coordinates
+             * @tparam Distance Metric upon which the distance will be calculated 
+             */
+            template <typename T, typename Distance>
+            class ApproximateSearch
+            {
+                private:
+                    double m_factor;
+                    std::size_t m_maxLeaves, m_maxDistanceEvaluations, m_nLeaves, m_nDistanceEvaluations;
+
+                public:
+                    explicit ApproximateSearch(const SearchOptions &options) noexcept : m_factor(1. + std::max(options.epsilon,0.)), m_maxLeaves(options.maxLeaves), m_maxDistanceEvaluations(options.maxDistanceEvaluations), m_nLeaves(0), m_nDistanceEvaluations(0) {}
+                    /**
+                     * @brief Distance compared with the points found so far when deciding whether a cell has to be searched
+                     * 
+                     */
+                    [[nodiscard]] T Bound(T distToCell) const noexcept {return ScaleDistance<Distance>(distToCell,m_factor);}
+                    [[nodiscard]] bool IsExhausted() const noexcept
+                    {
+                        return (m_maxLeaves != 0 && m_nLeaves >= m_maxLeaves) || (m_maxDistanceEvaluations != 0 && m_nDistanceEvaluations >= m_maxDistanceEvaluations);
+                    }
+                    /**
+                     * @brief Charge a leaf holding nPoints points to the budget
+                     * 
+                     * @param nPoints number of points in the leaf
+                     * @param hasFound whether the search has found any point so far
+                     * @return std::size_t number of points of the leaf whose distances may be evaluated
+                     */
+                    std::size_t Scan(std::size_t nPoints, bool hasFound) noexcept
+                    {
+                        ++m_nLeaves;
+                        if (m_maxDistanceEvaluations != 0)
+                        {
+                            const std::size_t remaining = m_maxDistanceEvaluations - std::min(m_nDistanceEvaluations,m_maxDistanceEvaluations);
+                            if (remaining > 0 || hasFound)
+                                nPoints = std::min(nPoints,remaining);
+                        }
+                        m_nDistanceEvaluations += nPoints;
+                        return nPoints;
+                    }
+            };
+
+            /**
+             * @brief Lower bound of the distance from the query point to the cell of the node which is being visited, updated incrementally on the way down the tree (Arya & Mount).
+             * It remembers the axis distance from the query to the cell along every dimension, so stepping into the far child of a node only replaces one term of the bound instead of recalculating it. Stepping into the near child does not change the bound at all.
+             * 
+             * @tparam T Arithmetic type of point coordinates
+             * @tparam Dims Number of dimensions over which the data will be divided 
+             * @tparam Distance Metric upon which the distance will be calculated 
+             */
+            template <typename T, std::size_t Dims, typename Distance>
+            class CellDistance
+            {
+                private:
+                    std::array<T,Dims> m_axisDistances;
+                    T m_distance;
+
+                public:
+                    /**
+                     * @brief Construct a new CellDistance object for a query point lying inside the cell
+                     * 
+                     */
+                    CellDistance() : m_axisDistances{}, m_distance(0) {}
+                    [[nodiscard]] inline T Get() const noexcept {return m_distance;}
+                    /**
+                     * @brief Get the bound for the cell on the other side of a split
+                     * 
+                     * @param dim dimension along which the cell is split
+                     * @param axisDistance axis distance from the query to the split (Node::CalculateDistanceToMedian)
+                     * @return T 
+                     */
+                    [[nodiscard]] T GetFarSide(std::size_t dim, T axisDistance) const noexcept
+                    {
+                        return RegionDistance<Distance>(m_distance,m_axisDistances[dim],axisDistance);
+                    }
+                    /**
+                     * @brief Run func with the bound moved to the cell on the other side of a split and restore it afterwards
+                     * 
+                     * @tparam Func function of signature () -> void
+                     * @param dim dimension along which the cell is split
+                     * @param axisDistance axis distance from the query to the split
+                     * @param farDistance bound returned by GetFarSide(dim,axisDistance)
+                     * @param func function to run
+                     */
+                    template <typename Func>
+                    void VisitFarSide(std::size_t dim, T axisDistance, T farDistance, Func func)
+                    {
+                        const T oldAxisDistance = m_axisDistances[dim];
+                        const T oldDistance = m_distance;
+                        m_axisDistances[dim] = axisDistance;
+                        m_distance = farDistance;
+                        func();
+                        m_axisDistances[dim] = oldAxisDistance;
+                        m_distance = oldDistance;
+                    }
+            };
+
+            /**
+             * @brief Bounding box of the cell of the node which is being visited, narrowed by the splits on the way down the tree. The cell of the root is either unbounded or the box holding all the points.
+             * 
+             * @tparam T Arithmetic type of point coordinates
+             * @tparam Dims Number of dimensions over which the data will be divided 
+             */
+            template <typename T, std::size_t Dims>
+            class CellBounds
+            {
+                private:
+                    std::array<T,Dims> m_lower, m_upper;
+
+                public:
+                    CellBounds() : m_lower(), m_upper()
+                    {
+                        m_lower.fill(std::numeric_limits<T>::lowest());
+                        m_upper.fill(std::numeric_limits<T>::max());
+                    }
+                    /**
+                     * @brief Construct a new CellBounds object for a root cell bounded by the box holding all the points (see NodeArray::GetBounds)
+                     * 
+                     */
+                    explicit CellBounds(const std::array<std::pair<T,T>,Dims> &bounds) : m_lower(), m_upper()
+                    {
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                        {
+                            m_lower[dim] = bounds[dim].first;
+                            m_upper[dim] = bounds[dim].second;
+                        }
+                    }
+                    /**
+                     * @brief Run func with the bounds narrowed to a child of a split and restore them afterwards
+                     * 
+                     * @tparam Func function of signature () -> void
+                     * @param dim dimension along which the cell is split
+                     * @param median position of the split
+                     * @param isLeft true for the left child (at or below the median), false for the right one
+                     * @param func function to run
+                     */
+                    template <typename Func>
+                    void VisitChild(std::size_t dim, T median, bool isLeft, Func func)
+                    {
+                        T &bound = (isLeft) ? m_upper[dim] : m_lower[dim];
+                        const T oldBound = bound;
+                        bound = median;
+                        func();
+                        bound = oldBound;
+                    }
+                    /**
+                     * @brief Check whether the cell lies inside the box [lower,upper]
+                     * 
+                     */
+                    [[nodiscard]] bool IsInBox(const std::array<T,Dims> &lower, const std::array<T,Dims> &upper) const noexcept
+                    {
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            if (m_lower[dim] < lower[dim] || m_upper[dim] > upper[dim])
+                                return false;
+
+                        return true;
+                    }
+                    /**
+                     * @brief Check whether the cell lies within distance of point, i.e. whether its furthest corner does (an unbounded cell never does)
+                     * 
+                     * @tparam Distance Metric upon which the distance will be calculated 
+                     */
+                    template <typename Distance>
+                    [[nodiscard]] bool IsWithinDistance(const std::array<T,Dims> &point, T distance) const noexcept
+                    {
+                        std::array<T,Dims> corner;
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                        {
+                            if (m_lower[dim] == std::numeric_limits<T>::lowest() || m_upper[dim] == std::numeric_limits<T>::max())
+                                return false;
+
+                            corner[dim] = (point[dim] - m_lower[dim] > m_upper[dim] - point[dim]) ? m_lower[dim] : m_upper[dim];
+                        }
+
+                        return Distance::distance(point,corner) <= distance;
+                    }
+            };
+
             /**
              * @brief Inserter object. It tries to emplace passed object at a correct node
              * 
@@ -24,27 +240,53 @@
                     /**
                      * @brief Insert point starting from the given node
                      * 
-                     * @param node starting node (top of the tree)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
                      * @param point point to be inserted
                      * @return true if successful, flase otherweise
-                     * @throws std::runtime_error if the node is a nullptr an exception is thrown
+                     * @throws std::runtime_error if the node index is out of range an exception is thrown
                      */
-                    bool Insert(const std::shared_ptr<Node<Leaf,T,Dims,Distance> > &node, Point<Leaf,T,Dims> &&point)
+                    template <typename Nodes>
+                    bool Insert(Nodes &nodes, std::uint32_t index, Point<Leaf,T,Dims> &&point)
                     {
-                        if (node != nullptr)
+                        if (nodes.IsValidIndex(index))
                         {
-                            if (node->IsSplit())
+                            while (nodes[index].IsSplit())
                             {
-                                return Insert(node->GetChild(point),std::move(point));
+                                index = nodes[index].GetChildIndex(point);
                             }
-                            else
+
+                            return nodes.AddPoint(index,std::move(point));
+                        }
+                        else
+                        {
+                            throw std::runtime_error("Inserter::Insert - Node index is out of range");
+                        }
+                    }
+                    /**
+                     * @brief Insert point starting from the given node and give it a handle (see NodeArray::AddPointWithHandle)
+                     * 
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
+                     * @param point point to be inserted
+                     * @return handle of the inserted point
+                     * @throws std::runtime_error if the node index is out of range an exception is thrown
+                     */
+                    template <typename Nodes>
+                    PointHandle InsertWithHandle(Nodes &nodes, std::uint32_t index, Point<Leaf,T,Dims> &&point)
+                    {
+                        if (nodes.IsValidIndex(index))
+                        {
+                            while (nodes[index].IsSplit())
                             {
-                                return node->AddPoint(std::move(point));
+                                index = nodes[index].GetChildIndex(point);
                             }
+
+                            return nodes.AddPointWithHandle(index,std::move(point)).value();
                         }
                         else
                         {
-                            throw std::runtime_error("Inserter::Insert - Node is nullptr");
+                            throw std::runtime_error("Inserter::InsertWithHandle - Node index is out of range");
                         }
                     }
             };
@@ -64,26 +306,39 @@
                     /**
                      * @brief Remove point starting from the given node
                      * 
-                     * @param node starting node (top of the tree)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
                      * @param point point to be removed
                      * @return point wchich is equal to requested one (of exists)
                      */
-                    std::optional<Point<Leaf,T,Dims>> Remove(const std::shared_ptr<Node<Leaf,T,Dims,Distance> > &node, const Point<Leaf,T,Dims> &point)
+                    template <typename Nodes>
+                    std::optional<Point<Leaf,T,Dims>> Remove(Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point)
                     {
-                        if (node != nullptr)
+                        if (nodes.IsValidIndex(index))
                         {
-                            if (node->IsSplit())
+                            while (nodes[index].IsSplit())
                             {
-                                return Remove(node->GetChild(point),point);
-                            }
-                            else
-                            {
-                                auto tmp_point = node->RemovePoint(point); 
-                                if (node->GetParentNode() != nullptr)
-                                    node->GetParentNode()->TryJoin();
-                                    
-                                return tmp_point;
+                                const auto &node = nodes[index];
+                                if (point.coords[node.GetDimensionIndex()] == node.GetMedian()) // a bulk build may have put points lying on the median into either child
+                                {
+                                    auto tmp_point = Remove(nodes,node.GetLeftIndex(),point);
+                                    if (tmp_point.has_value())
+                                        return tmp_point;
+
+                                    // the failed attempt may still have joined the children back into this node
+                                    return Remove(nodes,(nodes[index].IsSplit()) ? nodes[index].GetRightIndex() : index,point);
+                                }
+                                index = node.GetChildIndex(point);
                             }
+
+                            auto tmp_point = nodes.RemovePoint(index,point);
+                            const std::uint32_t parentIndex = nodes[index].GetParentIndex();
+                            if (parentIndex != InvalidIndex && nodes.TryJoin(parentIndex))
+                                index = parentIndex;
+                            if (tmp_point.has_value())
+                                nodes.Rebalance(index);
+
+                            return tmp_point;
                         }
                         else
                         {
@@ -104,100 +359,203 @@
             class NearestFinder
             {
                 private:
-                    void FindClosestPoint(const std::shared_ptr<Node<Leaf,T,Dims,Distance> > &node, const Point<Leaf,T,Dims> &point, Point<Leaf,T,Dims> &closestPoint, bool &pointWasFound) noexcept
-                    {      
-                        if (node->IsSplit())
-                        {
-                            FindClosestPoint(node->GetChild(point), point, closestPoint, pointWasFound);
-                            auto distToMedian = node->CalculateDistanceToMedian(point);
-                            auto distToFurthest = (pointWasFound) ? Distance::distance(point,closestPoint) : std::numeric_limits<T>::infinity(); // this is calculated unnecessarily often
-                            
-                            if (distToMedian < distToFurthest)
-                                FindClosestPoint(node->GetOtherChild(point), point, closestPoint, pointWasFound);
-                        }
-                        else if (!node->IsEmpty())
+                    /**
+                     * @brief Closest point found so far: its bucket (nullptr if none), the index of its leaf, its position in the bucket and its distance
+                     * 
+                     */
+                    template <typename BucketType>
+                    struct Closest
+                    {
+                        const BucketType *bucket = nullptr;
+                        std::uint32_t nodeIndex = InvalidIndex;
+                        std::size_t position = 0;
+                        T distance = std::numeric_limits<T>::max();
+
+                        [[nodiscard]] std::optional<Point<Leaf,T,Dims> > GetPoint() const
                         {
-                            pointWasFound = true;
-                            auto newClosestPoint = node->FindNearest(point).value(); // I have a guarantee that I will find a point, because I check if this node is not empty
-                            if (Distance::distance(newClosestPoint,point) < Distance::distance(closestPoint,point))
-                                closestPoint = newClosestPoint;
+                            return (bucket != nullptr) ? std::optional<Point<Leaf,T,Dims> >{bucket->GetPoint(position)} : std::nullopt;
                         }
-                    }
+                    };
 
-                    template <typename Cond>
-                    void FindClosestPointIf(const std::shared_ptr<Node<Leaf,T,Dims,Distance> > &node, const Point<Leaf,T,Dims> &point, Point<Leaf,T,Dims> &closestPoint, bool &pointWasFound, Cond cond)
+                    template <typename Nodes, typename Cond, typename Search>
+                    void FindClosestPoint(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, CellDistance<T,Dims,Distance> &cell, Closest<typename Nodes::BucketType> &closest, Cond &cond, Search &search) const noexcept
                     {      
-                        
-                        if (node->IsSplit())
+                        const auto &node = nodes[index];
+                        if (node.IsSplit())
                         {
-                            FindClosestPointIf<Cond>(node->GetChild(point), point, closestPoint, pointWasFound, cond);
-                            auto distToMedian = node->CalculateDistanceToMedian(point);
-                            auto distToFurthest = (pointWasFound) ? Distance::distance(point,closestPoint) : std::numeric_limits<T>::infinity(); // this is calculated unnecessarily often
+                            KDTREE_COUNT(nodesVisited,1);
+                            FindClosestPoint(nodes, node.GetChildIndex(point), point, cell, closest, cond, search);
+                            const auto distToMedian = node.CalculateDistanceToMedian(point);
+                            const auto distToCell = cell.GetFarSide(node.GetDimensionIndex(),distToMedian);
                             
-                            if (distToMedian < distToFurthest)
-                                FindClosestPointIf<Cond>(node->GetOtherChild(point), point, closestPoint, pointWasFound, cond);
+                            if (closest.bucket == nullptr || (!search.IsExhausted() && search.Bound(distToCell) < closest.distance))
+                                cell.VisitFarSide(node.GetDimensionIndex(),distToMedian,distToCell,[&]()
+                                {
+                                    FindClosestPoint(nodes, node.GetOtherChildIndex(point), point, cell, closest, cond, search);
+                                });
+                            else
+                                KDTREE_COUNT(prunedSubtrees,1);
                         }
-                        else if (!node->IsEmpty())
+                        else
                         {
-                            pointWasFound = true;
-                            auto newClosestPoint = node->FindNearest(point).value(); // I have a guarantee that I will find a point, because I check if this node is not empty
-                            if (Distance::distance(newClosestPoint,point) < Distance::distance(closestPoint,point) && cond(point,newClosestPoint))
-                                closestPoint = newClosestPoint;
+                            const std::size_t nEvaluated = search.Scan(node.size(),closest.bucket != nullptr);
+                            KDTREE_COUNT(leavesScanned,1);
+                            KDTREE_COUNT(distanceEvaluations,nEvaluated);
+                            const auto &bucket = node.GetBucket();
+                            node.ForEachDistance(point,nEvaluated,[&](std::size_t i, T dist)
+                            {
+                                if (dist < closest.distance || closest.bucket == nullptr)
+                                {
+                                    if constexpr (!std::is_same_v<Cond,AcceptAll>)
+                                        if (!cond(point,bucket.GetPoint(i)))
+                                            return;
+
+                                    closest = {&bucket,index,i,dist};
+                                }
+                            });
                         }
-                       
                     }
 
                 public:
                     /**
                      * @brief Find closest point in the tree
                      * 
-                     * @param node starting node (top of the tree)
+                     * @tparam Nodes array holding the tree (NodeArray or FrozenNodeArray)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
                      * @param point point to match against
                      * @return closest point or std::nullopt if no point was found in the tree
-                     * @throws runtime_error if node is nullptr
+                     * @throws runtime_error if node index is out of range
                      */
-                    std::optional<Point<Leaf,T,Dims> > Find(const std::shared_ptr<Node<Leaf,T,Dims,Distance> > &node, const Point<Leaf,T,Dims> &point)
+                    template <typename Nodes>
+                    std::optional<Point<Leaf,T,Dims> > Find(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point) const
                     {
-                        if (node != nullptr)
+                        if (nodes.IsValidIndex(index))
                         {
-                            Point<Leaf,T,Dims> closestPoint = {Leaf(), {}};
+                            Closest<typename Nodes::BucketType> closest;
+                            CellDistance<T,Dims,Distance> cell;
+                            AcceptAll acceptAll;
+                            ExactSearch exact;
+                            FindClosestPoint(nodes, index, point, cell, closest, acceptAll, exact);
 
-                            bool pointWasFound = false;
-                            FindClosestPoint(node, point, closestPoint, pointWasFound);
+                            return closest.GetPoint();
+                        }
+                        else
+                        {
+                            throw std::runtime_error("NearestFinder::Find - Node index is out of range");
+                        }
+                    }
+                    /**
+                     * @brief Find the location of the closest point in the tree, without copying the point
+                     * 
+                     * @tparam Nodes array holding the tree (NodeArray or FrozenNodeArray)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
+                     * @param point point to match against
+                     * @return location of the closest point and its distance, or an invalid location and std::numeric_limits<T>::max() if no point was found in the tree
+                     * @throws runtime_error if node index is out of range
+                     */
+                    template <typename Nodes>
+                    std::pair<PointLocation,T> FindLocation(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point) const
+                    {
+                        if (nodes.IsValidIndex(index))
+                        {
+                            Closest<typename Nodes::BucketType> closest;
+                            CellDistance<T,Dims,Distance> cell;
+                            AcceptAll acceptAll;
+                            ExactSearch exact;
+                            FindClosestPoint(nodes, index, point, cell, closest, acceptAll, exact);
 
-                            return (pointWasFound) ? std::optional<Point<Leaf,T,Dims> >{closestPoint} : std::nullopt;
+                            return {PointLocation{closest.nodeIndex,static_cast<std::uint32_t>(closest.position)},closest.distance};
                         }
                         else
                         {
-                            throw std::runtime_error("NearestFinder::Find - Node is nullptr");
+                            throw std::runtime_error("NearestFinder::FindLocation - Node index is out of range");
                         }
                     }
                     /**
                      * @brief Find closest point in the tree for which condition cond is true
                      * 
+                     * @tparam Nodes array holding the tree (NodeArray or FrozenNodeArray)
                      * @tparam Cond function of signature (Point,Point) -> bool
-                     * @param node starting node (top of the tree)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
                      * @param point point to match against
                      * @param cond binary predicate which returns ​true for the required elements
                      * @return std::optional<Point<Leaf,T,Dims> > 
-                     * @throws runtime_error if node is nullptr
+                     * @throws runtime_error if node index is out of range
                      */
-                    template <typename Cond>
-                    std::optional<Point<Leaf,T,Dims> > FindIf(const std::shared_ptr<Node<Leaf,T,Dims,Distance> > &node, const Point<Leaf,T,Dims> &point, Cond cond)
+                    template <typename Nodes, typename Cond>
+                    std::optional<Point<Leaf,T,Dims> > FindIf(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, Cond cond) const
                     {
-                        if (node != nullptr)
+                        if (nodes.IsValidIndex(index))
                         {
-                        Point<Leaf,T,Dims> closestPoint = {Leaf(), {}};
+                            Closest<typename Nodes::BucketType> closest;
+                            CellDistance<T,Dims,Distance> cell;
+                            ExactSearch exact;
+                            FindClosestPoint(nodes, index, point, cell, closest, cond, exact);
 
-                        bool pointWasFound = false;
-                        FindClosestPointIf<Cond>(node, point, closestPoint, pointWasFound, cond);
+                            return closest.GetPoint();
+                        }
+                        else
+                        {
+                            throw std::runtime_error("NearestFinder::FindIf - Node index is out of range");
+                        }
+                    }
+                    /**
+                     * @brief Find a point in the tree which is nearly the closest one: at most (1 + epsilon) times further away than the closest point, or just the closest point found before the budget of the search has been spent (see SearchOptions)
+                     * 
+                     * @tparam Nodes array holding the tree (NodeArray or FrozenNodeArray)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
+                     * @param point point to match against
+                     * @param options accuracy and budget of the search
+                     * @return nearly closest point or std::nullopt if no point was found in the tree
+                     * @throws runtime_error if node index is out of range
+                     */
+                    template <typename Nodes>
+                    std::optional<Point<Leaf,T,Dims> > FindApproximate(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, const SearchOptions &options) const
+                    {
+                        if (nodes.IsValidIndex(index))
+                        {
+                            Closest<typename Nodes::BucketType> closest;
+                            CellDistance<T,Dims,Distance> cell;
+                            AcceptAll acceptAll;
+                            ApproximateSearch<T,Distance> search(options);
+                            FindClosestPoint(nodes, index, point, cell, closest, acceptAll, search);
 
-                        return (pointWasFound) ? std::optional<Point<Leaf,T,Dims> >{closestPoint} : std::nullopt;
+                            return closest.GetPoint();
                         }
                         else
                         {
-                            throw std::runtime_error("NearestFinder::FindIf - Node is nullptr");
+                            throw std::runtime_error("NearestFinder::FindApproximate - Node index is out of range");
+                        }
+                    }
+                    /**
+                     * @brief Find closest point in a forest of trees. The closest point found so far is shared between the trees, so the trees searched later are pruned with it.
+                     * 
+                     * @tparam Forest range of arrays holding the trees (empty arrays are skipped)
+                     * @param forest arrays holding the trees
+                     * @param point point to match against
+                     * @return closest point or std::nullopt if all the trees are empty
+                     */
+                    template <typename Forest>
+                    std::optional<Point<Leaf,T,Dims> > FindInForest(const Forest &forest, const Point<Leaf,T,Dims> &point) const
+                    {
+                        using Nodes = std::decay_t<decltype(*std::begin(forest))>;
+                        Closest<typename Nodes::BucketType> closest;
+                        AcceptAll acceptAll;
+                        ExactSearch exact;
+                        for (const Nodes &nodes : forest)
+                        {
+                            if (nodes.IsEmpty())
+                                continue;
+
+                            CellDistance<T,Dims,Distance> cell;
+                            FindClosestPoint(nodes, nodes.GetRootIndex(), point, cell, closest, acceptAll, exact);
                         }
+
+                        return closest.GetPoint();
                     }
             };
 
@@ -213,107 +571,258 @@
             class NNearestFinder
             {
                 private:
-                    void FindAtLeastNClosestPoints(const std::shared_ptr<Node<Leaf,T,Dims,Distance> > &node, const Point<Leaf,T,Dims> &point, std::vector<Point<Leaf,T,Dims> > &closestPoints, unsigned nPoints) noexcept
+                    template <typename BucketType>
+                    struct Candidate
                     {
-                        if (node->IsSplit())
+                        T distance;
+                        std::size_t order; // candidates found earlier win ties
+                        const BucketType *bucket;
+                        std::uint32_t nodeIndex;
+                        std::size_t position;
+                    };
+                    struct CloserCandidate
+                    {
+                        template <typename BucketType>
+                        bool operator()(const Candidate<BucketType> &lhs, const Candidate<BucketType> &rhs) const noexcept {return (lhs.distance < rhs.distance) || (lhs.distance == rhs.distance && lhs.order < rhs.order);}
+                    };
+                    template <typename Nodes>
+                    using CandidateQueue = JJUtils::bounded_priority_queue<Candidate<typename Nodes::BucketType>,CloserCandidate>;
+
+                    template <typename Nodes, typename Cond, typename Search>
+                    void FindNClosestPoints(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, CellDistance<T,Dims,Distance> &cell, CandidateQueue<Nodes> &candidates, std::size_t &nVisited, Cond &cond, Search &search) const noexcept
+                    {
+                        const auto &node = nodes[index];
+                        if (node.IsSplit())
                         {
-                            FindAtLeastNClosestPoints(node->GetChild(point), point, closestPoints, nPoints);
-                            auto distToMedian = node->CalculateDistanceToMedian(point);
-                            auto distToFurthest = (closestPoints.empty()) ? std::numeric_limits<T>::infinity()  : Distance::distance(point,closestPoints.back()); // this is calculated unnecessarily often
+                            KDTREE_COUNT(nodesVisited,1);
+                            FindNClosestPoints(nodes, node.GetChildIndex(point), point, cell, candidates, nVisited, cond, search);
+                            const auto distToMedian = node.CalculateDistanceToMedian(point);
+                            const auto distToCell = cell.GetFarSide(node.GetDimensionIndex(),distToMedian);
                             
-                            if (distToMedian < distToFurthest || closestPoints.size() < nPoints)
-                                FindAtLeastNClosestPoints(node->GetOtherChild(point), point, closestPoints, nPoints);
+                            // the furthest of the N closest points found so far is the pruning radius (an approximate search stops once its budget is spent and it has found anything)
+                            if ((candidates.empty() || !search.IsExhausted()) && (!candidates.full() || search.Bound(distToCell) < candidates.top().distance))
+                                cell.VisitFarSide(node.GetDimensionIndex(),distToMedian,distToCell,[&]()
+                                {
+                                    FindNClosestPoints(nodes, node.GetOtherChildIndex(point), point, cell, candidates, nVisited, cond, search);
+                                });
+                            else
+                                KDTREE_COUNT(prunedSubtrees,1);
                         }
                         else
                         {
-                            auto newClosestPoints = node->FindNNearest(point,nPoints);
-                            closestPoints.insert(closestPoints.end(),newClosestPoints.begin(),newClosestPoints.end());
-                            std::sort(closestPoints.begin(),closestPoints.end(),
-                                [&point](const Point<Leaf,T,Dims> &lhs, const Point<Leaf,T,Dims> &rhs){return Distance::distance(point,lhs) < Distance::distance(point,rhs);});
+                            const std::size_t nEvaluated = search.Scan(node.size(),!candidates.empty());
+                            KDTREE_COUNT(leavesScanned,1);
+                            KDTREE_COUNT(distanceEvaluations,nEvaluated);
+                            const auto &bucket = node.GetBucket();
+                            node.ForEachDistance(point,nEvaluated,[&](std::size_t i, T dist)
+                            {
+                                if (!candidates.full() || dist < candidates.top().distance)
+                                {
+                                    if constexpr (!std::is_same_v<Cond,AcceptAll>)
+                                        if (!cond(bucket.GetPoint(i),point))
+                                            return;
+
+                                    candidates.push({dist,nVisited++,&bucket,index,i});
+                                }
+                            });
                         }
                     }
-                    template <typename Cond>
-                    void FindAtLeastNClosestPointsIf(const std::shared_ptr<Node<Leaf,T,Dims,Distance> > &node, const Point<Leaf,T,Dims> &point, std::vector<Point<Leaf,T,Dims> > &closestPoints, unsigned nPoints, Cond cond) noexcept
+                    template <typename Nodes>
+                    static void Collect(CandidateQueue<Nodes> &candidates, std::vector<Point<Leaf,T,Dims> > &closestPoints)
+                    {
+                        candidates.sort();
+                        closestPoints.reserve(candidates.size());
+                        for (const auto &candidate : candidates)
+                            closestPoints.push_back(candidate.bucket->GetPoint(candidate.position));
+                    }
+                    template <typename Nodes, typename Cond, typename Search>
+                    void FindImpl(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, unsigned nPoints, std::vector<Point<Leaf,T,Dims> > &closestPoints, Cond &cond, Search &search) const
+                    {
+                        closestPoints.clear();
+                        if (nPoints == 0)
+                            return;
+
+                        CandidateQueue<Nodes> candidates(nPoints);
+                        std::size_t nVisited = 0;
+                        CellDistance<T,Dims,Distance> cell;
+                        FindNClosestPoints(nodes,index,point,cell,candidates,nVisited,cond,search);
+                        Collect<Nodes>(candidates,closestPoints);
+                    }
+
+                public:
+                    /**
+                     * @brief Find the locations of N closest points in a tree and write them, sorted by distance, into caller-provided buffers, without copying the points
+                     * 
+                     * @tparam Nodes array holding the tree (NodeArray or FrozenNodeArray)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
+                     * @param point point to match against
+                     * @param nPoints number of closest points to look for
+                     * @param locations buffer for at least nPoints locations
+                     * @param distances buffer for at least nPoints distances
+                     * @return std::size_t number of points found: N or less (if there were not enough points)
+                     * @throws runtime_error if node index is out of range
+                     */
+                    template <typename Nodes>
+                    std::size_t FindLocations(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, unsigned nPoints, PointLocation *locations, T *distances) const
                     {
-                        if (node->IsSplit())
+                        if (nodes.IsValidIndex(index))
                         {
-                            FindAtLeastNClosestPointsIf<Cond>(node->GetChild(point), point, closestPoints, nPoints, cond);
-                            auto distToMedian = node->CalculateDistanceToMedian(point);
-                            auto distToFurthest = (closestPoints.empty()) ? std::numeric_limits<T>::infinity()  : Distance::distance(point,closestPoints.back()); // this is calculated unnecessarily often
-                            
-                            if (distToMedian < distToFurthest || closestPoints.size() < nPoints)
-                                FindAtLeastNClosestPointsIf<Cond>(node->GetOtherChild(point), point, closestPoints, nPoints, cond);
+                            if (nPoints == 0)
+                                return 0;
+
+                            CandidateQueue<Nodes> candidates(nPoints);
+                            std::size_t nVisited = 0;
+                            CellDistance<T,Dims,Distance> cell;
+                            AcceptAll acceptAll;
+                            ExactSearch exact;
+                            FindNClosestPoints(nodes,index,point,cell,candidates,nVisited,acceptAll,exact);
+
+                            candidates.sort();
+                            std::size_t nFound = 0;
+                            for (const auto &candidate : candidates)
+                            {
+                                locations[nFound] = {candidate.nodeIndex,static_cast<std::uint32_t>(candidate.position)};
+                                distances[nFound] = candidate.distance;
+                                ++nFound;
+                            }
+
+                            return nFound;
                         }
                         else
                         {
-                            auto newClosestPoints = node->FindNNearest(point,nPoints);
-                            std::copy_if(newClosestPoints.begin(),newClosestPoints.end(),std::back_inserter(closestPoints),[&point,&cond](const Point<Leaf,T,Dims> &p){return cond(p,point);});
-                            std::sort(closestPoints.begin(),closestPoints.end(),
-                                [&point](const Point<Leaf,T,Dims> &lhs, const Point<Leaf,T,Dims> &rhs){return Distance::distance(point,lhs) < Distance::distance(point,rhs);});
+                            throw std::runtime_error("NNearestFinder::FindLocations - Node index is out of range");
                         }
                     }
-
-                public:
                     /**
                      * @brief Find N closest points in a tree.
                      * 
-                     * @param node starting node (top of the tree)
+                     * @tparam Nodes array holding the tree (NodeArray or FrozenNodeArray)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
                      * @param point point to match against
                      * @param nPoints number of closest points to look for
                      * @return a vector of N closest points or less (if there were not enough points)
-                     * @throws runtime_error if node is nullptr
+                     * @throws runtime_error if node index is out of range
                      */
-                    std::vector<Point<Leaf,T,Dims> > Find(const std::shared_ptr<Node<Leaf,T,Dims,Distance> > &node, const Point<Leaf,T,Dims> &point, unsigned nPoints)
+                    template <typename Nodes>
+                    std::vector<Point<Leaf,T,Dims> > Find(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, unsigned nPoints) const
                     {
-                        if (node != nullptr)
+                        std::vector<Point<Leaf,T,Dims> > closestPoints;
+                        Find(nodes,index,point,nPoints,closestPoints);
+                        return closestPoints;
+                    }
+                    /**
+                     * @brief Find N closest points in a tree and store them in a caller-provided buffer (its capacity is reused between calls)
+                     * 
+                     * @tparam Nodes array holding the tree (NodeArray or FrozenNodeArray)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
+                     * @param point point to match against
+                     * @param nPoints number of closest points to look for
+                     * @param closestPoints buffer which will hold N closest points or less (if there were not enough points), sorted by distance
+                     * @throws runtime_error if node index is out of range
+                     */
+                    template <typename Nodes>
+                    void Find(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, unsigned nPoints, std::vector<Point<Leaf,T,Dims> > &closestPoints) const
+                    {
+                        if (nodes.IsValidIndex(index))
                         {
-                            std::vector<Point<Leaf,T,Dims> > closestPoints;
-
-                            FindAtLeastNClosestPoints(node,point,closestPoints,nPoints);
-                            std::sort(closestPoints.begin(),closestPoints.end(),
-                                    [&point](const Point<Leaf,T,Dims> &lhs, const Point<Leaf,T,Dims> &rhs)
-                                    {
-                                        return Distance::distance(point,lhs) < Distance::distance(point,rhs);
-                                    });
-
-                            return (closestPoints.size() > nPoints) ? std::vector<Point<Leaf,T,Dims> >(closestPoints.begin(),closestPoints.begin() + nPoints) : closestPoints;
+                            AcceptAll acceptAll;
+                            ExactSearch exact;
+                            FindImpl(nodes,index,point,nPoints,closestPoints,acceptAll,exact);
                         }
                         else
                         {
-                            throw std::runtime_error("NNearestFinder::Find - Node is nullptr");
+                            throw std::runtime_error("NNearestFinder::Find - Node index is out of range");
                         }
                     }
                     /**
                      * @brief Find N closest points in a tree for which condition cond is true
                      * 
+                     * @tparam Nodes array holding the tree (NodeArray or FrozenNodeArray)
                      * @tparam Cond function of signature (Point,Point) -> bool
-                     * @param node starting node (top of the tree)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
                      * @param point point to match against
                      * @param nPoints number of closest points to look for
                      * @param cond binary predicate which returns ​true for the required elements
                      * @return a vector of N closest points or less (if there were not enough points)
-                     * @throws runtime_error if node is nullptr
+                     * @throws runtime_error if node index is out of range
                      */
-                    template <typename Cond>
-                    std::vector<Point<Leaf,T,Dims> > FindIf(const std::shared_ptr<Node<Leaf,T,Dims,Distance> > &node, const Point<Leaf,T,Dims> &point, unsigned nPoints, Cond cond)
+                    template <typename Nodes, typename Cond>
+                    std::vector<Point<Leaf,T,Dims> > FindIf(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, unsigned nPoints, Cond cond) const
                     {
-                        if (node != nullptr)
+                        if (nodes.IsValidIndex(index))
                         {
                             std::vector<Point<Leaf,T,Dims> > closestPoints;
-
-                            FindAtLeastNClosestPointsIf<Cond>(node,point,closestPoints,nPoints,cond);
-                            std::sort(closestPoints.begin(),closestPoints.end(),
-                                    [&point](const Point<Leaf,T,Dims> &lhs, const Point<Leaf,T,Dims> &rhs)
-                                    {
-                                        return Distance::distance(point,lhs) < Distance::distance(point,rhs);
-                                    });
-
-                            return (closestPoints.size() > nPoints) ? std::vector<Point<Leaf,T,Dims> >(closestPoints.begin(),closestPoints.begin() + nPoints) : closestPoints;
+                            ExactSearch exact;
+                            FindImpl(nodes,index,point,nPoints,closestPoints,cond,exact);
+                            return closestPoints;
+                        }
+                        else
+                        {
+                            throw std::runtime_error("NNearestFinder::FindIf - Node index is out of range");
+                        }
+                    }
+                    /**
+                     * @brief Find N points in a tree which are nearly the closest ones: each of them at most (1 + epsilon) times further away than the true one of the same rank, or just the closest points found before the budget of the search has been spent (see SearchOptions)
+                     * 
+                     * @tparam Nodes array holding the tree (NodeArray or FrozenNodeArray)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
+                     * @param point point to match against
+                     * @param nPoints number of closest points to look for
+                     * @param options accuracy and budget of the search
+                     * @return a vector of N nearly closest points sorted by distance, or less (if there were not enough points or the budget has run out)
+                     * @throws runtime_error if node index is out of range
+                     */
+                    template <typename Nodes>
+                    std::vector<Point<Leaf,T,Dims> > FindApproximate(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, unsigned nPoints, const SearchOptions &options) const
+                    {
+                        if (nodes.IsValidIndex(index))
+                        {
+                            std::vector<Point<Leaf,T,Dims> > closestPoints;
+                            AcceptAll acceptAll;
+                            ApproximateSearch<T,Distance> search(options);
+                            FindImpl(nodes,index,point,nPoints,closestPoints,acceptAll,search);
+                            return closestPoints;
                         }
                         else
                         {
-                            throw std::runtime_error("NNearestFinder::FindIf - Node is nullptr");
+                            throw std::runtime_error("NNearestFinder::FindApproximate - Node index is out of range");
+                        }
+                    }
+                    /**
+                     * @brief Find N closest points in a forest of trees. All the trees share one queue of candidates, so the N-th closest point found so far prunes the trees searched later.
+                     * 
+                     * @tparam Forest range of arrays holding the trees (empty arrays are skipped)
+                     * @param forest arrays holding the trees
+                     * @param point point to match against
+                     * @param nPoints number of closest points to look for
+                     * @param closestPoints buffer which will hold N closest points or less (if there were not enough points), sorted by distance
+                     */
+                    template <typename Forest>
+                    void FindInForest(const Forest &forest, const Point<Leaf,T,Dims> &point, unsigned nPoints, std::vector<Point<Leaf,T,Dims> > &closestPoints) const
+                    {
+                        using Nodes = std::decay_t<decltype(*std::begin(forest))>;
+                        closestPoints.clear();
+                        if (nPoints == 0)
+                            return;
+
+                        CandidateQueue<Nodes> candidates(nPoints);
+                        std::size_t nVisited = 0;
+                        AcceptAll acceptAll;
+                        ExactSearch exact;
+                        for (const Nodes &nodes : forest)
+                        {
+                            if (nodes.IsEmpty())
+                                continue;
+
+                            CellDistance<T,Dims,Distance> cell;
+                            FindNClosestPoints(nodes,nodes.GetRootIndex(),point,cell,candidates,nVisited,acceptAll,exact);
                         }
+                        Collect<Nodes>(candidates,closestPoints);
                     }
             };
 
@@ -329,37 +838,98 @@
             class DistanceFinder
             {
                 private:
-                    void FindWithinDistance(const std::shared_ptr<Node<Leaf,T,Dims,Distance> > &node, const Point<Leaf,T,Dims> &point, std::vector<Point<Leaf,T,Dims> > &closestPoints, T distance) noexcept
+                    template <typename Nodes>
+                    void FindWithinDistance(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, CellDistance<T,Dims,Distance> &cell, std::vector<Point<Leaf,T,Dims> > &closestPoints, T distance) const noexcept
                     {
-                        if (node->IsSplit())
+                        const auto &node = nodes[index];
+                        if (node.IsSplit())
                         {
-                            FindWithinDistance(node->GetChild(point), point, closestPoints, distance);
-                            auto distToMedian = node->CalculateDistanceToMedian(point);
+                            KDTREE_COUNT(nodesVisited,1);
+                            FindWithinDistance(nodes, node.GetChildIndex(point), point, cell, closestPoints, distance);
+                            const auto distToMedian = node.CalculateDistanceToMedian(point);
+                            const auto distToCell = cell.GetFarSide(node.GetDimensionIndex(),distToMedian);
                             
-                            if (distToMedian < distance)
-                                FindWithinDistance(node->GetOtherChild(point), point, closestPoints, distance);
+                            if (distToCell <= distance) // points exactly at the distance are also within it
+                                cell.VisitFarSide(node.GetDimensionIndex(),distToMedian,distToCell,[&]()
+                                {
+                                    FindWithinDistance(nodes, node.GetOtherChildIndex(point), point, cell, closestPoints, distance);
+                                });
+                            else
+                                KDTREE_COUNT(prunedSubtrees,1);
                         }
                         else
                         {
-                            auto newClosestPoints = node->FindWithinDistance(point,distance);
-                            closestPoints.insert(closestPoints.end(),newClosestPoints.begin(),newClosestPoints.end());
+                            KDTREE_COUNT(leavesScanned,1);
+                            KDTREE_COUNT(distanceEvaluations,node.size());
+                            node.FindWithinDistance(point,distance,closestPoints);
                         }
                     }
-                    template <typename Cond>
-                    void FindWithinDistanceIf(const std::shared_ptr<Node<Leaf,T,Dims,Distance> > &node, const Point<Leaf,T,Dims> &point, std::vector<Point<Leaf,T,Dims> > &closestPoints, T distance, Cond cond) noexcept
+                    template <typename Nodes, typename Cond>
+                    void FindWithinDistanceIf(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, CellDistance<T,Dims,Distance> &cell, std::vector<Point<Leaf,T,Dims> > &closestPoints, T distance, Cond &cond) const noexcept
+                    {
+                        const auto &node = nodes[index];
+                        if (node.IsSplit())
+                        {
+                            KDTREE_COUNT(nodesVisited,1);
+                            FindWithinDistanceIf(nodes, node.GetChildIndex(point), point, cell, closestPoints, distance, cond);
+                            const auto distToMedian = node.CalculateDistanceToMedian(point);
+                            const auto distToCell = cell.GetFarSide(node.GetDimensionIndex(),distToMedian);
+                            
+                            if (distToCell <= distance) // points exactly at the distance are also within it
+                                cell.VisitFarSide(node.GetDimensionIndex(),distToMedian,distToCell,[&]()
+                                {
+                                    FindWithinDistanceIf(nodes, node.GetOtherChildIndex(point), point, cell, closestPoints, distance, cond);
+                                });
+                            else
+                                KDTREE_COUNT(prunedSubtrees,1);
+                        }
+                        else
+                        {
+                            KDTREE_COUNT(leavesScanned,1);
+                            KDTREE_COUNT(distanceEvaluations,node.size());
+                            const auto &bucket = node.GetBucket();
+                            node.ForEachDistance(point,[&](std::size_t i, T dist)
+                            {
+                                if (dist <= distance)
+                                {
+                                    auto p = bucket.GetPoint(i);
+                                    if (cond(p,point))
+                                        closestPoints.push_back(std::move(p));
+                                }
+                            });
+                        }
+                    }
+
+                    // func(bucket,nodeIndex,position,distance) is called for every point within distance
+                    template <typename Nodes, typename Func>
+                    void ForEachWithinDistance(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, CellDistance<T,Dims,Distance> &cell, T distance, Func &func) const
                     {
-                        if (node->IsSplit())
+                        const auto &node = nodes[index];
+                        if (node.IsSplit())
                         {
-                            FindWithinDistanceIf<Cond>(node->GetChild(point), point, closestPoints, distance, cond);
-                            auto distToMedian = node->CalculateDistanceToMedian(point);
+                            KDTREE_COUNT(nodesVisited,1);
+                            ForEachWithinDistance(nodes, node.GetChildIndex(point), point, cell, distance, func);
+                            const auto distToMedian = node.CalculateDistanceToMedian(point);
+                            const auto distToCell = cell.GetFarSide(node.GetDimensionIndex(),distToMedian);
                             
-                            if (distToMedian < distance)
-                                FindWithinDistanceIf<Cond>(node->GetOtherChild(point), point, closestPoints, distance, cond);
+                            if (distToCell <= distance) // points exactly at the distance are also within it
+                                cell.VisitFarSide(node.GetDimensionIndex(),distToMedian,distToCell,[&]()
+                                {
+                                    ForEachWithinDistance(nodes, node.GetOtherChildIndex(point), point, cell, distance, func);
+                                });
+                            else
+                                KDTREE_COUNT(prunedSubtrees,1);
                         }
                         else
                         {
-                            auto newClosestPoints = node->FindWithinDistance(point,distance);
-                            std::copy_if(newClosestPoints.begin(),newClosestPoints.end(),std::back_inserter(closestPoints),[&point,&cond](const Point<Leaf,T,Dims> &p){return cond(p,point);});
+                            KDTREE_COUNT(leavesScanned,1);
+                            KDTREE_COUNT(distanceEvaluations,node.size());
+                            const auto &bucket = node.GetBucket();
+                            node.ForEachDistance(point,[&](std::size_t i, T dist)
+                            {
+                                if (dist <= distance)
+                                    func(bucket,index,i,dist);
+                            });
                         }
                     }
 
@@ -367,48 +937,424 @@
                     /**
                      * @brief Find all points withing given distance.
                      * 
-                     * @param node starting node (top of the tree)
+                     * @tparam Nodes array holding the tree (NodeArray or FrozenNodeArray)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
                      * @param point point to match agains
                      * @param distance maximum distance
                      * @return a vector of all points within given distance 
-                     * @throws runtime_error if node is nullptr
+                     * @throws runtime_error if node index is out of range
                      */
-                    std::vector<Point<Leaf,T,Dims> > Find(const std::shared_ptr<Node<Leaf,T,Dims,Distance> > &node, const Point<Leaf,T,Dims> &point, T distance)
+                    template <typename Nodes>
+                    std::vector<Point<Leaf,T,Dims> > Find(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, T distance) const
                     {
-                        if (node != nullptr)
+                        std::vector<Point<Leaf,T,Dims> > closestPoints;
+                        Find(nodes,index,point,distance,closestPoints);
+                        return closestPoints;
+                    }
+                    /**
+                     * @brief Find all points withing given distance and append them to a caller-provided buffer
+                     * 
+                     * @tparam Nodes array holding the tree (NodeArray or FrozenNodeArray)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
+                     * @param point point to match agains
+                     * @param distance maximum distance
+                     * @param closestPoints buffer to which all points within given distance are appended
+                     * @throws runtime_error if node index is out of range
+                     */
+                    template <typename Nodes>
+                    void Find(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, T distance, std::vector<Point<Leaf,T,Dims> > &closestPoints) const
+                    {
+                        if (nodes.IsValidIndex(index))
                         {
-                            std::vector<Point<Leaf,T,Dims> > closestPoints;
-                            FindWithinDistance(node,point,closestPoints,distance);
-                            return closestPoints;
+                            CellDistance<T,Dims,Distance> cell;
+                            FindWithinDistance(nodes,index,point,cell,closestPoints,distance);
                         }
                         else
                         {
-                            throw std::runtime_error("DistanceFinder::Find - Node is nullptr");
+                            throw std::runtime_error("DistanceFinder::Find - Node index is out of range");
                         }
                     }
                     /**
                      * @brief Find all points withing given distance for which condition cond is true
                      * 
+                     * @tparam Nodes array holding the tree (NodeArray or FrozenNodeArray)
                      * @tparam Cond function of signature (Point,Point) -> bool
-                     * @param node starting node (top of the tree)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
                      * @param point point to match agains
                      * @param distance maximum distance
                      * @param cond binary predicate which returns ​true for the required elements
                      * @return a vector of all points within given distance 
-                     * @throws runtime_error if node is nullptr
+                     * @throws runtime_error if node index is out of range
                      */
-                    template <typename Cond>
-                    std::vector<Point<Leaf,T,Dims> > FindIf(const std::shared_ptr<Node<Leaf,T,Dims,Distance> > &node, const Point<Leaf,T,Dims> &point, T distance, Cond cond)
+                    template <typename Nodes, typename Cond>
+                    std::vector<Point<Leaf,T,Dims> > FindIf(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, T distance, Cond cond) const
                     {
-                        if (node != nullptr)
+                        if (nodes.IsValidIndex(index))
                         {
                             std::vector<Point<Leaf,T,Dims> > closestPoints;
-                            FindWithinDistanceIf<Cond>(node,point,closestPoints,distance,cond);
+                            CellDistance<T,Dims,Distance> cell;
+                            FindWithinDistanceIf(nodes,index,point,cell,closestPoints,distance,cond);
                             return closestPoints;
                         }
                         else
                         {
-                            throw std::runtime_error("DistanceFinder::FindIf - Node is nullptr");
+                            throw std::runtime_error("DistanceFinder::FindIf - Node index is out of range");
+                        }
+                    }
+                    /**
+                     * @brief Call func for every point within given distance, without copying the points
+                     * 
+                     * @tparam Nodes array holding the tree (NodeArray or FrozenNodeArray)
+                     * @tparam Func function of signature (const Leaf&, const std::array<T,Dims>&, T) -> void, called with the object, the coordinates and the distance of each point
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
+                     * @param point point to match agains
+                     * @param distance maximum distance
+                     * @param func function to call
+                     * @throws runtime_error if node index is out of range
+                     */
+                    template <typename Nodes, typename Func>
+                    void ForEach(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, T distance, Func func) const
+                    {
+                        if (nodes.IsValidIndex(index))
+                        {
+                            CellDistance<T,Dims,Distance> cell;
+                            auto visit = [&func](const typename Nodes::BucketType &bucket, std::uint32_t, std::size_t i, T dist){func(bucket.GetObject(i),bucket.GetCoordinates(i),dist);};
+                            ForEachWithinDistance(nodes,index,point,cell,distance,visit);
+                        }
+                        else
+                        {
+                            throw std::runtime_error("DistanceFinder::ForEach - Node index is out of range");
+                        }
+                    }
+                    /**
+                     * @brief Find the locations of all points withing given distance and append them with their distances to caller-provided buffers, without copying the points
+                     * 
+                     * @tparam Nodes array holding the tree (NodeArray or FrozenNodeArray)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
+                     * @param point point to match agains
+                     * @param distance maximum distance
+                     * @param locations buffer to which the locations of all points within given distance are appended
+                     * @param distances buffer to which their distances are appended
+                     * @throws runtime_error if node index is out of range
+                     */
+                    template <typename Nodes>
+                    void FindLocations(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, T distance, std::vector<PointLocation> &locations, std::vector<T> &distances) const
+                    {
+                        if (nodes.IsValidIndex(index))
+                        {
+                            CellDistance<T,Dims,Distance> cell;
+                            auto collect = [&locations,&distances](const typename Nodes::BucketType&, std::uint32_t nodeIndex, std::size_t i, T dist)
+                            {
+                                locations.push_back({nodeIndex,static_cast<std::uint32_t>(i)});
+                                distances.push_back(dist);
+                            };
+                            ForEachWithinDistance(nodes,index,point,cell,distance,collect);
+                        }
+                        else
+                        {
+                            throw std::runtime_error("DistanceFinder::FindLocations - Node index is out of range");
+                        }
+                    }
+            };
+
+            /**
+             * @brief Finder object. It finds all points inside an axis-aligned box.
+             * 
+             * @tparam Leaf Object type that will be stored in leafs 
+             * @tparam T Arithmetic type of point coordinates
+             * @tparam Dims Number of dimensions over which the data will be divided 
+             * @tparam Distance Metric upon which the distance will be calculated 
+             */
+            template <typename Leaf, typename T , std::size_t Dims, typename Distance>
+            class BoxFinder
+            {
+                private:
+                    template <typename Nodes>
+                    void AppendSubtree(const Nodes &nodes, std::uint32_t index, std::vector<Point<Leaf,T,Dims> > &foundPoints) const
+                    {
+                        const auto &node = nodes[index];
+                        if (node.IsSplit())
+                        {
+                            AppendSubtree(nodes,node.GetLeftIndex(),foundPoints);
+                            AppendSubtree(nodes,node.GetRightIndex(),foundPoints);
+                        }
+                        else
+                        {
+                            const auto &bucket = node.GetBucket();
+                            for (std::size_t i = 0; i < bucket.size(); ++i)
+                                foundPoints.push_back(bucket.GetPoint(i));
+                        }
+                    }
+                    template <typename Nodes>
+                    void FindInBox(const Nodes &nodes, std::uint32_t index, const std::array<T,Dims> &lower, const std::array<T,Dims> &upper, CellBounds<T,Dims> &bounds, std::vector<Point<Leaf,T,Dims> > &foundPoints) const
+                    {
+                        const auto &node = nodes[index];
+                        if (bounds.IsInBox(lower,upper)) // no point of the subtree has to be checked
+                        {
+                            AppendSubtree(nodes,index,foundPoints);
+                        }
+                        else if (node.IsSplit())
+                        {
+                            KDTREE_COUNT(nodesVisited,1);
+                            const std::size_t dim = node.GetDimensionIndex();
+                            if (lower[dim] <= node.GetMedian())
+                                bounds.VisitChild(dim,node.GetMedian(),true,[&](){FindInBox(nodes,node.GetLeftIndex(),lower,upper,bounds,foundPoints);});
+                            else
+                                KDTREE_COUNT(prunedSubtrees,1);
+
+                            if (upper[dim] >= node.GetMedian())
+                                bounds.VisitChild(dim,node.GetMedian(),false,[&](){FindInBox(nodes,node.GetRightIndex(),lower,upper,bounds,foundPoints);});
+                            else
+                                KDTREE_COUNT(prunedSubtrees,1);
+                        }
+                        else
+                        {
+                            KDTREE_COUNT(leavesScanned,1);
+                            const auto &bucket = node.GetBucket();
+                            for (std::size_t i = 0; i < bucket.size(); ++i)
+                                if (IsInBox(bucket,i,lower,upper))
+                                    foundPoints.push_back(bucket.GetPoint(i));
+                        }
+                    }
+
+                public:
+                    /**
+                     * @brief Check whether the i-th point of bucket lies inside the box [lower,upper]
+                     * 
+                     */
+                    template <typename BucketType>
+                    [[nodiscard]] static bool IsInBox(const BucketType &bucket, std::size_t i, const std::array<T,Dims> &lower, const std::array<T,Dims> &upper) noexcept
+                    {
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                        {
+                            const T x = bucket.GetCoordinate(i,dim);
+                            if (x < lower[dim] || x > upper[dim])
+                                return false;
+                        }
+
+                        return true;
+                    }
+                    /**
+                     * @brief Find all points inside the box [lower,upper] (the bounds are inclusive). The subtrees whose cell lies inside the box are copied without checking their points.
+                     * 
+                     * @tparam Nodes array holding the tree (NodeArray)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
+                     * @param lower lowest corner of the box
+                     * @param upper highest corner of the box
+                     * @return a vector of all points inside the box
+                     * @throws runtime_error if node index is out of range
+                     */
+                    template <typename Nodes>
+                    std::vector<Point<Leaf,T,Dims> > Find(const Nodes &nodes, std::uint32_t index, const std::array<T,Dims> &lower, const std::array<T,Dims> &upper) const
+                    {
+                        if (nodes.IsValidIndex(index))
+                        {
+                            std::vector<Point<Leaf,T,Dims> > foundPoints;
+                            CellBounds<T,Dims> bounds = (index == nodes.GetRootIndex()) ? CellBounds<T,Dims>(nodes.GetBounds()) : CellBounds<T,Dims>();
+                            FindInBox(nodes,index,lower,upper,bounds,foundPoints);
+                            return foundPoints;
+                        }
+                        else
+                        {
+                            throw std::runtime_error("BoxFinder::Find - Node index is out of range");
+                        }
+                    }
+            };
+
+            /**
+             * @brief Counter object. It counts the points of a tree lying in a region without copying them: whenever the region contains the whole cell of a subtree, all its points are counted at once from the cached subtree size (see Node::GetSubtreeSize).
+             * 
+             * @tparam Leaf Object type that will be stored in leafs 
+             * @tparam T Arithmetic type of point coordinates
+             * @tparam Dims Number of dimensions over which the data will be divided 
+             * @tparam Distance Metric upon which the distance will be calculated 
+             */
+            template <typename Leaf, typename T , std::size_t Dims, typename Distance>
+            class Counter
+            {
+                private:
+                    template <typename Nodes>
+                    std::size_t CountBelowImpl(const Nodes &nodes, std::uint32_t index, std::size_t dim, T value) const noexcept
+                    {
+                        const auto &node = nodes[index];
+                        if (node.IsSplit())
+                        {
+                            if (node.GetDimensionIndex() != dim)
+                                return CountBelowImpl(nodes,node.GetLeftIndex(),dim,value) + CountBelowImpl(nodes,node.GetRightIndex(),dim,value);
+                            else if (value <= node.GetMedian()) // the right child holds only points at or above the median
+                                return CountBelowImpl(nodes,node.GetLeftIndex(),dim,value);
+                            else // the left child holds only points at or below the median
+                                return nodes[node.GetLeftIndex()].GetSubtreeSize() + CountBelowImpl(nodes,node.GetRightIndex(),dim,value);
+                        }
+                        else
+                        {
+                            const auto &bucket = node.GetBucket();
+                            std::size_t count = 0;
+                            for (std::size_t i = 0; i < bucket.size(); ++i)
+                                if (bucket.GetCoordinate(i,dim) < value)
+                                    ++count;
+
+                            return count;
+                        }
+                    }
+                    template <typename Nodes>
+                    std::size_t CountWithinDistanceImpl(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, CellDistance<T,Dims,Distance> &cell, CellBounds<T,Dims> &bounds, T distance) const noexcept
+                    {
+                        const auto &node = nodes[index];
+                        if (bounds.template IsWithinDistance<Distance>(point.coords,distance))
+                        {
+                            return node.GetSubtreeSize();
+                        }
+                        else if (node.IsSplit())
+                        {
+                            KDTREE_COUNT(nodesVisited,1);
+                            const std::size_t dim = node.GetDimensionIndex();
+                            const std::uint32_t nearIndex = node.GetChildIndex(point);
+                            const bool nearIsLeft = (nearIndex == node.GetLeftIndex());
+                            std::size_t count = 0;
+                            bounds.VisitChild(dim,node.GetMedian(),nearIsLeft,[&](){count += CountWithinDistanceImpl(nodes,nearIndex,point,cell,bounds,distance);});
+
+                            const auto distToMedian = node.CalculateDistanceToMedian(point);
+                            const auto distToCell = cell.GetFarSide(dim,distToMedian);
+                            if (distToCell <= distance)
+                                cell.VisitFarSide(dim,distToMedian,distToCell,[&]()
+                                {
+                                    bounds.VisitChild(dim,node.GetMedian(),!nearIsLeft,[&](){count += CountWithinDistanceImpl(nodes,node.GetOtherChildIndex(point),point,cell,bounds,distance);});
+                                });
+                            else
+                                KDTREE_COUNT(prunedSubtrees,1);
+
+                            return count;
+                        }
+                        else
+                        {
+                            KDTREE_COUNT(leavesScanned,1);
+                            KDTREE_COUNT(distanceEvaluations,node.size());
+                            std::size_t count = 0;
+                            node.ForEachDistance(point,[&count,distance](std::size_t, T dist)
+                            {
+                                if (dist <= distance)
+                                    ++count;
+                            });
+
+                            return count;
+                        }
+                    }
+                    template <typename Nodes>
+                    std::size_t CountInBoxImpl(const Nodes &nodes, std::uint32_t index, const std::array<T,Dims> &lower, const std::array<T,Dims> &upper, CellBounds<T,Dims> &bounds) const noexcept
+                    {
+                        const auto &node = nodes[index];
+                        if (bounds.IsInBox(lower,upper))
+                        {
+                            return node.GetSubtreeSize();
+                        }
+                        else if (node.IsSplit())
+                        {
+                            KDTREE_COUNT(nodesVisited,1);
+                            const std::size_t dim = node.GetDimensionIndex();
+                            std::size_t count = 0;
+                            if (lower[dim] <= node.GetMedian())
+                                bounds.VisitChild(dim,node.GetMedian(),true,[&](){count += CountInBoxImpl(nodes,node.GetLeftIndex(),lower,upper,bounds);});
+                            else
+                                KDTREE_COUNT(prunedSubtrees,1);
+
+                            if (upper[dim] >= node.GetMedian())
+                                bounds.VisitChild(dim,node.GetMedian(),false,[&](){count += CountInBoxImpl(nodes,node.GetRightIndex(),lower,upper,bounds);});
+                            else
+                                KDTREE_COUNT(prunedSubtrees,1);
+
+                            return count;
+                        }
+                        else
+                        {
+                            KDTREE_COUNT(leavesScanned,1);
+                            const auto &bucket = node.GetBucket();
+                            std::size_t count = 0;
+                            for (std::size_t i = 0; i < bucket.size(); ++i)
+                                if (BoxFinder<Leaf,T,Dims,Distance>::IsInBox(bucket,i,lower,upper))
+                                    ++count;
+
+                            return count;
+                        }
+                    }
+
+                public:
+                    /**
+                     * @brief Count the points whose coordinate along dim is smaller than value (the rank of value along dim)
+                     * 
+                     * @tparam Nodes array holding the tree (NodeArray)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
+                     * @param dim dimension along which the points are compared
+                     * @param value coordinate to compare with
+                     * @return std::size_t 
+                     * @throws runtime_error if node index or dimension is out of range
+                     */
+                    template <typename Nodes>
+                    std::size_t CountBelow(const Nodes &nodes, std::uint32_t index, std::size_t dim, T value) const
+                    {
+                        if (nodes.IsValidIndex(index) && dim < Dims)
+                        {
+                            return CountBelowImpl(nodes,index,dim,value);
+                        }
+                        else
+                        {
+                            throw std::runtime_error("Counter::CountBelow - Node index or dimension is out of range");
+                        }
+                    }
+                    /**
+                     * @brief Count the points within given distance. The subtrees whose whole cell lies within the distance are counted from their cached sizes.
+                     * 
+                     * @tparam Nodes array holding the tree (NodeArray)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
+                     * @param point point to match against
+                     * @param distance maximum distance
+                     * @return std::size_t 
+                     * @throws runtime_error if node index is out of range
+                     */
+                    template <typename Nodes>
+                    std::size_t CountWithinDistance(const Nodes &nodes, std::uint32_t index, const Point<Leaf,T,Dims> &point, T distance) const
+                    {
+                        if (nodes.IsValidIndex(index))
+                        {
+                            CellDistance<T,Dims,Distance> cell;
+                            CellBounds<T,Dims> bounds = (index == nodes.GetRootIndex()) ? CellBounds<T,Dims>(nodes.GetBounds()) : CellBounds<T,Dims>();
+                            return CountWithinDistanceImpl(nodes,index,point,cell,bounds,distance);
+                        }
+                        else
+                        {
+                            throw std::runtime_error("Counter::CountWithinDistance - Node index is out of range");
+                        }
+                    }
+                    /**
+                     * @brief Count the points inside the box [lower,upper] (the bounds are inclusive). The subtrees whose whole cell lies inside the box are counted from their cached sizes.
+                     * 
+                     * @tparam Nodes array holding the tree (NodeArray)
+                     * @param nodes array holding the tree
+                     * @param index starting node index (top of the tree)
+                     * @param lower lowest corner of the box
+                     * @param upper highest corner of the box
+                     * @return std::size_t 
+                     * @throws runtime_error if node index is out of range
+                     */
+                    template <typename Nodes>
+                    std::size_t CountInBox(const Nodes &nodes, std::uint32_t index, const std::array<T,Dims> &lower, const std::array<T,Dims> &upper) const
+                    {
+                        if (nodes.IsValidIndex(index))
+                        {
+                            CellBounds<T,Dims> bounds = (index == nodes.GetRootIndex()) ? CellBounds<T,Dims>(nodes.GetBounds()) : CellBounds<T,Dims>();
+                            return CountInBoxImpl(nodes,index,lower,upper,bounds);
+                        }
+                        else
+                        {
+                            throw std::runtime_error("Counter::CountInBox - Node index is out of range");
                         }
                     }
             };
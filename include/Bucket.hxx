@@ -0,0 +1,571 @@
+#ifndef Bucket_hxx
+    #define Bucket_hxx
+
+    #include <array>
+    #include <cstddef>
+    #include <cstdint>
+    #include <limits>
+    #include <iterator>
+    #include <memory_resource>
+    #include <optional>
+    #include <stdexcept>
+    #include <type_traits>
+    #include <utility>
+    #include <vector>
+
+    #include "Metrics.hxx"
+
+    namespace JJDataStruct
+    {
+        namespace KDTree
+        {
+            /**
+             * @brief Index value used to mark a missing node (no parent, no children) or a point without a handle
+             *
+             */
+            inline constexpr std::uint32_t InvalidIndex = std::numeric_limits<std::uint32_t>::max();
+
+            /**
+             * @brief Points stored in a leaf node, kept as a structure of arrays: one contiguous array per coordinate and a parallel array of the Leaf-type objects.
+             * Distance scans only walk the coordinate arrays, the objects are touched only when a found point is turned back into a Point. The i-th point of the bucket is made of the i-th element of every array.
+             * Next to every point the bucket keeps the index of its handle (see PointHandle), or InvalidIndex if nobody holds one.
+             * All the arrays are allocated from one std::pmr::memory_resource, which a bucket keeps for its whole life (assignments do not change it, a copy made without an allocator uses the default resource).
+             *
+             * @tparam Leaf Object type that will be stored in leafs
+             * @tparam T Arithmetic type of point coordinates
+             * @tparam Dims Number of dimensions
+             */
+            template <typename Leaf, typename T , std::size_t Dims>
+            class Bucket
+            {
+                public:
+                    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+                private:
+                    std::array<std::pmr::vector<T>,Dims> m_coords;
+                    std::pmr::vector<Leaf> m_objects;
+                    std::pmr::vector<std::uint32_t> m_handles;
+
+                    template <std::size_t... Dim>
+                    static std::array<std::pmr::vector<T>,Dims> MakeColumns(const allocator_type &alloc, std::index_sequence<Dim...>)
+                    {
+                        return {((void)Dim,std::pmr::vector<T>(alloc))...};
+                    }
+                    /**
+                     * @brief Leave the bucket empty and give its memory back to the memory resource
+                     *
+                     */
+                    void ReleaseMemory() noexcept
+                    {
+                        for (auto &column : m_coords)
+                        {
+                            column.clear();
+                            column.shrink_to_fit();
+                        }
+                        m_objects.clear();
+                        m_objects.shrink_to_fit();
+                        m_handles.clear();
+                        m_handles.shrink_to_fit();
+                    }
+
+                public:
+                    /**
+                     * @brief Construct a new empty Bucket object using the default memory resource
+                     *
+                     */
+                    Bucket() : Bucket(allocator_type()) {}
+                    /**
+                     * @brief Construct a new empty Bucket object
+                     *
+                     * @param alloc allocator of the memory resource from which the points are allocated
+                     */
+                    explicit Bucket(const allocator_type &alloc) : m_coords(MakeColumns(alloc,std::make_index_sequence<Dims>())), m_objects(alloc), m_handles(alloc) {}
+                    /**
+                     * @brief Construct a new Bucket object holding points
+                     *
+                     * @param points points to be stored
+                     * @param alloc allocator of the memory resource from which the points are allocated
+                     */
+                    explicit Bucket(std::vector<Point<Leaf,T,Dims> > &&points, const allocator_type &alloc = {}) : Bucket(alloc)
+                    {
+                        Assign(std::make_move_iterator(points.begin()),std::make_move_iterator(points.end()));
+                    }
+                    Bucket(const Bucket &other) = default;
+                    Bucket(Bucket &&other) = default;
+                    /**
+                     * @brief Construct a new Bucket object holding a copy of the points of other, allocated with alloc
+                     *
+                     */
+                    Bucket(const Bucket &other, const allocator_type &alloc) : m_coords(MakeColumns(alloc,std::make_index_sequence<Dims>())), m_objects(other.m_objects,alloc), m_handles(other.m_handles,alloc)
+                    {
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            m_coords[dim] = other.m_coords[dim];
+                    }
+                    /**
+                     * @brief Construct a new Bucket object holding the points of other, allocated with alloc (the memory is taken over if other uses the same memory resource)
+                     *
+                     */
+                    Bucket(Bucket &&other, const allocator_type &alloc) : m_coords(MakeColumns(alloc,std::make_index_sequence<Dims>())), m_objects(std::move(other.m_objects),alloc), m_handles(std::move(other.m_handles),alloc)
+                    {
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            m_coords[dim] = std::move(other.m_coords[dim]);
+                    }
+                    Bucket& operator=(const Bucket &other) = default;
+                    Bucket& operator=(Bucket &&other) = default;
+                    /**
+                     * @brief Replace the content of the bucket with points from [first,last)
+                     *
+                     * @tparam InputIt input iterator over Point<Leaf,T,Dims> (use std::move_iterator to move the objects in)
+                     * @param first beginning of the range of points
+                     * @param last end of the range of points
+                     */
+                    template <typename InputIt>
+                    void Assign(InputIt first, InputIt last)
+                    {
+                        Clear();
+                        if constexpr (std::is_base_of_v<std::forward_iterator_tag,typename std::iterator_traits<InputIt>::iterator_category>)
+                            Reserve(static_cast<std::size_t>(std::distance(first,last)));
+
+                        for (; first != last; ++first)
+                            PushBack(*first);
+                    }
+                    /**
+                     * @brief Add a point at the end
+                     *
+                     * @param point point to be added
+                     * @param handleIndex index of the handle of the point (InvalidIndex if it has none)
+                     */
+                    void PushBack(Point<Leaf,T,Dims> &&point, std::uint32_t handleIndex = InvalidIndex)
+                    {
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            m_coords[dim].push_back(point.coords[dim]);
+                        m_objects.push_back(std::move(point.object));
+                        m_handles.push_back(handleIndex);
+                    }
+                    void PushBack(const Point<Leaf,T,Dims> &point, std::uint32_t handleIndex = InvalidIndex)
+                    {
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            m_coords[dim].push_back(point.coords[dim]);
+                        m_objects.push_back(point.object);
+                        m_handles.push_back(handleIndex);
+                    }
+                    /**
+                     * @brief Move all the points of other to the end of this bucket and leave other empty
+                     *
+                     * @param other bucket to take the points from
+                     */
+                    void Append(Bucket &&other)
+                    {
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            m_coords[dim].insert(m_coords[dim].end(),other.m_coords[dim].begin(),other.m_coords[dim].end());
+                        m_objects.insert(m_objects.end(),std::make_move_iterator(other.m_objects.begin()),std::make_move_iterator(other.m_objects.end()));
+                        m_handles.insert(m_handles.end(),other.m_handles.begin(),other.m_handles.end());
+                        other.ReleaseMemory();
+                    }
+                    /**
+                     * @brief Copy all the points of other to the end of this bucket (the copies have no handles)
+                     *
+                     * @tparam Other any bucket type (Bucket, FixedBucket, PackedPoints)
+                     * @param other bucket to copy the points from
+                     */
+                    template <typename Other>
+                    void Append(const Other &other)
+                    {
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            m_coords[dim].insert(m_coords[dim].end(),other.GetColumn(dim),other.GetColumn(dim) + other.size());
+                        m_objects.insert(m_objects.end(),other.GetObjects(),other.GetObjects() + other.size());
+                        m_handles.insert(m_handles.end(),other.size(),InvalidIndex);
+                    }
+                    /**
+                     * @brief Move all the points to the end of out and leave the bucket empty
+                     *
+                     * @param out vector to which the points are appended
+                     */
+                    void MoveTo(std::vector<Point<Leaf,T,Dims> > &out)
+                    {
+                        out.reserve(out.size() + size());
+                        for (std::size_t i = 0; i < size(); ++i)
+                            out.push_back({std::move(m_objects[i]),GetCoordinates(i)});
+
+                        ReleaseMemory();
+                    }
+                    /**
+                     * @brief Move all the points together with the indices of their handles to the end of out and leave the bucket empty
+                     *
+                     * @param out vector to which the pairs of point and handle index are appended
+                     */
+                    void MoveTo(std::vector<std::pair<Point<Leaf,T,Dims>,std::uint32_t> > &out)
+                    {
+                        out.reserve(out.size() + size());
+                        for (std::size_t i = 0; i < size(); ++i)
+                            out.emplace_back(Point<Leaf,T,Dims>{std::move(m_objects[i]),GetCoordinates(i)},m_handles[i]);
+
+                        ReleaseMemory();
+                    }
+                    /**
+                     * @brief Find the position of a point. Uses operator== of the stored Leaf-type object
+                     *
+                     * @param point point to look for
+                     * @return position of the first equal point or std::nullopt if there is none
+                     */
+                    [[nodiscard]] std::optional<std::size_t> Find(const Point<Leaf,T,Dims> &point)
+                    {
+                        for (std::size_t i = 0; i < m_objects.size(); ++i)
+                            if (m_objects[i] == point.object)
+                                return i;
+
+                        return std::nullopt;
+                    }
+                    /**
+                     * @brief Remove the point at position i (the order of the other points is kept)
+                     *
+                     * @param i position of the point
+                     * @return the removed point
+                     */
+                    Point<Leaf,T,Dims> Erase(std::size_t i)
+                    {
+                        Point<Leaf,T,Dims> removed{std::move(m_objects[i]),GetCoordinates(i)};
+                        const auto offset = static_cast<std::ptrdiff_t>(i);
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            m_coords[dim].erase(m_coords[dim].begin() + offset);
+                        m_objects.erase(m_objects.begin() + offset);
+                        m_handles.erase(m_handles.begin() + offset);
+
+                        return removed;
+                    }
+                    /**
+                     * @brief Remove the point at position i in O(1) by moving the last point into its place
+                     *
+                     * @param i position of the point
+                     * @return the removed point
+                     */
+                    Point<Leaf,T,Dims> SwapErase(std::size_t i)
+                    {
+                        Point<Leaf,T,Dims> removed{std::move(m_objects[i]),GetCoordinates(i)};
+                        const std::size_t last = size() - 1;
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                        {
+                            m_coords[dim][i] = m_coords[dim][last];
+                            m_coords[dim].pop_back();
+                        }
+                        if (i != last)
+                            m_objects[i] = std::move(m_objects[last]);
+                        m_objects.pop_back();
+                        m_handles[i] = m_handles[last];
+                        m_handles.pop_back();
+
+                        return removed;
+                    }
+                    void Reserve(std::size_t capacity)
+                    {
+                        for (auto &column : m_coords)
+                            column.reserve(capacity);
+                        m_objects.reserve(capacity);
+                        m_handles.reserve(capacity);
+                    }
+                    void Clear() noexcept
+                    {
+                        for (auto &column : m_coords)
+                            column.clear();
+                        m_objects.clear();
+                        m_handles.clear();
+                    }
+                    /**
+                     * @brief Get a copy of the point at position i
+                     *
+                     */
+                    [[nodiscard]] Point<Leaf,T,Dims> GetPoint(std::size_t i) const {return {m_objects[i],GetCoordinates(i)};}
+                    /**
+                     * @brief Get copies of all the stored points
+                     *
+                     */
+                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > GetPoints() const
+                    {
+                        std::vector<Point<Leaf,T,Dims> > points;
+                        points.reserve(size());
+                        for (std::size_t i = 0; i < size(); ++i)
+                            points.push_back(GetPoint(i));
+
+                        return points;
+                    }
+                    [[nodiscard]] std::array<T,Dims> GetCoordinates(std::size_t i) const noexcept
+                    {
+                        std::array<T,Dims> coords;
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            coords[dim] = m_coords[dim][i];
+
+                        return coords;
+                    }
+                    [[nodiscard]] inline T GetCoordinate(std::size_t i, std::size_t dim) const noexcept {return m_coords[dim][i];}
+                    [[nodiscard]] inline const Leaf& GetObject(std::size_t i) const noexcept {return m_objects[i];}
+                    [[nodiscard]] inline std::uint32_t GetHandleIndex(std::size_t i) const noexcept {return m_handles[i];}
+                    /**
+                     * @brief Get the contiguous array of the dim-th coordinates of all the points
+                     *
+                     */
+                    [[nodiscard]] inline const T* GetColumn(std::size_t dim) const noexcept {return m_coords[dim].data();}
+                    /**
+                     * @brief Get the contiguous array of all the Leaf-type objects
+                     *
+                     */
+                    [[nodiscard]] inline const Leaf* GetObjects() const noexcept {return m_objects.data();}
+                    /**
+                     * @brief Call func(position,distance) for every point at positions [first,last), in order (see ForEachDistance in Metrics.hxx)
+                     *
+                     */
+                    template <typename Distance, typename Func>
+                    void ForEachDistance(std::size_t first, std::size_t last, const std::array<T,Dims> &query, Func &func) const
+                    {
+                        std::array<const T*,Dims> columns;
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            columns[dim] = GetColumn(dim);
+
+                        JJDataStruct::KDTree::ForEachDistance<Distance,T,Dims>(columns,first,last,query,func);
+                    }
+                    [[nodiscard]] inline std::size_t size() const noexcept {return m_objects.size();}
+                    [[nodiscard]] inline bool IsEmpty() const noexcept {return m_objects.empty();}
+                    [[nodiscard]] inline allocator_type get_allocator() const noexcept {return m_objects.get_allocator();}
+            };
+
+            /**
+             * @brief Points stored in a leaf node in arrays of fixed capacity kept inside the bucket itself (so inside the node), laid out the same way as in Bucket: one array per coordinate and a parallel array of the Leaf-type objects.
+             * Adding, removing, splitting and joining never allocates, at the price of every node (also a split one) taking room for Capacity points.
+             *
+             * @tparam Leaf Object type that will be stored in leafs (has to be default constructible)
+             * @tparam T Arithmetic type of point coordinates
+             * @tparam Dims Number of dimensions
+             * @tparam Capacity maximal number of points
+             */
+            template <typename Leaf, typename T , std::size_t Dims, std::size_t Capacity>
+            class FixedBucket
+            {
+                static_assert(Capacity > 0,"FixedBucket needs room for at least one point");
+                static_assert(std::is_default_constructible_v<Leaf>,"Only default constructible objects can be stored in a FixedBucket");
+
+                public:
+                    /**
+                     * @brief Accepted for the same interface as Bucket, nothing is ever allocated
+                     *
+                     */
+                    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+                private:
+                    std::array<std::array<T,Capacity>,Dims> m_coords;
+                    std::array<Leaf,Capacity> m_objects;
+                    std::array<std::uint32_t,Capacity> m_handles;
+                    std::size_t m_size;
+
+                    void Store(std::size_t i, const std::array<T,Dims> &coords, std::uint32_t handleIndex)
+                    {
+                        if (i >= Capacity)
+                            throw std::length_error("FixedBucket::PushBack - bucket is full");
+
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            m_coords[dim][i] = coords[dim];
+                        m_handles[i] = handleIndex;
+                    }
+
+                public:
+                    /**
+                     * @brief Construct a new empty FixedBucket object
+                     *
+                     */
+                    FixedBucket() : m_coords(), m_objects(), m_handles(), m_size(0) {}
+                    explicit FixedBucket(const allocator_type&) : FixedBucket() {}
+                    /**
+                     * @brief Construct a new FixedBucket object holding points
+                     *
+                     * @param points points to be stored
+                     * @throws std::length_error if there are more than Capacity points
+                     */
+                    explicit FixedBucket(std::vector<Point<Leaf,T,Dims> > &&points, const allocator_type& = {}) : FixedBucket()
+                    {
+                        Assign(std::make_move_iterator(points.begin()),std::make_move_iterator(points.end()));
+                    }
+                    FixedBucket(const FixedBucket &other) = default;
+                    FixedBucket(FixedBucket &&other) = default;
+                    FixedBucket(const FixedBucket &other, const allocator_type&) : FixedBucket(other) {}
+                    FixedBucket(FixedBucket &&other, const allocator_type&) : FixedBucket(std::move(other)) {}
+                    FixedBucket& operator=(const FixedBucket &other) = default;
+                    FixedBucket& operator=(FixedBucket &&other) = default;
+                    /**
+                     * @brief Replace the content of the bucket with points from [first,last)
+                     *
+                     * @throws std::length_error if there are more than Capacity points
+                     */
+                    template <typename InputIt>
+                    void Assign(InputIt first, InputIt last)
+                    {
+                        Clear();
+                        for (; first != last; ++first)
+                            PushBack(*first);
+                    }
+                    /**
+                     * @brief Add a point at the end
+                     *
+                     * @throws std::length_error if the bucket is full
+                     */
+                    void PushBack(Point<Leaf,T,Dims> &&point, std::uint32_t handleIndex = InvalidIndex)
+                    {
+                        Store(m_size,point.coords,handleIndex);
+                        m_objects[m_size++] = std::move(point.object);
+                    }
+                    void PushBack(const Point<Leaf,T,Dims> &point, std::uint32_t handleIndex = InvalidIndex)
+                    {
+                        Store(m_size,point.coords,handleIndex);
+                        m_objects[m_size++] = point.object;
+                    }
+                    /**
+                     * @brief Move all the points of other to the end of this bucket and leave other empty
+                     *
+                     * @throws std::length_error if they do not fit
+                     */
+                    void Append(FixedBucket &&other)
+                    {
+                        if (m_size + other.m_size > Capacity)
+                            throw std::length_error("FixedBucket::Append - too many points for the capacity");
+
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            std::copy(other.m_coords[dim].begin(),other.m_coords[dim].begin() + static_cast<std::ptrdiff_t>(other.m_size),m_coords[dim].begin() + static_cast<std::ptrdiff_t>(m_size));
+                        std::move(other.m_objects.begin(),other.m_objects.begin() + static_cast<std::ptrdiff_t>(other.m_size),m_objects.begin() + static_cast<std::ptrdiff_t>(m_size));
+                        std::copy(other.m_handles.begin(),other.m_handles.begin() + static_cast<std::ptrdiff_t>(other.m_size),m_handles.begin() + static_cast<std::ptrdiff_t>(m_size));
+                        m_size += other.m_size;
+                        other.Clear();
+                    }
+                    /**
+                     * @brief Move all the points to the end of out and leave the bucket empty
+                     *
+                     */
+                    void MoveTo(std::vector<Point<Leaf,T,Dims> > &out)
+                    {
+                        out.reserve(out.size() + m_size);
+                        for (std::size_t i = 0; i < m_size; ++i)
+                            out.push_back({std::move(m_objects[i]),GetCoordinates(i)});
+
+                        Clear();
+                    }
+                    /**
+                     * @brief Move all the points together with the indices of their handles to the end of out and leave the bucket empty
+                     *
+                     */
+                    void MoveTo(std::vector<std::pair<Point<Leaf,T,Dims>,std::uint32_t> > &out)
+                    {
+                        out.reserve(out.size() + m_size);
+                        for (std::size_t i = 0; i < m_size; ++i)
+                            out.emplace_back(Point<Leaf,T,Dims>{std::move(m_objects[i]),GetCoordinates(i)},m_handles[i]);
+
+                        Clear();
+                    }
+                    /**
+                     * @brief Find the position of a point. Uses operator== of the stored Leaf-type object
+                     *
+                     * @return position of the first equal point or std::nullopt if there is none
+                     */
+                    [[nodiscard]] std::optional<std::size_t> Find(const Point<Leaf,T,Dims> &point)
+                    {
+                        for (std::size_t i = 0; i < m_size; ++i)
+                            if (m_objects[i] == point.object)
+                                return i;
+
+                        return std::nullopt;
+                    }
+                    /**
+                     * @brief Remove the point at position i (the order of the other points is kept)
+                     *
+                     * @return the removed point
+                     */
+                    Point<Leaf,T,Dims> Erase(std::size_t i)
+                    {
+                        Point<Leaf,T,Dims> removed{std::move(m_objects[i]),GetCoordinates(i)};
+                        const auto offset = static_cast<std::ptrdiff_t>(i);
+                        const auto end = static_cast<std::ptrdiff_t>(m_size);
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            std::copy(m_coords[dim].begin() + offset + 1,m_coords[dim].begin() + end,m_coords[dim].begin() + offset);
+                        std::move(m_objects.begin() + offset + 1,m_objects.begin() + end,m_objects.begin() + offset);
+                        std::copy(m_handles.begin() + offset + 1,m_handles.begin() + end,m_handles.begin() + offset);
+                        m_objects[--m_size] = Leaf();
+
+                        return removed;
+                    }
+                    /**
+                     * @brief Remove the point at position i in O(1) by moving the last point into its place
+                     *
+                     * @return the removed point
+                     */
+                    Point<Leaf,T,Dims> SwapErase(std::size_t i)
+                    {
+                        Point<Leaf,T,Dims> removed{std::move(m_objects[i]),GetCoordinates(i)};
+                        const std::size_t last = --m_size;
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            m_coords[dim][i] = m_coords[dim][last];
+                        if (i != last)
+                            m_objects[i] = std::move(m_objects[last]);
+                        m_objects[last] = Leaf();
+                        m_handles[i] = m_handles[last];
+
+                        return removed;
+                    }
+                    /**
+                     * @brief Nothing to reserve, the capacity is fixed
+                     *
+                     */
+                    void Reserve(std::size_t) noexcept {}
+                    void Clear() noexcept
+                    {
+                        for (std::size_t i = 0; i < m_size; ++i)
+                            m_objects[i] = Leaf(); // do not keep the resources of removed objects alive
+                        m_size = 0;
+                    }
+                    [[nodiscard]] Point<Leaf,T,Dims> GetPoint(std::size_t i) const {return {m_objects[i],GetCoordinates(i)};}
+                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > GetPoints() const
+                    {
+                        std::vector<Point<Leaf,T,Dims> > points;
+                        points.reserve(m_size);
+                        for (std::size_t i = 0; i < m_size; ++i)
+                            points.push_back(GetPoint(i));
+
+                        return points;
+                    }
+                    [[nodiscard]] std::array<T,Dims> GetCoordinates(std::size_t i) const noexcept
+                    {
+                        std::array<T,Dims> coords;
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            coords[dim] = m_coords[dim][i];
+
+                        return coords;
+                    }
+                    [[nodiscard]] inline T GetCoordinate(std::size_t i, std::size_t dim) const noexcept {return m_coords[dim][i];}
+                    [[nodiscard]] inline const Leaf& GetObject(std::size_t i) const noexcept {return m_objects[i];}
+                    [[nodiscard]] inline std::uint32_t GetHandleIndex(std::size_t i) const noexcept {return m_handles[i];}
+                    [[nodiscard]] inline const T* GetColumn(std::size_t dim) const noexcept {return m_coords[dim].data();}
+                    [[nodiscard]] inline const Leaf* GetObjects() const noexcept {return m_objects.data();}
+                    /**
+                     * @brief Call func(position,distance) for every point at positions [first,last), in order (see ForEachDistance in Metrics.hxx)
+                     *
+                     */
+                    template <typename Distance, typename Func>
+                    void ForEachDistance(std::size_t first, std::size_t last, const std::array<T,Dims> &query, Func &func) const
+                    {
+                        std::array<const T*,Dims> columns;
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            columns[dim] = GetColumn(dim);
+
+                        JJDataStruct::KDTree::ForEachDistance<Distance,T,Dims>(columns,first,last,query,func);
+                    }
+                    [[nodiscard]] inline std::size_t size() const noexcept {return m_size;}
+                    [[nodiscard]] inline bool IsEmpty() const noexcept {return m_size == 0;}
+                    [[nodiscard]] inline static constexpr std::size_t capacity() noexcept {return Capacity;}
+            };
+
+            /**
+             * @brief Bucket type of the leaves: Bucket (growing, allocated from a memory resource) if Capacity is 0, otherwise FixedBucket of that capacity
+             *
+             */
+            template <typename Leaf, typename T , std::size_t Dims, std::size_t Capacity>
+            using SelectBucket = std::conditional_t<Capacity == 0,Bucket<Leaf,T,Dims>,FixedBucket<Leaf,T,Dims,Capacity> >;
+
+        } // namespace KDTree
+
+    } // namespace JJDataStruct
+
+#endif
@@ -0,0 +1,267 @@
+#ifndef ConcurrentKDTree_hxx
+    #define ConcurrentKDTree_hxx
+
+    #include <array>
+    #include <atomic>
+    #include <mutex>
+    #include <thread>
+
+    #include "KDTree.hxx"
+
+    namespace JJDataStruct
+    {
+        namespace KDTree
+        {
+            /**
+             * @brief K-Dimensional Tree which can be searched by many threads while a single thread modifies it.
+             * It keeps two copies of the tree (left-right concurrency control): readers always search the copy which is currently published, without taking any lock, while the writer modifies the other copy, publishes it, waits until no reader is left in the old copy (two alternating read epochs) and then repeats the modification there.
+             * Readers are never blocked and always see a consistent tree, writers are serialised by a mutex. The price is twice the memory and every modification being applied twice.
+             *
+             * @tparam Leaf Object type that will be stored in leafs
+             * @tparam Dims Number of dimensions over which the data will be divided
+             * @tparam T Arithmetic type of point coordinates
+             * @tparam Distance Metric upon which the distance will be calculated
+             */
+            template <typename Leaf, std::size_t Dims, typename T = double, typename Distance = SquaredDist>
+            class ConcurrentKDTree
+            {
+                private:
+                    static constexpr std::size_t ReaderSlots = 16; // readers are spread over several counters, so they do not all fight for one cache line
+
+                    struct alignas(64) ReaderCounter
+                    {
+                        std::atomic<std::int64_t> count{0};
+                    };
+                    using ReadIndicator = std::array<ReaderCounter,ReaderSlots>;
+
+                    std::array<KDTree<Leaf,Dims,T,Distance>,2> m_instances;
+                    std::atomic<unsigned> m_readIndex; // copy of the tree which readers use
+                    std::atomic<unsigned> m_epoch; // read indicator which new readers register in
+                    mutable std::array<ReadIndicator,2> m_readers;
+                    std::mutex m_writerMutex;
+                    bool m_isOutOfSync; // the copy which is not published missed a modification (guarded by m_writerMutex)
+
+                    [[nodiscard]] static std::size_t ReaderSlot() noexcept
+                    {
+                        return std::hash<std::thread::id>{}(std::this_thread::get_id()) % ReaderSlots;
+                    }
+                    [[nodiscard]] bool IsEmpty(const ReadIndicator &indicator) const noexcept
+                    {
+                        for (const auto &counter : indicator)
+                            if (counter.count.load() != 0)
+                                return false;
+
+                        return true;
+                    }
+                    void WaitForReaders(const ReadIndicator &indicator) const noexcept
+                    {
+                        while (!IsEmpty(indicator))
+                            std::this_thread::yield();
+                    }
+                    /**
+                     * @brief Switch new readers to the other read epoch and wait until all readers of the previous one are gone (so none of them can still be searching the copy which is about to be modified)
+                     *
+                     */
+                    void ToggleEpochAndWait() noexcept
+                    {
+                        const unsigned previous = m_epoch.load();
+                        const unsigned next = 1 - previous;
+                        WaitForReaders(m_readers[next]);
+                        m_epoch.store(next);
+                        WaitForReaders(m_readers[previous]);
+                    }
+                    /**
+                     * @brief Apply a modification to both copies of the tree, one at a time, while readers use the other one.
+                     * If the modification throws on the first copy, nothing is published and the exception is passed on; the copy is brought back in line with the published one by the next modification. 
+                     * If it throws on the second copy, the modification is already published, so the second copy is replaced with a copy of the published one instead (or by the next modification, if copying throws too).
+                     *
+                     * @tparam Func function of signature (KDTree&) -> R
+                     * @param func modification to apply
+                     * @return result of the modification of the first copy
+                     */
+                    template <typename Func>
+                    auto Write(Func func)
+                    {
+                        std::lock_guard<std::mutex> lock(m_writerMutex);
+
+                        const unsigned readIndex = m_readIndex.load();
+                        const unsigned writeIndex = 1 - readIndex;
+                        if (m_isOutOfSync)
+                        {
+                            m_instances[writeIndex] = m_instances[readIndex];
+                            m_isOutOfSync = false;
+                        }
+
+                        auto result = [&]()
+                        {
+                            try
+                            {
+                                return func(m_instances[writeIndex]);
+                            }
+                            catch (...)
+                            {
+                                m_isOutOfSync = true; // the copy may have been modified only partly
+                                throw;
+                            }
+                        }();
+                        m_readIndex.store(writeIndex);
+                        ToggleEpochAndWait();
+                        try
+                        {
+                            func(m_instances[readIndex]);
+                        }
+                        catch (...)
+                        {
+                            m_isOutOfSync = true;
+                            try
+                            {
+                                m_instances[readIndex] = m_instances[writeIndex];
+                                m_isOutOfSync = false;
+                            }
+                            catch (...)
+                            {
+                                // left to the next modification, the published copy is already modified
+                            }
+                        }
+
+                        return result;
+                    }
+
+                public:
+                    /**
+                     * @brief Construct a new ConcurrentKDTree object
+                     *
+                     * @param bucketSize the maximal size of each bucket before it splits into two nodes
+                     * @param maxSize the maximal size of points which will be stored in the tree before it splits
+                     * @param data data that can be passed into the tree at construction (or use AddPoint method to add them later)
+                     * @param buildThreads number of threads used whenever the tree is built
+                     */
+                    ConcurrentKDTree(std::size_t bucketSize, std::size_t maxSize = 10000, std::vector<Point<Leaf,T,Dims> > data = {}, unsigned buildThreads = 1) :
+                        m_instances{KDTree<Leaf,Dims,T,Distance>(bucketSize,maxSize,data,buildThreads),KDTree<Leaf,Dims,T,Distance>(bucketSize,maxSize,std::move(data),buildThreads)}, m_readIndex(0), m_epoch(0), m_readers(), m_writerMutex(), m_isOutOfSync(false)
+                    {
+                    }
+                    ConcurrentKDTree(const ConcurrentKDTree&) = delete;
+                    ConcurrentKDTree& operator=(const ConcurrentKDTree&) = delete;
+                    /**
+                     * @brief Run a read-only function on the currently published tree. Many threads may do it at once, also while another thread modifies the tree.
+                     * The reference passed to func must not be kept after func returns.
+                     *
+                     * @tparam Func function of signature (const KDTree&) -> R
+                     * @param func function to run
+                     * @return whatever func returns
+                     */
+                    template <typename Func>
+                    auto Read(Func func) const
+                    {
+                        const std::size_t slot = ReaderSlot();
+                        const unsigned epoch = m_epoch.load();
+                        m_readers[epoch][slot].count.fetch_add(1);
+
+                        // make sure the reader leaves its epoch even if func throws
+                        struct Departure
+                        {
+                            std::atomic<std::int64_t> &count;
+                            ~Departure() {count.fetch_sub(1);}
+                        } departure{m_readers[epoch][slot].count};
+
+                        return func(static_cast<const KDTree<Leaf,Dims,T,Distance>&>(m_instances[m_readIndex.load()]));
+                    }
+                    /**
+                     * @brief Build a balanced tree at once from all the points stored so far together with the points from [first,last) (see KDTree::BuildTree)
+                     *
+                     * @tparam ForwardIt forward iterator over Point<Leaf,T,Dims> (the range is read once for each copy of the tree)
+                     * @param first beginning of the range of points
+                     * @param last end of the range of points
+                     */
+                    template <typename ForwardIt>
+                    void BuildTree(ForwardIt first, ForwardIt last)
+                    {
+                        Write([&](KDTree<Leaf,Dims,T,Distance> &tree){tree.BuildTree(first,last); return true;});
+                    }
+                    /**
+                     * @brief Split the tree (see KDTree::SplitTree)
+                     *
+                     */
+                    void SplitTree()
+                    {
+                        Write([](KDTree<Leaf,Dims,T,Distance> &tree){tree.SplitTree(); return true;});
+                    }
+                    /**
+                     * @brief Add point to the tree
+                     *
+                     * @param point
+                     * @return true if point could be added or
+                     * @return false otherwise
+                     */
+                    bool AddPoint(const Point<Leaf,T,Dims> &point)
+                    {
+                        return Write([&point](KDTree<Leaf,Dims,T,Distance> &tree){return tree.AddPoint(point);});
+                    }
+                    /**
+                     * @brief Remove point from the tree. Uses operator== of the stored Leaf-type object
+                     *
+                     * @param point
+                     * @return the removed point or std::nullopt if it was not found
+                     */
+                    std::optional<Point<Leaf,T,Dims> > RemovePoint(const Point<Leaf,T,Dims> &point)
+                    {
+                        return Write([&point](KDTree<Leaf,Dims,T,Distance> &tree){return tree.RemovePoint(point);});
+                    }
+                    /**
+                     * @brief Find the nearest point (see KDTree::FindNearest)
+                     *
+                     * @param pt Point to which the distance should be the smallest
+                     * @return std::optional<Point<Leaf,T,Dims> >
+                     */
+                    [[nodiscard]] std::optional<Point<Leaf,T,Dims> > FindNearest(const Point<Leaf,T,Dims> &pt) const
+                    {
+                        return Read([&pt](const KDTree<Leaf,Dims,T,Distance> &tree){return tree.FindNearest(pt);});
+                    }
+                    /**
+                     * @brief Find the N nearest points (see KDTree::FindNNearest)
+                     *
+                     * @param pt Point to which the distance should be the smallest
+                     * @param nPoints Number of closest points
+                     * @return std::vector<Point<Leaf,T,Dims> >
+                     */
+                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > FindNNearest(const Point<Leaf,T,Dims> &pt, unsigned nPoints) const
+                    {
+                        return Read([&pt,nPoints](const KDTree<Leaf,Dims,T,Distance> &tree){return tree.FindNNearest(pt,nPoints);});
+                    }
+                    /**
+                     * @brief Find all points within distance (see KDTree::FindWithinDistance)
+                     *
+                     * @param point Reference point (center of the sphere)
+                     * @param dist Maximal distance from point (radius of the sphere)
+                     * @return std::vector<Point<Leaf,T,Dims> >
+                     */
+                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > FindWithinDistance(const Point<Leaf,T,Dims> &point, T dist) const
+                    {
+                        return Read([&point,dist](const KDTree<Leaf,Dims,T,Distance> &tree){return tree.FindWithinDistance(point,dist);});
+                    }
+                    /**
+                     * @brief Get the number of points stored in the tree
+                     *
+                     * @return std::size_t
+                     */
+                    [[nodiscard]] std::size_t size() const
+                    {
+                        return Read([](const KDTree<Leaf,Dims,T,Distance> &tree){return tree.size();});
+                    }
+                    /**
+                     * @brief Check if the tree has been split
+                     *
+                     * @return true if the tree is split or
+                     * @return false otherwise
+                     */
+                    [[nodiscard]] bool IsSplit() const
+                    {
+                        return Read([](const KDTree<Leaf,Dims,T,Distance> &tree){return tree.IsSplit();});
+                    }
+            };
+
+        } // namespace KDTree
+
+    } // namespace JJDataStruct
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef DistanceKernels_hxx
+    #define DistanceKernels_hxx
+
+    #include <array>
+    #include <cstdint>
+    #include <limits>
+    #include <type_traits>
+
+    #if !defined(KDTREE_DISABLE_SIMD) && (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+        #define KDTREE_X86_KERNELS
+        #include <immintrin.h>
+    #endif
+
+    namespace JJDataStruct
+    {
+        namespace KDTree
+        {
+            /**
+             * @brief Kernels which calculate the distances between one query point and many points at once.
+             * Coordinates are read column by column: the d-th coordinate of the i-th point is at columns[d][i * stride], so the same kernels work for points stored one after another (stride = size of a point in coordinates) and for coordinates stored in separate arrays (stride = 1).
+             * On x86 the float and double kernels are vectorised with SSE, AVX2 or AVX-512, picked at runtime based on what the CPU supports (define KDTREE_DISABLE_SIMD to always use the scalar loop).
+             *
+             */
+            namespace Kernels
+            {
+                /**
+                 * @brief Instruction set used by the distance kernels
+                 *
+                 */
+                enum class SimdLevel {Scalar, SSE, AVX2, AVX512};
+
+                /**
+                 * @brief Get the best instruction set supported by this CPU (checked once)
+                 *
+                 * @return SimdLevel
+                 */
+                inline SimdLevel GetSimdLevel() noexcept
+                {
+                #ifdef KDTREE_X86_KERNELS
+                    static const SimdLevel level = []()
+                    {
+                        __builtin_cpu_init();
+                        if (__builtin_cpu_supports("avx512f"))
+                            return SimdLevel::AVX512;
+                        else if (__builtin_cpu_supports("avx2"))
+                            return SimdLevel::AVX2;
+                        else if (__builtin_cpu_supports("sse2"))
+                            return SimdLevel::SSE;
+                        else
+                            return SimdLevel::Scalar;
+                    }();
+                    return level;
+                #else
+                    return SimdLevel::Scalar;
+                #endif
+                }
+
+                /**
+                 * @brief Squared euclidean distances of points [first,last) to the query, one point at a time
+                 *
+                 */
+                template <typename T, std::size_t Dims>
+                void SquaredDistancesScalar(const std::array<const T*,Dims> &columns, std::size_t stride, std::size_t first, std::size_t last, const std::array<T,Dims> &query, T *out) noexcept
+                {
+                    for (std::size_t i = first; i < last; ++i)
+                    {
+                        T dist = 0;
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                        {
+                            const T diff = columns[dim][i * stride] - query[dim];
+                            dist += diff * diff;
+                        }
+                        out[i] = dist;
+                    }
+                }
+
+            #ifdef KDTREE_X86_KERNELS
+                // each kernel handles as many whole vectors as there are and returns the number of points it has processed, the rest is left for the scalar loop
+                // (no FMA on purpose: the rounding stays the same as in the scalar loop, so both give bit-identical distances)
+                // (masked gathers with a zeroed source, because the unmasked ones trip -Wmaybe-uninitialized in GCC)
+
+                template <std::size_t Dims>
+                __attribute__((target("sse2"))) std::size_t SquaredDistancesSSE(const std::array<const double*,Dims> &columns, std::size_t stride, std::size_t count, const std::array<double,Dims> &query, double *out) noexcept
+                {
+                    std::size_t i = 0;
+                    for (; i + 2 <= count; i += 2)
+                    {
+                        __m128d dist = _mm_setzero_pd();
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                        {
+                            const double *col = columns[dim] + i * stride;
+                            const __m128d diff = _mm_sub_pd(_mm_set_pd(col[stride],col[0]),_mm_set1_pd(query[dim]));
+                            dist = _mm_add_pd(dist,_mm_mul_pd(diff,diff));
+                        }
+                        _mm_storeu_pd(out + i,dist);
+                    }
+                    return i;
+                }
+                template <std::size_t Dims>
+                __attribute__((target("sse2"))) std::size_t SquaredDistancesSSE(const std::array<const float*,Dims> &columns, std::size_t stride, std::size_t count, const std::array<float,Dims> &query, float *out) noexcept
+                {
+                    std::size_t i = 0;
+                    for (; i + 4 <= count; i += 4)
+                    {
+                        __m128 dist = _mm_setzero_ps();
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                        {
+                            const float *col = columns[dim] + i * stride;
+                            const __m128 coords = (stride == 1) ? _mm_loadu_ps(col) : _mm_set_ps(col[3 * stride],col[2 * stride],col[stride],col[0]);
+                            const __m128 diff = _mm_sub_ps(coords,_mm_set1_ps(query[dim]));
+                            dist = _mm_add_ps(dist,_mm_mul_ps(diff,diff));
+                        }
+                        _mm_storeu_ps(out + i,dist);
+                    }
+                    return i;
+                }
+                template <std::size_t Dims>
+                __attribute__((target("avx2"))) std::size_t SquaredDistancesAVX2(const std::array<const double*,Dims> &columns, std::size_t stride, std::size_t count, const std::array<double,Dims> &query, double *out) noexcept
+                {
+                    const auto s = static_cast<long long>(stride);
+                    const __m256i offsets = _mm256_set_epi64x(3 * s,2 * s,s,0);
+                    std::size_t i = 0;
+                    for (; i + 4 <= count; i += 4)
+                    {
+                        __m256d dist = _mm256_setzero_pd();
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                        {
+                            const double *col = columns[dim] + i * stride;
+                            const __m256d coords = (stride == 1) ? _mm256_loadu_pd(col) : _mm256_mask_i64gather_pd(_mm256_setzero_pd(),col,offsets,_mm256_castsi256_pd(_mm256_set1_epi64x(-1)),8);
+                            const __m256d diff = _mm256_sub_pd(coords,_mm256_set1_pd(query[dim]));
+                            dist = _mm256_add_pd(dist,_mm256_mul_pd(diff,diff));
+                        }
+                        _mm256_storeu_pd(out + i,dist);
+                    }
+                    return i;
+                }
+                template <std::size_t Dims>
+                __attribute__((target("avx2"))) std::size_t SquaredDistancesAVX2(const std::array<const float*,Dims> &columns, std::size_t stride, std::size_t count, const std::array<float,Dims> &query, float *out) noexcept
+                {
+                    const auto s = static_cast<int>(stride);
+                    const __m256i offsets = _mm256_set_epi32(7 * s,6 * s,5 * s,4 * s,3 * s,2 * s,s,0);
+                    std::size_t i = 0;
+                    for (; i + 8 <= count; i += 8)
+                    {
+                        __m256 dist = _mm256_setzero_ps();
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                        {
+                            const float *col = columns[dim] + i * stride;
+                            const __m256 coords = (stride == 1) ? _mm256_loadu_ps(col) : _mm256_mask_i32gather_ps(_mm256_setzero_ps(),col,offsets,_mm256_castsi256_ps(_mm256_set1_epi32(-1)),4);
+                            const __m256 diff = _mm256_sub_ps(coords,_mm256_set1_ps(query[dim]));
+                            dist = _mm256_add_ps(dist,_mm256_mul_ps(diff,diff));
+                        }
+                        _mm256_storeu_ps(out + i,dist);
+                    }
+                    return i;
+                }
+                template <std::size_t Dims>
+                __attribute__((target("avx512f"))) std::size_t SquaredDistancesAVX512(const std::array<const double*,Dims> &columns, std::size_t stride, std::size_t count, const std::array<double,Dims> &query, double *out) noexcept
+                {
+                    const auto s = static_cast<long long>(stride);
+                    const __m512i offsets = _mm512_set_epi64(7 * s,6 * s,5 * s,4 * s,3 * s,2 * s,s,0);
+                    std::size_t i = 0;
+                    for (; i + 8 <= count; i += 8)
+                    {
+                        __m512d dist = _mm512_setzero_pd();
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                        {
+                            const double *col = columns[dim] + i * stride;
+                            const __m512d coords = (stride == 1) ? _mm512_loadu_pd(col) : _mm512_mask_i64gather_pd(_mm512_setzero_pd(),0xFF,offsets,col,8);
+                            const __m512d diff = _mm512_sub_pd(coords,_mm512_set1_pd(query[dim]));
+                            dist = _mm512_add_pd(dist,_mm512_mul_pd(diff,diff));
+                        }
+                        _mm512_storeu_pd(out + i,dist);
+                    }
+                    return i;
+                }
+                template <std::size_t Dims>
+                __attribute__((target("avx512f"))) std::size_t SquaredDistancesAVX512(const std::array<const float*,Dims> &columns, std::size_t stride, std::size_t count, const std::array<float,Dims> &query, float *out) noexcept
+                {
+                    const auto s = static_cast<int>(stride);
+                    const __m512i offsets = _mm512_set_epi32(15 * s,14 * s,13 * s,12 * s,11 * s,10 * s,9 * s,8 * s,7 * s,6 * s,5 * s,4 * s,3 * s,2 * s,s,0);
+                    std::size_t i = 0;
+                    for (; i + 16 <= count; i += 16)
+                    {
+                        __m512 dist = _mm512_setzero_ps();
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                        {
+                            const float *col = columns[dim] + i * stride;
+                            const __m512 coords = (stride == 1) ? _mm512_loadu_ps(col) : _mm512_mask_i32gather_ps(_mm512_setzero_ps(),0xFFFF,offsets,col,4);
+                            const __m512 diff = _mm512_sub_ps(coords,_mm512_set1_ps(query[dim]));
+                            dist = _mm512_add_ps(dist,_mm512_mul_ps(diff,diff));
+                        }
+                        _mm512_storeu_ps(out + i,dist);
+                    }
+                    return i;
+                }
+            #endif
+
+                /**
+                 * @brief Calculate squared euclidean distances of count points to the query point
+                 *
+                 * @tparam T Arithmetic type of point coordinates
+                 * @tparam Dims Number of dimensions
+                 * @param columns pointers to the d-th coordinate of the first point for each dimension d
+                 * @param stride distance (in elements of type T) between the same coordinate of two consecutive points
+                 * @param count number of points
+                 * @param query coordinates of the query point
+                 * @param out array of at least count elements to which the distances are written
+                 */
+                template <typename T, std::size_t Dims>
+                void SquaredDistances(const std::array<const T*,Dims> &columns, std::size_t stride, std::size_t count, const std::array<T,Dims> &query, T *out) noexcept
+                {
+                    std::size_t done = 0;
+                #ifdef KDTREE_X86_KERNELS
+                    // 32-bit gather offsets have to fit the whole block
+                    if constexpr (std::is_same_v<T,double> || std::is_same_v<T,float>)
+                    {
+                        if (stride * 16 <= static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max()))
+                        {
+                            switch (GetSimdLevel())
+                            {
+                                case SimdLevel::AVX512:
+                                    done = SquaredDistancesAVX512<Dims>(columns,stride,count,query,out);
+                                    break;
+                                case SimdLevel::AVX2:
+                                    done = SquaredDistancesAVX2<Dims>(columns,stride,count,query,out);
+                                    break;
+                                case SimdLevel::SSE:
+                                    done = SquaredDistancesSSE<Dims>(columns,stride,count,query,out);
+                                    break;
+                                case SimdLevel::Scalar:
+                                    break;
+                            }
+                        }
+                    }
+                #endif
+                    SquaredDistancesScalar<T,Dims>(columns,stride,done,count,query,out);
+                }
+
+            } // namespace Kernels
+
+        } // namespace KDTree
+
+    } // namespace JJDataStruct
+
+#endif
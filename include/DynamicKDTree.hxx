@@ -0,0 +1,204 @@
+#ifndef DynamicKDTree_hxx
+    #define DynamicKDTree_hxx
+
+    #include <iterator>
+    #include <vector>
+
+    #include "KDTree.hxx"
+
+    namespace JJDataStruct
+    {
+        namespace KDTree
+        {
+            /**
+             * @brief K-Dimensional Tree for a high rate of insertions, kept as a forest of balanced trees of geometrically increasing sizes (the logarithmic method of Bentley and Saxe).
+             * The tree at level i holds at most bucketSize * 2^i points. A new point is merged with all the trees of the lower levels into the first level which can hold them all, and that level is rebuilt at once (see NodeArray::Build).
+             * Every point is therefore rebuilt into O(log n) trees in its life, which gives amortised O(log^2 n) insertions, while every tree keeps the medians of its own points instead of the medians of the points present at the first split.
+             * The searches visit all the trees and share their results between them (see NearestFinder::FindInForest), so the trees searched later are pruned by the points found in the earlier ones.
+             *
+             * @tparam Leaf Object type that will be stored in leafs
+             * @tparam Dims Number of dimensions over which the data will be divided
+             * @tparam T Arithmetic type of point coordinates
+             * @tparam Distance Metric upon which the distance will be calculated
+             */
+            template <typename Leaf, std::size_t Dims, typename T = double, typename Distance = SquaredDist>
+            class DynamicKDTree
+            {
+                private:
+                    std::size_t m_bucketSize, m_size;
+                    std::vector<NodeArray<Leaf,T,Dims,Distance> > m_levels;
+                    Deleter<Leaf,T,Dims,Distance> m_deleter;
+                    NearestFinder<Leaf,T,Dims,Distance> m_nearestFinder;
+                    NNearestFinder<Leaf,T,Dims,Distance> m_nNearestFinder;
+                    DistanceFinder<Leaf,T,Dims,Distance> m_distanceFinder;
+
+                    [[nodiscard]] std::size_t GetLevelSize(std::size_t level) const noexcept
+                    {
+                        const auto &nodes = m_levels[level];
+                        return (nodes.IsEmpty()) ? 0 : nodes[nodes.GetRootIndex()].GetSubtreeSize();
+                    }
+                    [[nodiscard]] std::size_t GetLevelCapacity(std::size_t level) const noexcept
+                    {
+                        return m_bucketSize << level;
+                    }
+
+                public:
+                    /**
+                     * @brief Construct a new empty DynamicKDTree object
+                     *
+                     * @param bucketSize the maximal number of points in each leaf (and in the tree of the lowest level)
+                     */
+                    explicit DynamicKDTree(std::size_t bucketSize = 32) : m_bucketSize(std::max(bucketSize,std::size_t(1))), m_size(0), m_levels(), m_deleter(), m_nearestFinder(), m_nNearestFinder(), m_distanceFinder()
+                    {
+                    }
+                    /**
+                     * @brief Construct a new DynamicKDTree object holding the points from [first,last) in a single balanced tree
+                     *
+                     * @tparam InputIt input iterator over Point<Leaf,T,Dims>
+                     * @param bucketSize the maximal number of points in each leaf (and in the tree of the lowest level)
+                     * @param first beginning of the range of points
+                     * @param last end of the range of points
+                     */
+                    template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+                    DynamicKDTree(std::size_t bucketSize, InputIt first, InputIt last) : DynamicKDTree(bucketSize)
+                    {
+                        std::vector<Point<Leaf,T,Dims> > data(first,last);
+                        if (data.empty())
+                            return;
+
+                        std::size_t level = 0;
+                        while (GetLevelCapacity(level) < data.size())
+                            ++level;
+
+                        m_levels.resize(level + 1,NodeArray<Leaf,T,Dims,Distance>(m_bucketSize));
+                        m_size = data.size();
+                        m_levels[level].Build(std::move(data));
+                    }
+                    /**
+                     * @brief Add point to the tree. The trees of the lower levels are merged with it into the first level which can hold them all.
+                     *
+                     * @param point
+                     * @return true (the point can always be added)
+                     */
+                    bool AddPoint(Point<Leaf,T,Dims> point)
+                    {
+                        std::size_t level = 0, nPoints = 1;
+                        for (;; ++level)
+                        {
+                            if (level == m_levels.size())
+                                m_levels.emplace_back(m_bucketSize);
+
+                            nPoints += GetLevelSize(level);
+                            if (nPoints <= GetLevelCapacity(level))
+                                break;
+                        }
+
+                        std::vector<Point<Leaf,T,Dims> > data;
+                        data.reserve(nPoints);
+                        data.push_back(std::move(point));
+                        for (std::size_t i = 0; i <= level; ++i)
+                        {
+                            auto released = m_levels[i].Release();
+                            data.insert(data.end(),std::make_move_iterator(released.begin()),std::make_move_iterator(released.end()));
+                        }
+
+                        m_levels[level].Build(std::move(data));
+                        ++m_size;
+                        return true;
+                    }
+                    /**
+                     * @brief Remove point from the tree. Uses operator== of the stored Leaf-type object. The level which held the point keeps its shape and is merged again with the next insertions that reach it.
+                     *
+                     * @param point
+                     * @return the removed point or std::nullopt if it is not in the tree
+                     */
+                    std::optional<Point<Leaf,T,Dims> > RemovePoint(const Point<Leaf,T,Dims> &point)
+                    {
+                        for (std::size_t level = 0; level < m_levels.size(); ++level)
+                        {
+                            auto &nodes = m_levels[level];
+                            if (nodes.IsEmpty())
+                                continue;
+
+                            auto removed = m_deleter.Remove(nodes,nodes.GetRootIndex(),point);
+                            if (removed.has_value())
+                            {
+                                --m_size;
+                                if (GetLevelSize(level) == 0)
+                                    (void)nodes.Release();
+
+                                return removed;
+                            }
+                        }
+
+                        return std::nullopt;
+                    }
+                    /**
+                     * @brief Find the nearest point
+                     *
+                     * @param pt Point to which the distance should be the smallest
+                     * @return the nearest point or std::nullopt if the tree is empty
+                     */
+                    [[nodiscard]] std::optional<Point<Leaf,T,Dims> > FindNearest(const Point<Leaf,T,Dims> &pt) const
+                    {
+                        return m_nearestFinder.FindInForest(m_levels,pt);
+                    }
+                    /**
+                     * @brief Find the N nearest points
+                     *
+                     * @param pt Point to which the distance should be the smallest
+                     * @param nPoints Number of closest points
+                     * @return std::vector<Point<Leaf,T,Dims> > sorted by distance
+                     */
+                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > FindNNearest(const Point<Leaf,T,Dims> &pt, unsigned nPoints) const
+                    {
+                        std::vector<Point<Leaf,T,Dims> > closestPoints;
+                        m_nNearestFinder.FindInForest(m_levels,pt,nPoints,closestPoints);
+                        return closestPoints;
+                    }
+                    /**
+                     * @brief Find all points within distance
+                     *
+                     * @param point Reference point (center of the sphere)
+                     * @param dist Maximal distance from point (radius of the sphere)
+                     * @return std::vector<Point<Leaf,T,Dims> >
+                     */
+                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > FindWithinDistance(const Point<Leaf,T,Dims> &point, T dist) const
+                    {
+                        std::vector<Point<Leaf,T,Dims> > closestPoints;
+                        for (const auto &nodes : m_levels)
+                        {
+                            if (nodes.IsEmpty())
+                                continue;
+
+                            auto found = m_distanceFinder.Find(nodes,nodes.GetRootIndex(),point,dist);
+                            closestPoints.insert(closestPoints.end(),std::make_move_iterator(found.begin()),std::make_move_iterator(found.end()));
+                        }
+
+                        return closestPoints;
+                    }
+                    /**
+                     * @brief Returns the trees of the forest, from the lowest level (some of them may be empty)
+                     *
+                     * @return const std::vector<NodeArray<Leaf,T,Dims,Distance> >&
+                     */
+                    [[nodiscard]] inline const std::vector<NodeArray<Leaf,T,Dims,Distance> >& GetLevels() const noexcept {return m_levels;}
+                    /**
+                     * @brief Returns the maximal number of points in each leaf
+                     *
+                     * @return std::size_t
+                     */
+                    [[nodiscard]] inline std::size_t GetBucketSize() const noexcept {return m_bucketSize;}
+                    /**
+                     * @brief Returns number of stored points
+                     *
+                     * @return std::size_t
+                     */
+                    [[nodiscard]] inline std::size_t size() const noexcept {return m_size;}
+            };
+
+        } // namespace KDTree
+
+    } // namespace JJDataStruct
+
+#endif
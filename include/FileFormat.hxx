@@ -0,0 +1,281 @@
+#ifndef FileFormat_hxx
+    #define FileFormat_hxx
+
+    #include <algorithm>
+    #include <cstddef>
+    #include <cstdint>
+    #include <cstring>
+    #include <fstream>
+    #include <memory>
+    #include <stdexcept>
+    #include <string>
+    #include <type_traits>
+    #include <vector>
+
+    #if defined(__unix__) || defined(__APPLE__)
+        #define KDTREE_HAS_MMAP
+        #include <fcntl.h>
+        #include <sys/mman.h>
+        #include <sys/stat.h>
+        #include <unistd.h>
+    #endif
+
+    #include "FrozenNodeArray.hxx"
+
+    namespace JJDataStruct
+    {
+        namespace KDTree
+        {
+            /**
+             * @brief Binary file format of a frozen tree. The file is laid out so that it can be mapped into memory and searched in place, without reading or converting anything:
+             * a Header, then the node records, then one array per coordinate and then the array of Leaf-type objects, each section starting at a multiple of SectionAlignment bytes.
+             * The data is written in the byte order of the machine that wrote it, so a file can only be read on a machine with the same byte order (checked with EndianMarker).
+             *
+             */
+            namespace FileFormat
+            {
+                inline constexpr char Magic[8] = {'J','J','K','D','T','R','E','E'};
+                inline constexpr std::uint32_t Version = 1;
+                inline constexpr std::uint32_t EndianMarker = 0x01020304;
+                inline constexpr std::uint64_t SectionAlignment = 64;
+
+                /**
+                 * @brief Header at the beginning of the file. Apart from the location of the sections it describes the types stored in the file, so that a file cannot be read as a tree of different types.
+                 *
+                 */
+                struct Header
+                {
+                    char magic[8];
+                    std::uint32_t version;
+                    std::uint32_t endianMarker;
+                    std::uint32_t dims;
+                    std::uint32_t coordinateKind; // 0 - unsigned integer, 1 - signed integer, 2 - floating point
+                    std::uint32_t coordinateSize;
+                    std::uint32_t objectSize;
+                    std::uint32_t objectAlignment;
+                    std::uint32_t recordSize;
+                    std::uint64_t nRecords;
+                    std::uint64_t nPoints;
+                    std::uint64_t recordsOffset;
+                    std::uint64_t columnsOffset;
+                    std::uint64_t columnStride; // distance in bytes between the beginnings of two consecutive coordinate arrays
+                    std::uint64_t objectsOffset;
+                    std::uint64_t fileSize;
+                };
+
+                [[nodiscard]] inline constexpr std::uint64_t AlignUp(std::uint64_t offset) noexcept
+                {
+                    return (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+                }
+                template <typename T>
+                [[nodiscard]] inline constexpr std::uint32_t CoordinateKind() noexcept
+                {
+                    return std::is_floating_point_v<T> ? 2 : (std::is_signed_v<T> ? 1 : 0);
+                }
+                /**
+                 * @brief Check at compile time that a tree of these types can be stored in a file
+                 *
+                 */
+                template <typename Leaf, typename T>
+                inline constexpr void CheckTypes() noexcept
+                {
+                    static_assert(std::is_trivially_copyable_v<Leaf>,"Only trees of trivially copyable objects can be stored in a file");
+                    static_assert(std::is_arithmetic_v<T>,"Only trees with arithmetic coordinates can be stored in a file");
+                    static_assert(alignof(Leaf) <= SectionAlignment && alignof(FrozenNodeRecord<T>) <= SectionAlignment,"Types aligned to more than SectionAlignment cannot be stored in a file");
+                }
+                /**
+                 * @brief Create the header of a file holding a tree of nRecords nodes and nPoints points
+                 *
+                 * @tparam Leaf Object type that will be stored in leafs
+                 * @tparam T Arithmetic type of point coordinates
+                 * @tparam Dims Number of dimensions
+                 * @param nRecords number of nodes
+                 * @param nPoints number of points
+                 * @return Header
+                 */
+                template <typename Leaf, typename T, std::size_t Dims>
+                [[nodiscard]] Header MakeHeader(std::uint64_t nRecords, std::uint64_t nPoints) noexcept
+                {
+                    Header header{};
+                    std::memcpy(header.magic,Magic,sizeof(Magic));
+                    header.version = Version;
+                    header.endianMarker = EndianMarker;
+                    header.dims = static_cast<std::uint32_t>(Dims);
+                    header.coordinateKind = CoordinateKind<T>();
+                    header.coordinateSize = static_cast<std::uint32_t>(sizeof(T));
+                    header.objectSize = static_cast<std::uint32_t>(sizeof(Leaf));
+                    header.objectAlignment = static_cast<std::uint32_t>(alignof(Leaf));
+                    header.recordSize = static_cast<std::uint32_t>(sizeof(FrozenNodeRecord<T>));
+                    header.nRecords = nRecords;
+                    header.nPoints = nPoints;
+                    header.recordsOffset = AlignUp(sizeof(Header));
+                    header.columnsOffset = AlignUp(header.recordsOffset + nRecords * sizeof(FrozenNodeRecord<T>));
+                    header.columnStride = AlignUp(nPoints * sizeof(T));
+                    header.objectsOffset = AlignUp(header.columnsOffset + Dims * header.columnStride);
+                    header.fileSize = header.objectsOffset + nPoints * sizeof(Leaf);
+
+                    return header;
+                }
+                /**
+                 * @brief Check that header describes a valid file of fileSize bytes holding a tree of these types
+                 *
+                 * @throws std::runtime_error if it does not
+                 */
+                template <typename Leaf, typename T, std::size_t Dims>
+                void CheckHeader(const Header &header, std::uint64_t fileSize)
+                {
+                    if (std::memcmp(header.magic,Magic,sizeof(Magic)) != 0)
+                        throw std::runtime_error("FileFormat::CheckHeader - not a KDTree file");
+                    if (header.version != Version)
+                        throw std::runtime_error("FileFormat::CheckHeader - unsupported file version " + std::to_string(header.version));
+                    if (header.endianMarker != EndianMarker)
+                        throw std::runtime_error("FileFormat::CheckHeader - file was written on a machine with a different byte order");
+                    if (header.dims != Dims || header.coordinateKind != CoordinateKind<T>() || header.coordinateSize != sizeof(T) || header.objectSize != sizeof(Leaf) || header.objectAlignment != alignof(Leaf) || header.recordSize != sizeof(FrozenNodeRecord<T>))
+                        throw std::runtime_error("FileFormat::CheckHeader - file holds a tree of different types");
+
+                    if (header.nRecords == 0 || header.nRecords >= InvalidIndex || header.nPoints >= InvalidIndex)
+                        throw std::runtime_error("FileFormat::CheckHeader - file is corrupted");
+
+                    const Header expected = MakeHeader<Leaf,T,Dims>(header.nRecords,header.nPoints);
+                    if (header.recordsOffset != expected.recordsOffset || header.columnsOffset != expected.columnsOffset ||
+                        header.columnStride != expected.columnStride || header.objectsOffset != expected.objectsOffset || header.fileSize != expected.fileSize || header.fileSize > fileSize)
+                        throw std::runtime_error("FileFormat::CheckHeader - file is corrupted or truncated");
+                }
+                /**
+                 * @brief Check that every one of nRecords node records points only inside the tree: the children of a split node lie after it among the records (as in the van Emde Boas layout, so a search cannot loop) and the points of a leaf among the nPoints points.
+                 * Only the records are read, not the points.
+                 *
+                 * @throws std::runtime_error if they do not
+                 */
+                template <typename T, std::size_t Dims>
+                void CheckRecords(const FrozenNodeRecord<T> *records, std::uint64_t nRecords, std::uint64_t nPoints)
+                {
+                    for (std::uint64_t index = 0; index < nRecords; ++index)
+                    {
+                        const FrozenNodeRecord<T> &record = records[index];
+                        const bool isValid = (record.dimensionIndex == FrozenNodeRecord<T>::LeafMarker) ?
+                            (record.first <= record.second && record.second <= nPoints) :
+                            (record.dimensionIndex < Dims && record.first > index && record.first < nRecords && record.second > index && record.second < nRecords);
+                        if (!isValid)
+                            throw std::runtime_error("FileFormat::CheckRecords - file is corrupted");
+                    }
+                }
+                /**
+                 * @brief Write count bytes to the stream, preceded by zeros up to offset
+                 *
+                 */
+                inline void WriteAt(std::ostream &stream, std::uint64_t offset, const void *data, std::uint64_t count)
+                {
+                    static constexpr char zeros[SectionAlignment] = {};
+                    for (auto position = static_cast<std::uint64_t>(stream.tellp()); position < offset; position += SectionAlignment)
+                        stream.write(zeros,static_cast<std::streamsize>(std::min(SectionAlignment,offset - position)));
+
+                    stream.write(static_cast<const char*>(data),static_cast<std::streamsize>(count));
+                }
+
+                /**
+                 * @brief Write the node records to the stream at offset, field by field, so that the padding bytes of FrozenNodeRecord (if there are any for this T) are written as zeros and not as whatever happens to be in memory.
+                 * This keeps the file the same for the same tree.
+                 *
+                 */
+                template <typename T>
+                void WriteRecords(std::ostream &stream, std::uint64_t offset, const FrozenNodeRecord<T> *records, std::size_t count)
+                {
+                    using Record = FrozenNodeRecord<T>;
+                    static constexpr std::size_t BlockSize = 4096;
+
+                    std::vector<unsigned char> block;
+                    WriteAt(stream,offset,nullptr,0);
+                    for (std::size_t begin = 0; begin < count; begin += BlockSize)
+                    {
+                        const std::size_t end = std::min(count,begin + BlockSize);
+                        block.assign((end - begin) * sizeof(Record),0);
+                        for (std::size_t index = begin; index < end; ++index)
+                        {
+                            unsigned char *bytes = block.data() + (index - begin) * sizeof(Record);
+                            std::memcpy(bytes + offsetof(Record,median),&records[index].median,sizeof(T));
+                            std::memcpy(bytes + offsetof(Record,dimensionIndex),&records[index].dimensionIndex,sizeof(std::uint32_t));
+                            std::memcpy(bytes + offsetof(Record,first),&records[index].first,sizeof(std::uint32_t));
+                            std::memcpy(bytes + offsetof(Record,second),&records[index].second,sizeof(std::uint32_t));
+                        }
+                        WriteAt(stream,offset + begin * sizeof(Record),block.data(),block.size());
+                    }
+                }
+
+                /**
+                 * @brief Read-only content of a whole file. Where possible the file is mapped into memory (so only the pages which are actually used are ever read from the disk), otherwise it is read into memory at once.
+                 *
+                 */
+                class MappedFile
+                {
+                    private:
+                        const void *m_data;
+                        std::uint64_t m_size;
+                        std::vector<std::uint64_t> m_buffer; // only used without mmap (std::uint64_t for the alignment)
+
+                    public:
+                        /**
+                         * @brief Map the file at path into memory
+                         *
+                         * @param path path to the file
+                         * @throws std::runtime_error if the file cannot be opened or mapped
+                         */
+                        explicit MappedFile(const std::string &path) : m_data(nullptr), m_size(0), m_buffer()
+                        {
+                        #ifdef KDTREE_HAS_MMAP
+                            const int descriptor = ::open(path.c_str(),O_RDONLY);
+                            if (descriptor < 0)
+                                throw std::runtime_error("MappedFile::MappedFile - cannot open " + path);
+
+                            struct stat status;
+                            if (::fstat(descriptor,&status) != 0)
+                            {
+                                ::close(descriptor);
+                                throw std::runtime_error("MappedFile::MappedFile - cannot read the size of " + path);
+                            }
+
+                            m_size = static_cast<std::uint64_t>(status.st_size);
+                            if (m_size > 0)
+                            {
+                                void *address = ::mmap(nullptr,static_cast<std::size_t>(m_size),PROT_READ,MAP_PRIVATE,descriptor,0);
+                                if (address == MAP_FAILED)
+                                {
+                                    ::close(descriptor);
+                                    throw std::runtime_error("MappedFile::MappedFile - cannot map " + path);
+                                }
+                                m_data = address;
+                            }
+                            ::close(descriptor); // the mapping stays valid
+                        #else
+                            std::ifstream file(path,std::ios::binary | std::ios::ate);
+                            if (!file)
+                                throw std::runtime_error("MappedFile::MappedFile - cannot open " + path);
+
+                            m_size = static_cast<std::uint64_t>(file.tellg());
+                            m_buffer.resize(static_cast<std::size_t>((m_size + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t)));
+                            file.seekg(0);
+                            if (!file.read(reinterpret_cast<char*>(m_buffer.data()),static_cast<std::streamsize>(m_size)))
+                                throw std::runtime_error("MappedFile::MappedFile - cannot read " + path);
+                            m_data = m_buffer.data();
+                        #endif
+                        }
+                        MappedFile(const MappedFile&) = delete;
+                        MappedFile& operator=(const MappedFile&) = delete;
+                        ~MappedFile()
+                        {
+                        #ifdef KDTREE_HAS_MMAP
+                            if (m_data != nullptr)
+                                ::munmap(const_cast<void*>(m_data),static_cast<std::size_t>(m_size));
+                        #endif
+                        }
+                        [[nodiscard]] inline const unsigned char* data() const noexcept {return static_cast<const unsigned char*>(m_data);}
+                        [[nodiscard]] inline std::uint64_t size() const noexcept {return m_size;}
+                };
+
+            } // namespace FileFormat
+
+        } // namespace KDTree
+
+    } // namespace JJDataStruct
+
+#endif
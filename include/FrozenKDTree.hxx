@@ -0,0 +1,237 @@
+#ifndef FrozenKDTree_hxx
+    #define FrozenKDTree_hxx
+
+    #include <memory>
+    #include <stdexcept>
+
+    #include "KDTree.hxx"
+    #include "FrozenNodeArray.hxx"
+    #include "FileFormat.hxx"
+
+    namespace JJDataStruct
+    {
+        namespace KDTree
+        {
+            /**
+             * @brief Read-only K-Dimensional Tree for workloads where the tree is built once and then searched many times.
+             * The nodes are laid out in a single array in van Emde Boas order (see VanEmdeBoasLayout), so a search touches few cache lines and pages at every scale without knowing their size.
+             * The points are packed into one structure of arrays in the order of the leaves from left to right, so the points of neighbouring leaves are also neighbours in memory.
+             * Copies share the same (immutable) storage. A frozen tree of trivially copyable objects can be stored in a file and mapped back into memory (see Save and Map).
+             *
+             * @tparam Leaf Object type that will be stored in leafs
+             * @tparam Dims Number of dimensions over which the data will be divided
+             * @tparam T Arithmetic type of point coordinates
+             * @tparam Distance Metric upon which the distance will be calculated
+             */
+            template <typename Leaf, std::size_t Dims, typename T = double, typename Distance = SquaredDist>
+            class FrozenKDTree
+            {
+                private:
+                    using Record = FrozenNodeRecord<T>;
+
+                    struct Storage
+                    {
+                        std::vector<Record> records;
+                        Bucket<Leaf,T,Dims> points;
+                    };
+
+                    std::shared_ptr<const void> m_storage; // owns the memory the nodes point to
+                    FrozenNodeArray<Leaf,T,Dims,Distance> m_nodes;
+                    NearestFinder<Leaf,T,Dims,Distance> m_nearestFinder;
+                    NNearestFinder<Leaf,T,Dims,Distance> m_nNearestFinder;
+                    DistanceFinder<Leaf,T,Dims,Distance> m_distanceFinder;
+
+                    /**
+                     * @brief Append the nodes of the subtree at index to records in pre-order and copy the points of its leaves to points, from left to right
+                     *
+                     * @return index of the subtree's root in records
+                     */
+                    template <std::size_t BucketCapacity, typename SplitPolicy>
+                    static std::uint32_t CopySubtree(const NodeArray<Leaf,T,Dims,Distance,BucketCapacity,SplitPolicy> &nodes, std::uint32_t index, std::vector<Record> &records, Bucket<Leaf,T,Dims> &points)
+                    {
+                        const auto &node = nodes[index];
+                        const auto recordIndex = static_cast<std::uint32_t>(records.size());
+                        records.push_back({node.GetMedian(),static_cast<std::uint32_t>(node.GetDimensionIndex()),0,0});
+                        if (node.IsSplit())
+                        {
+                            const std::uint32_t left = CopySubtree(nodes,node.GetLeftIndex(),records,points);
+                            const std::uint32_t right = CopySubtree(nodes,node.GetRightIndex(),records,points);
+                            records[recordIndex].first = left;
+                            records[recordIndex].second = right;
+                        }
+                        else
+                        {
+                            records[recordIndex] = {T(),Record::LeafMarker,static_cast<std::uint32_t>(points.size()),0};
+                            points.Append(node.GetBucket());
+                            records[recordIndex].second = static_cast<std::uint32_t>(points.size());
+                        }
+
+                        return recordIndex;
+                    }
+                    template <std::size_t BucketCapacity, typename SplitPolicy>
+                    void Freeze(const NodeArray<Leaf,T,Dims,Distance,BucketCapacity,SplitPolicy> &nodes, std::size_t nPoints)
+                    {
+                        if (nPoints >= InvalidIndex)
+                            throw std::length_error("FrozenKDTree::Freeze - too many points for a 32-bit index");
+
+                        auto storage = std::make_shared<Storage>();
+                        if (!nodes.IsEmpty())
+                        {
+                            std::vector<Record> records;
+                            records.reserve(nodes.GetNumberOfNodes());
+                            storage->points.Reserve(nPoints);
+                            CopySubtree(nodes,nodes.GetRootIndex(),records,storage->points);
+                            storage->records = VanEmdeBoasLayout<T>::Apply(records);
+                        }
+
+                        std::array<const T*,Dims> columns;
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            columns[dim] = storage->points.GetColumn(dim);
+
+                        m_nodes = FrozenNodeArray<Leaf,T,Dims,Distance>(storage->records.data(),storage->records.size(),PackedPoints<Leaf,T,Dims>(columns,storage->points.GetObjects(),storage->points.size()));
+                        m_storage = std::move(storage);
+                    }
+                    FrozenKDTree(std::shared_ptr<const void> storage, const FrozenNodeArray<Leaf,T,Dims,Distance> &nodes) : m_storage(std::move(storage)), m_nodes(nodes), m_nearestFinder(), m_nNearestFinder(), m_distanceFinder()
+                    {
+                    }
+
+                public:
+                    /**
+                     * @brief Construct a new FrozenKDTree object holding a copy of the points of tree. A split tree keeps its shape, the points of a tree which is not split yet are built into a balanced tree first.
+                     *
+                     * @tparam BucketCapacity capacity of the buckets of the tree (see KDTree)
+                     * @tparam SplitPolicy split policy of the tree (see KDTree)
+                     * @param tree tree to be copied
+                     * @throws std::length_error if the tree holds more points than a 32-bit index can address
+                     */
+                    template <std::size_t BucketCapacity, typename SplitPolicy>
+                    explicit FrozenKDTree(const KDTree<Leaf,Dims,T,Distance,BucketCapacity,SplitPolicy> &tree) : m_storage(), m_nodes(), m_nearestFinder(), m_nNearestFinder(), m_distanceFinder()
+                    {
+                        if (tree.IsSplit())
+                        {
+                            Freeze(tree.GetNodes(),tree.size());
+                        }
+                        else
+                        {
+                            std::vector<Point<Leaf,T,Dims> > data = tree.GetStoredData();
+                            const std::size_t nPoints = data.size();
+                            Freeze(NodeArray<Leaf,T,Dims,Distance,BucketCapacity,SplitPolicy>(std::move(data),tree.GetBucketSize()),nPoints);
+                        }
+                    }
+                    /**
+                     * @brief Construct a new FrozenKDTree object from a balanced tree built from [first,last) at once (see KDTree::BuildTree)
+                     *
+                     * @tparam InputIt input iterator over Point<Leaf,T,Dims>
+                     * @param bucketSize the maximal number of points in each leaf
+                     * @param first beginning of the range of points
+                     * @param last end of the range of points
+                     */
+                    template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+                    FrozenKDTree(std::size_t bucketSize, InputIt first, InputIt last) : FrozenKDTree(KDTree<Leaf,Dims,T,Distance>(bucketSize,first,last))
+                    {
+                    }
+                    /**
+                     * @brief Map a tree stored by Save into memory and search it in place. Nothing is converted, the pages of the points are read only once a search needs them.
+                     * The header and the node records are checked, so a search never leaves the mapping; the points themselves are trusted to be what Save wrote.
+                     *
+                     * @param path path to the file
+                     * @return FrozenKDTree 
+                     * @throws std::runtime_error if the file cannot be read or does not hold a tree of these types
+                     */
+                    [[nodiscard]] static FrozenKDTree Map(const std::string &path)
+                    {
+                        FileFormat::CheckTypes<Leaf,T>();
+
+                        auto file = std::make_shared<const FileFormat::MappedFile>(path);
+                        FileFormat::Header header;
+                        if (file->size() < sizeof(header))
+                            throw std::runtime_error("FrozenKDTree::Map - file is too short: " + path);
+
+                        std::memcpy(&header,file->data(),sizeof(header));
+                        FileFormat::CheckHeader<Leaf,T,Dims>(header,file->size());
+                        FileFormat::CheckRecords<T,Dims>(reinterpret_cast<const Record*>(file->data() + header.recordsOffset),header.nRecords,header.nPoints);
+
+                        std::array<const T*,Dims> columns;
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            columns[dim] = reinterpret_cast<const T*>(file->data() + header.columnsOffset + dim * header.columnStride);
+
+                        const PackedPoints<Leaf,T,Dims> points(columns,reinterpret_cast<const Leaf*>(file->data() + header.objectsOffset),static_cast<std::size_t>(header.nPoints));
+                        const FrozenNodeArray<Leaf,T,Dims,Distance> nodes(reinterpret_cast<const Record*>(file->data() + header.recordsOffset),static_cast<std::size_t>(header.nRecords),points);
+                        return FrozenKDTree(std::move(file),nodes);
+                    }
+                    /**
+                     * @brief Store the tree in a file (see FileFormat), from which it can be mapped back with Map. Requires a trivially copyable Leaf type.
+                     *
+                     * @param path path to the file (it is overwritten)
+                     * @throws std::runtime_error if the file cannot be written
+                     */
+                    void Save(const std::string &path) const
+                    {
+                        FileFormat::CheckTypes<Leaf,T>();
+
+                        std::ofstream file(path,std::ios::binary | std::ios::trunc);
+                        if (!file)
+                            throw std::runtime_error("FrozenKDTree::Save - cannot open " + path);
+
+                        const auto &points = m_nodes.GetPoints();
+                        const FileFormat::Header header = FileFormat::MakeHeader<Leaf,T,Dims>(m_nodes.GetNumberOfNodes(),points.size());
+                        FileFormat::WriteAt(file,0,&header,sizeof(header));
+                        FileFormat::WriteRecords(file,header.recordsOffset,m_nodes.GetRecords(),static_cast<std::size_t>(header.nRecords));
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            FileFormat::WriteAt(file,header.columnsOffset + dim * header.columnStride,points.GetColumn(dim),header.nPoints * sizeof(T));
+                        FileFormat::WriteAt(file,header.objectsOffset,points.GetObjects(),header.nPoints * sizeof(Leaf));
+
+                        if (!file.flush())
+                            throw std::runtime_error("FrozenKDTree::Save - cannot write " + path);
+                    }
+                    /**
+                     * @brief Find the nearest point
+                     *
+                     * @param pt Point to which the distance should be the smallest
+                     * @return the nearest point or std::nullopt if the tree is empty
+                     */
+                    [[nodiscard]] std::optional<Point<Leaf,T,Dims> > FindNearest(const Point<Leaf,T,Dims> &pt) const
+                    {
+                        return m_nearestFinder.Find(m_nodes,m_nodes.GetRootIndex(),pt);
+                    }
+                    /**
+                     * @brief Find the N nearest points
+                     *
+                     * @param pt Point to which the distance should be the smallest
+                     * @param nPoints Number of closest points
+                     * @return std::vector<Point<Leaf,T,Dims> > sorted by distance
+                     */
+                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > FindNNearest(const Point<Leaf,T,Dims> &pt, unsigned nPoints) const
+                    {
+                        return m_nNearestFinder.Find(m_nodes,m_nodes.GetRootIndex(),pt,nPoints);
+                    }
+                    /**
+                     * @brief Find all points within distance
+                     *
+                     * @param point Reference point (center of the sphere)
+                     * @param dist Maximal distance from point (radius of the sphere)
+                     * @return std::vector<Point<Leaf,T,Dims> >
+                     */
+                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > FindWithinDistance(const Point<Leaf,T,Dims> &point, T dist) const
+                    {
+                        return m_distanceFinder.Find(m_nodes,m_nodes.GetRootIndex(),point,dist);
+                    }
+                    /**
+                     * @brief Returns the nodes of the tree
+                     *
+                     * @return const FrozenNodeArray<Leaf,T,Dims,Distance>&
+                     */
+                    [[nodiscard]] inline const FrozenNodeArray<Leaf,T,Dims,Distance>& GetNodes() const noexcept {return m_nodes;}
+                    /**
+                     * @brief Returns number of stored points
+                     *
+                     * @return std::size_t
+                     */
+                    [[nodiscard]] inline std::size_t size() const noexcept {return m_nodes.GetPoints().size();}
+            };
+
+        } // namespace KDTree
+
+    } // namespace JJDataStruct
+
+#endif
@@ -0,0 +1,293 @@
+#ifndef FrozenNodeArray_hxx
+    #define FrozenNodeArray_hxx
+
+    #include <algorithm>
+    #include <array>
+    #include <cstdint>
+    #include <vector>
+
+    #include "Node.hxx"
+
+    namespace JJDataStruct
+    {
+        namespace KDTree
+        {
+            /**
+             * @brief Read-only view of points stored as a structure of arrays (one array per coordinate and an array of the Leaf-type objects), e.g. the packed points of a frozen tree. It does not own the memory it points to.
+             *
+             * @tparam Leaf Object type that will be stored in leafs
+             * @tparam T Arithmetic type of point coordinates
+             * @tparam Dims Number of dimensions
+             */
+            template <typename Leaf, typename T , std::size_t Dims>
+            class PackedPoints
+            {
+                private:
+                    std::array<const T*,Dims> m_columns;
+                    const Leaf *m_objects;
+                    std::size_t m_size;
+
+                public:
+                    /**
+                     * @brief Construct a new empty PackedPoints object
+                     *
+                     */
+                    PackedPoints() : m_columns{}, m_objects(nullptr), m_size(0) {}
+                    /**
+                     * @brief Construct a new PackedPoints object
+                     *
+                     * @param columns pointers to the coordinate arrays, one for each dimension
+                     * @param objects pointer to the array of objects
+                     * @param size number of points
+                     */
+                    PackedPoints(const std::array<const T*,Dims> &columns, const Leaf *objects, std::size_t size) : m_columns(columns), m_objects(objects), m_size(size) {}
+                    /**
+                     * @brief Call func(position,distance) for every point at positions [first,last), in order (see ForEachDistance in Metrics.hxx)
+                     *
+                     */
+                    template <typename Distance, typename Func>
+                    void ForEachDistance(std::size_t first, std::size_t last, const std::array<T,Dims> &query, Func &func) const
+                    {
+                        JJDataStruct::KDTree::ForEachDistance<Distance,T,Dims>(m_columns,first,last,query,func);
+                    }
+                    /**
+                     * @brief Get a copy of the point at position i
+                     *
+                     */
+                    [[nodiscard]] Point<Leaf,T,Dims> GetPoint(std::size_t i) const {return {m_objects[i],GetCoordinates(i)};}
+                    [[nodiscard]] std::array<T,Dims> GetCoordinates(std::size_t i) const noexcept
+                    {
+                        std::array<T,Dims> coords;
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            coords[dim] = m_columns[dim][i];
+
+                        return coords;
+                    }
+                    [[nodiscard]] inline T GetCoordinate(std::size_t i, std::size_t dim) const noexcept {return m_columns[dim][i];}
+                    [[nodiscard]] inline const Leaf& GetObject(std::size_t i) const noexcept {return m_objects[i];}
+                    [[nodiscard]] inline const T* GetColumn(std::size_t dim) const noexcept {return m_columns[dim];}
+                    [[nodiscard]] inline const Leaf* GetObjects() const noexcept {return m_objects;}
+                    [[nodiscard]] inline std::size_t size() const noexcept {return m_size;}
+                    [[nodiscard]] inline bool IsEmpty() const noexcept {return m_size == 0;}
+            };
+
+            /**
+             * @brief Compact record of a node of a frozen tree. A split node keeps the indices of its children, a leaf keeps the range of positions of its points in the packed points of the tree.
+             *
+             * @tparam T Arithmetic type of point coordinates
+             */
+            template <typename T>
+            struct FrozenNodeRecord
+            {
+                /**
+                 * @brief Value of dimensionIndex which marks a leaf
+                 *
+                 */
+                static constexpr std::uint32_t LeafMarker = InvalidIndex;
+
+                T median;
+                std::uint32_t dimensionIndex;
+                std::uint32_t first, second; // left and right child of a split node or [first,second) positions of the points of a leaf
+            };
+
+            /**
+             * @brief Van Emde Boas layout of the nodes of a frozen tree: the top half (by height) of the tree is stored first, followed by every subtree hanging below it, each of them laid out the same way recursively.
+             * Every subtree of any height is then stored in a few contiguous pieces, so a search from the root to a leaf touches few cache lines and pages, whatever their size.
+             *
+             * @tparam T Arithmetic type of point coordinates
+             */
+            template <typename T>
+            class VanEmdeBoasLayout
+            {
+                private:
+                    using Record = FrozenNodeRecord<T>;
+
+                    [[nodiscard]] static bool IsSplit(const Record &record) noexcept {return record.dimensionIndex != Record::LeafMarker;}
+                    static std::size_t GetHeight(const std::vector<Record> &records, std::uint32_t index)
+                    {
+                        const Record &record = records[index];
+                        return (IsSplit(record)) ? 1 + std::max(GetHeight(records,record.first),GetHeight(records,record.second)) : 1;
+                    }
+                    static void CollectAtDepth(const std::vector<Record> &records, std::uint32_t index, std::size_t depth, std::vector<std::uint32_t> &out)
+                    {
+                        if (depth == 0)
+                        {
+                            out.push_back(index);
+                        }
+                        else if (IsSplit(records[index]))
+                        {
+                            CollectAtDepth(records,records[index].first,depth - 1,out);
+                            CollectAtDepth(records,records[index].second,depth - 1,out);
+                        }
+                    }
+                    /**
+                     * @brief Append the nodes of the subtree at index, cut off at the given height, in van Emde Boas order
+                     *
+                     */
+                    static void Layout(const std::vector<Record> &records, std::uint32_t index, std::size_t height, std::vector<std::uint32_t> &order)
+                    {
+                        if (height == 1 || !IsSplit(records[index]))
+                        {
+                            order.push_back(index);
+                            return;
+                        }
+
+                        const std::size_t topHeight = height / 2;
+                        Layout(records,index,topHeight,order);
+
+                        std::vector<std::uint32_t> bottomRoots;
+                        CollectAtDepth(records,index,topHeight,bottomRoots);
+                        for (std::uint32_t bottomRoot : bottomRoots)
+                            Layout(records,bottomRoot,height - topHeight,order);
+                    }
+
+                public:
+                    /**
+                     * @brief Reorder the nodes of a tree into van Emde Boas order (the leaves keep their ranges of points)
+                     *
+                     * @param records nodes of the tree, with the root at index 0 and the children referred to by their index
+                     * @return the same nodes in van Emde Boas order (root at index 0) with updated child indices
+                     */
+                    [[nodiscard]] static std::vector<Record> Apply(const std::vector<Record> &records)
+                    {
+                        if (records.empty())
+                            return {};
+
+                        std::vector<std::uint32_t> order;
+                        order.reserve(records.size());
+                        Layout(records,0,GetHeight(records,0),order);
+
+                        std::vector<std::uint32_t> newIndices(records.size(),InvalidIndex);
+                        for (std::size_t i = 0; i < order.size(); ++i)
+                            newIndices[order[i]] = static_cast<std::uint32_t>(i);
+
+                        std::vector<Record> laidOut;
+                        laidOut.reserve(order.size());
+                        for (std::uint32_t index : order)
+                        {
+                            Record record = records[index];
+                            if (IsSplit(record))
+                            {
+                                record.first = newIndices[record.first];
+                                record.second = newIndices[record.second];
+                            }
+                            laidOut.push_back(record);
+                        }
+
+                        return laidOut;
+                    }
+            };
+
+            /**
+             * @brief Read-only array of the nodes of a frozen tree, together with the points stored in its leaves. It does not own the memory it points to (see FrozenKDTree).
+             * The root node sits at index 0. It can be searched by the same finders as NodeArray.
+             *
+             * @tparam Leaf Object type that will be stored in leafs
+             * @tparam T Arithmetic type of point coordinates
+             * @tparam Dims Number of dimensions over which the data will be divided
+             * @tparam Distance Metric upon which the distance will be calculated
+             */
+            template <typename Leaf, typename T , std::size_t Dims, typename Distance>
+            class FrozenNodeArray
+            {
+                public:
+                    using BucketType = PackedPoints<Leaf,T,Dims>;
+                    using Record = FrozenNodeRecord<T>;
+
+                    /**
+                     * @brief Node of a frozen tree as seen by the finders, with the same interface as Node. It is a lightweight handle, returned by value.
+                     *
+                     */
+                    class NodeView
+                    {
+                        private:
+                            const Record *m_record;
+                            const BucketType *m_points;
+
+                        public:
+                            NodeView(const Record *record, const BucketType *points) noexcept : m_record(record), m_points(points) {}
+                            [[nodiscard]] std::uint32_t GetChildIndex(const Point<Leaf,T,Dims> &point) const noexcept
+                            {
+                                return (point.coords[m_record->dimensionIndex] > m_record->median) ? m_record->second : m_record->first;
+                            }
+                            [[nodiscard]] std::uint32_t GetOtherChildIndex(const Point<Leaf,T,Dims> &point) const noexcept
+                            {
+                                return (point.coords[m_record->dimensionIndex] <= m_record->median) ? m_record->second : m_record->first;
+                            }
+                            [[nodiscard]] T CalculateDistanceToMedian(const Point<Leaf,T,Dims> &point) const noexcept
+                            {
+                                return Distance::axisDistance(point.coords[m_record->dimensionIndex],m_record->median);
+                            }
+                            /**
+                             * @brief Call func(position,distance) for every point stored in this leaf, in order (the position refers to the packed points, see GetBucket)
+                             *
+                             */
+                            template <typename Func>
+                            void ForEachDistance(const Point<Leaf,T,Dims> &point, Func func) const
+                            {
+                                m_points->template ForEachDistance<Distance>(m_record->first,m_record->second,point.coords,func);
+                            }
+                            /**
+                             * @brief Call func(position,distance) for the first nPoints points stored in this leaf, in order
+                             *
+                             */
+                            template <typename Func>
+                            void ForEachDistance(const Point<Leaf,T,Dims> &point, std::size_t nPoints, Func func) const
+                            {
+                                m_points->template ForEachDistance<Distance>(m_record->first,m_record->first + std::min<std::size_t>(nPoints,size()),point.coords,func);
+                            }
+                            /**
+                             * @brief Append all points within distance to outVec
+                             *
+                             */
+                            void FindWithinDistance(const Point<Leaf,T,Dims> &point, T dist, std::vector<Point<Leaf,T,Dims> > &outVec) const
+                            {
+                                ForEachDistance(point,[this,&outVec,&dist](std::size_t i, T ptDist)
+                                {
+                                    if (ptDist <= dist)
+                                        outVec.push_back(m_points->GetPoint(i));
+                                });
+                            }
+                            [[nodiscard]] inline const BucketType& GetBucket() const noexcept {return *m_points;}
+                            [[nodiscard]] inline std::size_t size() const noexcept {return IsSplit() ? 0 : m_record->second - m_record->first;}
+                            [[nodiscard]] inline bool IsSplit() const noexcept {return m_record->dimensionIndex != Record::LeafMarker;}
+                            [[nodiscard]] inline T GetMedian() const noexcept {return m_record->median;}
+                            [[nodiscard]] inline std::size_t GetDimensionIndex() const noexcept {return m_record->dimensionIndex;}
+                            [[nodiscard]] inline std::uint32_t GetLeftIndex() const noexcept {return IsSplit() ? m_record->first : InvalidIndex;}
+                            [[nodiscard]] inline std::uint32_t GetRightIndex() const noexcept {return IsSplit() ? m_record->second : InvalidIndex;}
+                    };
+
+                private:
+                    const Record *m_records;
+                    std::size_t m_nRecords;
+                    BucketType m_points;
+
+                public:
+                    /**
+                     * @brief Construct a new empty FrozenNodeArray object (without even a root node)
+                     *
+                     */
+                    FrozenNodeArray() : m_records(nullptr), m_nRecords(0), m_points() {}
+                    /**
+                     * @brief Construct a new FrozenNodeArray object
+                     *
+                     * @param records pointer to the node records (root first)
+                     * @param nRecords number of nodes
+                     * @param points points stored in the leaves
+                     */
+                    FrozenNodeArray(const Record *records, std::size_t nRecords, const BucketType &points) : m_records(records), m_nRecords(nRecords), m_points(points) {}
+                    [[nodiscard]] inline NodeView operator[](std::uint32_t index) const noexcept {return NodeView(m_records + index,&m_points);}
+                    [[nodiscard]] inline static constexpr std::uint32_t GetRootIndex() noexcept {return 0;}
+                    [[nodiscard]] inline bool IsValidIndex(std::uint32_t index) const noexcept {return index < m_nRecords;}
+                    [[nodiscard]] inline bool IsEmpty() const noexcept {return m_nRecords == 0;}
+                    [[nodiscard]] inline std::size_t GetNumberOfNodes() const noexcept {return m_nRecords;}
+                    [[nodiscard]] inline const Record* GetRecords() const noexcept {return m_records;}
+                    [[nodiscard]] inline const BucketType& GetPoints() const noexcept {return m_points;}
+            };
+
+        } // namespace KDTree
+
+    } // namespace JJDataStruct
+
+
+#endif
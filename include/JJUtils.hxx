@@ -1,6 +1,11 @@
 #include <tuple>
 #include <vector>
+#include <deque>
+#include <limits>
 #include <algorithm>
+#include <future>
+#include <functional>
+#include <optional>
 
 #ifndef JJUtils_hxx
     #define JJUtils_hxx
@@ -27,6 +32,151 @@
             return std::make_pair(left,right);
         }
 
+        /**
+         * @brief Split [0,size) into nThreads contiguous chunks and call func(begin,end,chunkIndex) for each of them concurrently. The first chunk is processed by the calling thread. Exceptions thrown by func are rethrown here.
+         * 
+         * @tparam Func function of signature (std::size_t,std::size_t,unsigned) -> void
+         * @param size number of elements to process
+         * @param nThreads number of chunks (and threads) to use
+         * @param func function processing a single chunk
+         */
+        template <typename Func>
+        void for_each_chunk(std::size_t size, unsigned nThreads, Func func)
+        {
+            nThreads = static_cast<unsigned>(std::max<std::size_t>(1,std::min<std::size_t>(nThreads,size)));
+            std::vector<std::future<void> > tasks;
+            tasks.reserve(nThreads - 1);
+
+            for (unsigned chunk = 1; chunk < nThreads; ++chunk)
+            {
+                tasks.push_back(std::async(std::launch::async,func,size * chunk / nThreads,size * (chunk + 1) / nThreads,chunk));
+            }
+            func(std::size_t(0),size / nThreads,0u);
+
+            for (auto &task : tasks)
+                task.get();
+        }
+
+        /**
+         * @brief Priority queue which keeps at most capacity() smallest elements pushed into it. The largest of the kept elements is at the top, so it can be used as a bound for the elements which are still worth pushing. Storage is reserved once and reused after clear().
+         * 
+         * @tparam T the type of the elements
+         * @tparam Compare strict weak ordering of the elements
+         */
+        template <typename T, typename Compare = std::less<T> >
+        class bounded_priority_queue
+        {
+            public:
+                /**
+                 * @brief Construct a new bounded priority queue object
+                 * 
+                 * @param capacity maximal number of elements kept in the queue
+                 * @param comp comparison object
+                 */
+                explicit bounded_priority_queue(std::size_t capacity = 0, Compare comp = Compare()) : m_capacity(capacity), m_comp(comp), m_heap() {m_heap.reserve(capacity);}
+                /**
+                 * @brief Get the number of elements
+                 * 
+                 * @return std::size_t 
+                 */
+                inline std::size_t size() const {return m_heap.size();}
+                /**
+                 * @brief Get the maximal number of elements
+                 * 
+                 * @return std::size_t 
+                 */
+                inline std::size_t capacity() const {return m_capacity;}
+                /**
+                 * @brief Check if the container is empty
+                 * 
+                 * @return true is empty and
+                 * @return false otherwise
+                 */
+                inline bool empty() const {return m_heap.empty();}
+                /**
+                 * @brief Check if the container holds capacity() elements, i.e. new elements have to be smaller than top() to be kept
+                 * 
+                 * @return true if full and
+                 * @return false otherwise
+                 */
+                inline bool full() const {return m_heap.size() >= m_capacity;}
+                /**
+                 * @brief Get the largest of the kept elements. The container must not be empty
+                 * 
+                 * @return const T& 
+                 */
+                inline const T& top() const {return m_heap.front();}
+                /**
+                 * @brief Add a new element if there is still room or if it is smaller than top() (which is then dropped)
+                 * 
+                 * @param value 
+                 * @return true if the element was kept and
+                 * @return false otherwise
+                 */
+                bool push(const T &value)
+                {
+                    if (m_heap.size() < m_capacity)
+                    {
+                        m_heap.push_back(value);
+                        std::push_heap(m_heap.begin(),m_heap.end(),m_comp);
+                        return true;
+                    }
+                    else if (m_capacity > 0 && m_comp(value,m_heap.front()))
+                    {
+                        std::pop_heap(m_heap.begin(),m_heap.end(),m_comp);
+                        m_heap.back() = value;
+                        std::push_heap(m_heap.begin(),m_heap.end(),m_comp);
+                        return true;
+                    }
+                    return false;
+                }
+                /**
+                 * @brief Remove all elements and set a new capacity (the storage is kept)
+                 * 
+                 * @param capacity maximal number of elements kept in the queue
+                 */
+                void reset(std::size_t capacity) {m_heap.clear(); m_heap.reserve(capacity); m_capacity = capacity;}
+                /**
+                 * @brief Remove all elements (the storage is kept)
+                 * 
+                 */
+                void clear() {m_heap.clear();}
+                /**
+                 * @brief Sort the kept elements in ascending order. Afterwards the container is no longer a heap, so it has to be cleared before pushing into it again
+                 * 
+                 */
+                void sort() {std::sort_heap(m_heap.begin(),m_heap.end(),m_comp);}
+                /**
+                 * @brief Get the iterator pointing at the beginnig of the container
+                 * 
+                 * @return std::vector<T>::const_iterator 
+                 */
+                typename std::vector<T>::const_iterator begin() const {return m_heap.begin();}
+                /**
+                 * @brief Get the iterator pointing at the one-after-last element of the container
+                 * 
+                 * @return std::vector<T>::const_iterator 
+                 */
+                typename std::vector<T>::const_iterator end() const {return m_heap.end();}
+
+            private:
+                /**
+                 * @brief Maximal number of kept elements
+                 * 
+                 */
+                std::size_t m_capacity;
+                /**
+                 * @brief Comparison object
+                 * 
+                 */
+                Compare m_comp;
+                /**
+                 * @brief Underlying container (a max-heap with respect to m_comp)
+                 * 
+                 */
+                std::vector<T> m_heap;
+        };
+
         /**
          * @brief Container which acts as a FILO queue with a certain size limit. It will add new elements at the back and pop elements at the front once the size of the container has exceeded the maximal size of the buffer
          * 
@@ -59,12 +209,26 @@
                  * @param fsd other fixed_size_deque object
                  */
                 fixed_size_deque(fixed_size_deque &&fsd) : m_maxSize(std::move(fsd.m_maxSize)), m_deque(std::move(fsd.m_deque)) {}
+                fixed_size_deque& operator=(const fixed_size_deque&) = default;
+                fixed_size_deque& operator=(fixed_size_deque&&) = default;
                 /**
                  * @brief Get the number of elements
                  * 
                  * @return std::size_t 
                  */
                 inline std::size_t size() const {return m_deque.size();}
+                /**
+                 * @brief Get the max buffer size
+                 * 
+                 * @return std::size_t 
+                 */
+                inline std::size_t max_size() const {return m_maxSize;}
+                /**
+                 * @brief Get the oldest element. The container must not be empty
+                 * 
+                 * @return const T& 
+                 */
+                inline const T& front() const {return m_deque.front();}
                 /**
                  * @brief Get the iterator pointing at the beginnig of the container
                  * 
@@ -90,17 +254,25 @@
                  */
                 typename std::deque<T>::const_iterator end() const {return m_deque.end();}
                 /**
-                 * @brief Add a new element at the end. This method will also call std::deque::pop_front if the size of the container exceeds the max buffer size
+                 * @brief Add a new element at the end. This method will also pop the front element if the size of the container exceeds the max buffer size
                  * 
                  * @param value 
+                 * @return the popped element or std::nullopt if nothing had to be popped
                  */
-                void push_back(const T &value) {m_deque.push_back(value); if (m_deque.size() > m_maxSize) m_deque.pop_front();}
+                std::optional<T> push_back(const T &value) {m_deque.push_back(value); return pop_overflow();}
                 /**
-                 * @brief Add a new element at the end. This method will also call std::deque::pop_front if the size of the container exceeds the max buffer size
+                 * @brief Add a new element at the end. This method will also pop the front element if the size of the container exceeds the max buffer size
                  * 
                  * @param value 
+                 * @return the popped element or std::nullopt if nothing had to be popped
                  */
-                void push_back(T &&value) {m_deque.push_back(std::move(value)); if (m_deque.size() > m_maxSize) m_deque.pop_front();}
+                std::optional<T> push_back(T &&value) {m_deque.push_back(std::move(value)); return pop_overflow();}
+                /**
+                 * @brief Remove the oldest element. The container must not be empty
+                 * 
+                 * @return T the removed element
+                 */
+                T pop_front() {T value = std::move(m_deque.front()); m_deque.pop_front(); return value;}
                 /**
                  * @brief Check if the container is empty
                  * 
@@ -110,6 +282,13 @@
                 bool empty() const {return m_deque.empty();}
 
             private:
+                std::optional<T> pop_overflow()
+                {
+                    if (m_deque.size() > m_maxSize)
+                        return pop_front();
+
+                    return std::nullopt;
+                }
                 /**
                  * @brief Max buffer size of the container
                  * 
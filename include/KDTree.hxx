@@ -13,7 +13,10 @@
     #define KDTree_hxx
 
     #include <iostream>
-    #include <functional>
+    #include <iterator>
+    #include <limits>
+    #include <memory_resource>
+    #include <tuple>
 
     #include "Actions.hxx"
 
@@ -28,48 +31,112 @@
              * @tparam Dims Number of dimensions over which the data will be divided
              * @tparam T Arithmetic type of point coordinates
              * @tparam Distance Metric upon which the distance will be calculated
+             * @tparam BucketCapacity capacity of the points stored inside each node (see FixedBucket, the bucket size cannot exceed it) or 0 for growing buckets (see Bucket)
+             * @tparam SplitPolicy how the points of a node are split between its children: CyclicMedianSplit (default), MaxSpreadSplit, SlidingMidpointSplit or SurfaceAreaSplit
              */
-            template <typename Leaf, std::size_t Dims, typename T = double, typename Distance = SquaredDist> 
+            template <typename Leaf, std::size_t Dims, typename T = double, typename Distance = SquaredDist, std::size_t BucketCapacity = 0, typename SplitPolicy = CyclicMedianSplit> 
             class KDTree
             {
                 private:
                     bool m_isSplit;
                     std::size_t m_bucketSize, m_maxSizeBeforeSplit;
+                    unsigned m_buildThreads;
                     std::vector<Point<Leaf,T,Dims> > m_storedData;
-                    std::shared_ptr<Node<Leaf,T,Dims,Distance> > m_rootNode;
+                    JJUtils::fixed_size_deque<PointHandle> m_window; // handles of the points added since the sliding window was enabled, oldest first (max_size() == 0 if it is disabled)
+                    NodeArray<Leaf,T,Dims,Distance,BucketCapacity,SplitPolicy> m_nodes;
                     Inserter<Leaf,T,Dims,Distance> m_inserter;
                     Deleter<Leaf,T,Dims,Distance> m_deleter;
                     NearestFinder<Leaf,T,Dims,Distance> m_nearestFinder;
                     NNearestFinder<Leaf,T,Dims,Distance> m_nNearestFinder;
                     DistanceFinder<Leaf,T,Dims,Distance> m_distanceFinder;
+                    BoxFinder<Leaf,T,Dims,Distance> m_boxFinder;
+                    Counter<Leaf,T,Dims,Distance> m_counter;
+                    mutable QueryStatsRecorder m_queryStats; // present with or without KDTREE_ENABLE_STATS, so the layout of the tree does not depend on it
 
-                    void Print(const std::string &prefix, std::shared_ptr<Node<Leaf,T,Dims,Distance> > node, bool isLeft) const
+                    /**
+                     * @brief Record the handle of a point just added in the sliding window (if enabled) and remove the oldest recorded point from the tree if the window overflows. 
+                     * A point which is gone already (removed through its handle or by a rebuild) is skipped.
+                     * 
+                     */
+                    void Slide(PointHandle handle)
                     {
-                        if( node != nullptr )
+                        if (m_window.max_size() > 0)
                         {
+                            auto evicted = m_window.push_back(handle);
+                            if (evicted.has_value())
+                                m_nodes.Remove(evicted.value());
+                        }
+                    }
+                    /**
+                     * @brief Clear the counters of the query starting on the calling thread (does nothing unless KDTREE_ENABLE_STATS is defined)
+                     * 
+                     */
+                    void BeginQuery() const noexcept
+                    {
+                        #ifdef KDTREE_ENABLE_STATS
+                        QueryStats::Current() = QueryStats();
+                        #endif
+                    }
+                    /**
+                     * @brief Record the counters of the query finished on the calling thread (does nothing unless KDTREE_ENABLE_STATS is defined)
+                     * 
+                     */
+                    void EndQuery([[maybe_unused]] std::size_t resultSize) const noexcept
+                    {
+                        #ifdef KDTREE_ENABLE_STATS
+                        QueryStats::Current().resultSize = resultSize;
+                        m_queryStats.Record(QueryStats::Current());
+                        #endif
+                    }
+                    /**
+                     * @brief Add the counters of the query finished on the calling thread to the statistics of a chunk of a batched search, which are recorded at once by EndChunk (does nothing unless KDTREE_ENABLE_STATS is defined)
+                     * 
+                     */
+                    void EndQuery([[maybe_unused]] std::size_t resultSize, [[maybe_unused]] QueryStatsSummary &chunkStats) const noexcept
+                    {
+                        #ifdef KDTREE_ENABLE_STATS
+                        QueryStats::Current().resultSize = resultSize;
+                        chunkStats.Add(QueryStats::Current());
+                        #endif
+                    }
+                    /**
+                     * @brief Record the statistics of a finished chunk of a batched search (does nothing unless KDTREE_ENABLE_STATS is defined)
+                     * 
+                     */
+                    void EndChunk([[maybe_unused]] const QueryStatsSummary &chunkStats) const noexcept
+                    {
+                        #ifdef KDTREE_ENABLE_STATS
+                        m_queryStats.Record(chunkStats);
+                        #endif
+                    }
+                    void Print(const std::string &prefix, std::uint32_t index, bool isLeft) const
+                    {
+                        if( index != InvalidIndex )
+                        {
+                            const Node<Leaf,T,Dims,Distance,BucketCapacity> &node = m_nodes[index];
                             std::cout << prefix;
 
                             std::cout << (isLeft ? "├──" : "└──" );
 
                             // print the value of the node
-                            if (node->IsSplit())
+                            if (node.IsSplit())
                             {
-                                std::cout << node->GetMedian() << "\n";
+                                std::cout << node.GetMedian() << "\n";
                             }
                             else
                             {
                                 std::cout << "[";
-                                for (const auto &elem : node->GetData())
+                                for (const auto &elem : node.GetData())
                                 {
                                     std::cout << elem.object.id << ", ";
                                 }
                                 std::cout << "]\n";
                             }
-                            //std::cout << (node->IsSplit() ? node->GetMedian() : node->size()) << std::endl;
+                            //std::cout << (node.IsSplit() ? node.GetMedian() : node.size()) << std::endl;
 
                             // enter the next tree level - left and right branch
-                            Print( prefix + (isLeft ? "│   " : "    "), node->GetLeftNode(), true);
-                            Print( prefix + (isLeft ? "│   " : "    "), node->GetRightNode(), false);
+                            Print( prefix + (isLeft ? "│   " : "    "), node.GetLeftIndex(), true);
+                            Print( prefix + (isLeft ? "│   " : "    "), node.GetRightIndex(), false);
                         }
                     }
 
@@ -80,13 +147,47 @@
                      * @param bucketSize the maximal size of each bucket before it splits into two nodes
                      * @param maxSize the maximal size of points which will be stored in the KDTree before it splits (it is better to first collect many points and only split the tree after; this will result in a more balanced tree)
                      * @param data data that can be passed into the tree at construction (or use AddPoint method to add them later)
+                     * @param buildThreads number of threads used whenever the tree is built (see SetBuildThreads)
+                     * @param resource memory resource from which the nodes and the buckets of the split tree are allocated; it has to outlive the tree and be thread safe if buildThreads > 1 (a copy of the tree uses the default resource)
                      */
-                    constexpr KDTree(std::size_t bucketSize, std::size_t maxSize = 10000, std::vector<Point<Leaf,T,Dims> > data = {}) : m_isSplit(false), m_bucketSize(bucketSize), m_maxSizeBeforeSplit(maxSize), 
-                        m_storedData(data), m_rootNode(nullptr),m_inserter(),m_deleter(),m_nearestFinder(),m_nNearestFinder(),m_distanceFinder()
+                    constexpr KDTree(std::size_t bucketSize, std::size_t maxSize = 10000, std::vector<Point<Leaf,T,Dims> > data = {}, unsigned buildThreads = 1, std::pmr::memory_resource *resource = std::pmr::get_default_resource()) : m_isSplit(false), m_bucketSize(bucketSize), m_maxSizeBeforeSplit(maxSize), m_buildThreads(std::max(buildThreads,1u)),
+                        m_storedData(std::move(data)), m_window(0), m_nodes(bucketSize,resource),m_inserter(),m_deleter(),m_nearestFinder(),m_nNearestFinder(),m_distanceFinder(),m_boxFinder(),m_counter(),m_queryStats()
                     {
                         if (m_storedData.size() > maxSize)
                             SplitTree();
                     }
+                    /**
+                     * @brief Construct a new KDTree object and build a balanced tree from [first,last) at once (see BuildTree)
+                     * 
+                     * @tparam InputIt input iterator over Point<Leaf,T,Dims>
+                     * @param bucketSize the maximal size of each bucket before it splits into two nodes
+                     * @param first beginning of the range of points
+                     * @param last end of the range of points
+                     * @param resource memory resource from which the nodes and the buckets are allocated (it has to outlive the tree)
+                     */
+                    template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+                    KDTree(std::size_t bucketSize, InputIt first, InputIt last, std::pmr::memory_resource *resource = std::pmr::get_default_resource()) : KDTree(bucketSize,10000,{},1,resource)
+                    {
+                        BuildTree(first,last);
+                    }
+                    /**
+                     * @brief Build a balanced tree at once from all the points stored so far together with the points from [first,last). 
+                     * The points are partitioned in place around the median of each level (selection instead of sorting), so the whole build takes O(n log n).
+                     * 
+                     * @tparam InputIt input iterator over Point<Leaf,T,Dims>
+                     * @param first beginning of the range of points
+                     * @param last end of the range of points
+                     */
+                    template <typename InputIt>
+                    void BuildTree(InputIt first, InputIt last)
+                    {
+                        std::vector<Point<Leaf,T,Dims> > data = (m_isSplit) ? m_nodes.Release() : std::move(m_storedData);
+                        m_storedData.clear();
+                        data.insert(data.end(),first,last);
+
+                        m_isSplit = true;
+                        m_nodes.Build(std::move(data),m_buildThreads);
+                    }
                     /**
                      * @brief Split the tree. 
                      * It is better to first collect many points and only split the tree after. This will result in a more balanced tree.
@@ -94,10 +195,11 @@
                      */
                     void SplitTree()
                     {
-                        m_isSplit = true;
-                        if (m_rootNode == nullptr)
+                        if (!m_isSplit)
                         {
-                            m_rootNode = std::make_shared<Node<Leaf,T,Dims,Distance> >(std::move(m_storedData), nullptr, 0, m_bucketSize);
+                            m_isSplit = true;
+                            m_nodes.Build(std::move(m_storedData),m_buildThreads);
+                            m_storedData.clear();
                         }
                     }
                     /**
@@ -109,7 +211,12 @@
                      */
                     bool AddPoint(Point<Leaf,T,Dims> &&point)
                     {
-                        if (m_rootNode == nullptr)
+                        if (m_window.max_size() > 0)
+                        {
+                            AddPointWithHandle(std::move(point));
+                            return true;
+                        }
+                        if (!m_isSplit)
                         {
                             m_storedData.push_back(std::move(point));
                             if (m_storedData.size() > m_maxSizeBeforeSplit)
@@ -119,7 +226,7 @@
                         }
                         else
                         {
-                            return m_inserter.Insert(m_rootNode,std::move(point));
+                            return m_inserter.Insert(m_nodes,m_nodes.GetRootIndex(),std::move(point));
                         }
                     }
                     /**
@@ -131,7 +238,12 @@
                      */
                     bool AddPoint(const Point<Leaf,T,Dims> &point)
                     {
-                        if (m_rootNode == nullptr)
+                        if (m_window.max_size() > 0)
+                        {
+                            AddPointWithHandle(point);
+                            return true;
+                        }
+                        if (!m_isSplit)
                         {
                             m_storedData.push_back(point);
                             if (m_storedData.size() > m_maxSizeBeforeSplit)
@@ -141,9 +253,41 @@
                         }
                         else
                         {
-                            return m_inserter.Insert(m_rootNode,point);
+                            return m_inserter.Insert(m_nodes,m_nodes.GetRootIndex(),Point<Leaf,T,Dims>(point));
                         }
                     }
+                    /**
+                     * @brief Add point to the tree and get a handle, through which the point can be removed in O(1) without searching for it (see RemovePoint(PointHandle)).
+                     * A tree which is not split yet is split first, as only the points stored in the nodes can have a handle. The handle stays valid as the point moves between nodes when they split or join, but rebuilding the tree (BuildTree) invalidates all the handles.
+                     * 
+                     * @param point 
+                     * @return PointHandle handle of the added point
+                     */
+                    PointHandle AddPointWithHandle(Point<Leaf,T,Dims> point)
+                    {
+                        SplitTree();
+                        const PointHandle handle = m_inserter.InsertWithHandle(m_nodes,m_nodes.GetRootIndex(),std::move(point));
+                        Slide(handle);
+                        return handle;
+                    }
+                    /**
+                     * @brief Remove the point held by handle in O(1): the point takes no search and no comparison of the Leaf-type objects. Its leaf is joined with its sibling only once they have shrunk to half a bucket together, so alternating insertions and removals do not split and join the same leaves over and over.
+                     * 
+                     * @param handle handle given by AddPointWithHandle
+                     * @return the removed point or std::nullopt if the handle is no longer valid (the point was removed already or the tree was rebuilt)
+                     */
+                    std::optional<Point<Leaf,T,Dims>> RemovePoint(PointHandle handle)
+                    {
+                        return m_nodes.Remove(handle);
+                    }
+                    /**
+                     * @brief Check whether handle still holds a point of this tree
+                     * 
+                     */
+                    [[nodiscard]] bool IsValidHandle(PointHandle handle) const noexcept
+                    {
+                        return m_nodes.IsValidHandle(handle);
+                    }
                     /**
                      * @brief Remove point from the tree. Uses operator== of the stored Leaf-type object (so if you use your own class/struct, you have to implement it yourself)
                      * 
@@ -153,14 +297,17 @@
                      */
                     std::optional<Point<Leaf,T,Dims>> RemovePoint(const Point<Leaf,T,Dims> &point)
                     {
-                        if (m_rootNode == nullptr)
+                        if (!m_isSplit)
                         {
                             auto location = std::find(m_storedData.begin(),m_storedData.end(),point);
 
                             if (location != m_storedData.end())
                             {
-                                m_storedData.erase(std::remove(m_storedData.begin(),m_storedData.end(),point),m_storedData.end());
-                                return *location;
+                                Point<Leaf,T,Dims> removed = std::move(*location);
+                                if (location != m_storedData.end() - 1)
+                                    *location = std::move(m_storedData.back()); // the order of the points does not matter before the split
+                                m_storedData.pop_back();
+                                return removed;
                             }
                             else
                             {
@@ -169,7 +316,7 @@
                         }
                         else
                         {
-                            return m_deleter.Remove(m_rootNode,point);
+                            return m_deleter.Remove(m_nodes,m_nodes.GetRootIndex(),point);
                         }
                     }
                     /**
@@ -178,16 +325,19 @@
                      * @param pt Point to which the distance should be the smallest
                      * @return Point<Leaf,T,Dims> 
                      */
-                    [[nodiscard]] std::optional<Point<Leaf,T,Dims> > FindNearest(const Point<Leaf,T,Dims> &pt)
+                    [[nodiscard]] std::optional<Point<Leaf,T,Dims> > FindNearest(const Point<Leaf,T,Dims> &pt) const
                     {
-                        if (m_rootNode == nullptr)
+                        if (!m_isSplit)
                         {
                             std::cerr << "Tree is not split\n";
                             return {};
                         }
                         else
                         {
-                            return m_nearestFinder.Find(m_rootNode,pt);
+                            BeginQuery();
+                            auto nearest = m_nearestFinder.Find(m_nodes,m_nodes.GetRootIndex(),pt);
+                            EndQuery(nearest.has_value() ? 1 : 0);
+                            return nearest;
                         }
                     }
                     /**
@@ -197,16 +347,64 @@
                      * @param nPoints Number of closest points
                      * @return std::vector<Point<Leaf,T,Dims> > 
                      */
-                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > FindNNearest(const Point<Leaf,T,Dims> &pt, unsigned nPoints)
+                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > FindNNearest(const Point<Leaf,T,Dims> &pt, unsigned nPoints) const
+                    {
+                        if (!m_isSplit)
+                        {
+                            std::cerr << "Tree is not split\n";
+                            return {};
+                        }
+                        else
+                        {
+                            BeginQuery();
+                            auto closestPoints = m_nNearestFinder.Find(m_nodes,m_nodes.GetRootIndex(),pt,nPoints);
+                            EndQuery(closestPoints.size());
+                            return closestPoints;
+                        }
+                    }
+                    /**
+                     * @brief Find a nearly nearest point: at most (1 + epsilon) times further away than the nearest one, or the nearest one found before the budget of leaves or distance evaluations has been spent
+                     * 
+                     * @param pt Point to which the distance should be the smallest
+                     * @param options accuracy and budget of the search (see SearchOptions)
+                     * @return std::optional<Point<Leaf,T,Dims> > 
+                     */
+                    [[nodiscard]] std::optional<Point<Leaf,T,Dims> > FindNearest(const Point<Leaf,T,Dims> &pt, const SearchOptions &options) const
+                    {
+                        if (!m_isSplit)
+                        {
+                            std::cerr << "Tree is not split\n";
+                            return {};
+                        }
+                        else
+                        {
+                            BeginQuery();
+                            auto nearest = m_nearestFinder.FindApproximate(m_nodes,m_nodes.GetRootIndex(),pt,options);
+                            EndQuery(nearest.has_value() ? 1 : 0);
+                            return nearest;
+                        }
+                    }
+                    /**
+                     * @brief Find N nearly nearest points: each at most (1 + epsilon) times further away than the true one of the same rank, or the nearest ones found before the budget of leaves or distance evaluations has been spent (then there may be fewer than N of them)
+                     * 
+                     * @param pt Point to which the distance should be the smallest
+                     * @param nPoints Number of closest points
+                     * @param options accuracy and budget of the search (see SearchOptions)
+                     * @return std::vector<Point<Leaf,T,Dims> > 
+                     */
+                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > FindNNearest(const Point<Leaf,T,Dims> &pt, unsigned nPoints, const SearchOptions &options) const
                     {
-                        if (m_rootNode == nullptr)
+                        if (!m_isSplit)
                         {
                             std::cerr << "Tree is not split\n";
                             return {};
                         }
                         else
                         {
-                            return m_nNearestFinder.Find(m_rootNode,pt,nPoints);
+                            BeginQuery();
+                            auto closestPoints = m_nNearestFinder.FindApproximate(m_nodes,m_nodes.GetRootIndex(),pt,nPoints,options);
+                            EndQuery(closestPoints.size());
+                            return closestPoints;
                         }
                     }
                     /**
@@ -216,55 +414,347 @@
                      * @param dist Maximal distance from point (radius of the sphere)
                      * @return std::vector<Point<Leaf,T,Dims> > 
                      */
-                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > FindWithinDistance(const Point<Leaf,T,Dims> &point, T dist)
+                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > FindWithinDistance(const Point<Leaf,T,Dims> &point, T dist) const
+                    {
+                        if (!m_isSplit)
+                        {
+                            std::cerr << "Tree is not split\n";
+                            return {};
+                        }
+                        else
+                        {
+                            BeginQuery();
+                            auto closestPoints = m_distanceFinder.Find(m_nodes,m_nodes.GetRootIndex(),point,dist);
+                            EndQuery(closestPoints.size());
+                            return closestPoints;
+                        }
+                    }
+                    /**
+                     * @brief Call func for every point within distance, without copying the points into a vector
+                     * 
+                     * @tparam Func function of signature (const Leaf&, const std::array<T,Dims>&, T) -> void, called with the object, the coordinates and the distance of each point
+                     * @param point Reference point (center of the sphere)
+                     * @param dist Maximal distance from point (radius of the sphere)
+                     * @param func function to call
+                     */
+                    template <typename Func>
+                    void ForEachWithinDistance(const Point<Leaf,T,Dims> &point, T dist, Func func) const
+                    {
+                        if (!m_isSplit)
+                        {
+                            std::cerr << "Tree is not split\n";
+                        }
+                        else
+                        {
+                            BeginQuery();
+                            std::size_t nFound = 0;
+                            m_distanceFinder.ForEach(m_nodes,m_nodes.GetRootIndex(),point,dist,[&nFound,&func](const Leaf &object, const std::array<T,Dims> &coords, T distance)
+                            {
+                                ++nFound;
+                                func(object,coords,distance);
+                            });
+                            EndQuery(nFound);
+                        }
+                    }
+                    /**
+                     * @brief Count the points within distance. Subtrees lying entirely within the distance are counted from their cached sizes without visiting them.
+                     * 
+                     * @param point Reference point (center of the sphere)
+                     * @param dist Maximal distance from point (radius of the sphere)
+                     * @return std::size_t 
+                     */
+                    [[nodiscard]] std::size_t CountWithinDistance(const Point<Leaf,T,Dims> &point, T dist) const
+                    {
+                        if (!m_isSplit)
+                        {
+                            std::cerr << "Tree is not split\n";
+                            return 0;
+                        }
+                        else
+                        {
+                            BeginQuery();
+                            const std::size_t count = m_counter.CountWithinDistance(m_nodes,m_nodes.GetRootIndex(),point,dist);
+                            EndQuery(count);
+                            return count;
+                        }
+                    }
+                    /**
+                     * @brief Find all points inside an axis-aligned box
+                     * 
+                     * @param lower lowest corner of the box
+                     * @param upper highest corner of the box (the bounds are inclusive)
+                     * @return std::vector<Point<Leaf,T,Dims> > 
+                     */
+                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > FindInBox(const std::array<T,Dims> &lower, const std::array<T,Dims> &upper) const
                     {
-                        if (m_rootNode == nullptr)
+                        if (!m_isSplit)
                         {
                             std::cerr << "Tree is not split\n";
                             return {};
                         }
                         else
                         {
-                            return m_distanceFinder.Find(m_rootNode,point,dist);
+                            BeginQuery();
+                            auto foundPoints = m_boxFinder.Find(m_nodes,m_nodes.GetRootIndex(),lower,upper);
+                            EndQuery(foundPoints.size());
+                            return foundPoints;
                         }
                     }
+                    /**
+                     * @brief Count the points inside an axis-aligned box. Subtrees lying entirely inside the box are counted from their cached sizes without visiting them.
+                     * 
+                     * @param lower lowest corner of the box
+                     * @param upper highest corner of the box (the bounds are inclusive)
+                     * @return std::size_t 
+                     */
+                    [[nodiscard]] std::size_t CountInBox(const std::array<T,Dims> &lower, const std::array<T,Dims> &upper) const
+                    {
+                        if (!m_isSplit)
+                        {
+                            std::cerr << "Tree is not split\n";
+                            return 0;
+                        }
+                        else
+                        {
+                            BeginQuery();
+                            const std::size_t count = m_counter.CountInBox(m_nodes,m_nodes.GetRootIndex(),lower,upper);
+                            EndQuery(count);
+                            return count;
+                        }
+                    }
+                    /**
+                     * @brief Find the nearest point for each of the query points in [first,last). 
+                     * The results are written into caller-provided buffers, so reusing them between calls avoids allocations: the location of the nearest point to the i-th query is stored at outLocations[i] and its distance at outDistances[i]. 
+                     * The points themselves are not copied, they can be read through the locations (see GetPoint) until the tree is modified. A query without a result (the tree holds no points) gets an invalid location and the distance std::numeric_limits<T>::max().
+                     * 
+                     * @tparam RandomIt random access iterator over Point<Leaf,T,Dims>
+                     * @param first beginning of the range of query points
+                     * @param last end of the range of query points
+                     * @param outLocations buffer for the locations of the nearest points (resized to the number of queries)
+                     * @param outDistances buffer for the distances to the nearest points (resized to the number of queries)
+                     * @param nThreads number of threads across which the queries are split
+                     */
+                    template <typename RandomIt>
+                    void FindNearest(RandomIt first, RandomIt last, std::vector<PointLocation> &outLocations, std::vector<T> &outDistances, unsigned nThreads = 1) const
+                    {
+                        outLocations.clear();
+                        outDistances.clear();
+                        if (!m_isSplit)
+                        {
+                            std::cerr << "Tree is not split\n";
+                            return;
+                        }
+                        
+                        const auto nQueries = static_cast<std::size_t>(last - first);
+                        outLocations.resize(nQueries);
+                        outDistances.resize(nQueries);
+
+                        JJUtils::for_each_chunk(nQueries,nThreads,[&](std::size_t begin, std::size_t end, unsigned)
+                        {
+                            QueryStatsSummary chunkStats;
+                            for (std::size_t query = begin; query < end; ++query)
+                            {
+                                BeginQuery();
+                                std::tie(outLocations[query],outDistances[query]) = m_nearestFinder.FindLocation(m_nodes,m_nodes.GetRootIndex(),first[static_cast<std::ptrdiff_t>(query)]);
+                                EndQuery(outLocations[query].IsValid() ? 1 : 0,chunkStats);
+                            }
+                            EndChunk(chunkStats);
+                        });
+                    }
+                    /**
+                     * @brief Find the N nearest points for each of the query points in [first,last). 
+                     * Every query gets the same number of results k = min(nPoints,size()). The results are written into caller-provided flat buffers: the locations of the points closest to the i-th query are stored at outLocations[i*k,(i+1)*k), sorted by their distance, which is stored at the same positions of outDistances. 
+                     * The points themselves are not copied, they can be read through the locations (see GetPoint) until the tree is modified.
+                     * 
+                     * @tparam RandomIt random access iterator over Point<Leaf,T,Dims>
+                     * @param first beginning of the range of query points
+                     * @param last end of the range of query points
+                     * @param nPoints number of closest points to look for
+                     * @param outLocations buffer for the locations of the closest points (resized to k times the number of queries)
+                     * @param outDistances buffer for the distances to the closest points (resized to k times the number of queries)
+                     * @param nThreads number of threads across which the queries are split
+                     * @return std::size_t number of results per query (k)
+                     */
+                    template <typename RandomIt>
+                    std::size_t FindNNearest(RandomIt first, RandomIt last, unsigned nPoints, std::vector<PointLocation> &outLocations, std::vector<T> &outDistances, unsigned nThreads = 1) const
+                    {
+                        outLocations.clear();
+                        outDistances.clear();
+                        if (!m_isSplit)
+                        {
+                            std::cerr << "Tree is not split\n";
+                            return 0;
+                        }
+
+                        const auto nQueries = static_cast<std::size_t>(last - first);
+                        const std::size_t stride = std::min<std::size_t>(nPoints,size());
+                        outLocations.resize(nQueries * stride);
+                        outDistances.resize(nQueries * stride);
+                        if (stride == 0)
+                            return 0;
+
+                        JJUtils::for_each_chunk(nQueries,nThreads,[&](std::size_t begin, std::size_t end, unsigned)
+                        {
+                            QueryStatsSummary chunkStats;
+                            for (std::size_t query = begin; query < end; ++query)
+                            {
+                                BeginQuery();
+                                const std::size_t nFound = m_nNearestFinder.FindLocations(m_nodes,m_nodes.GetRootIndex(),first[static_cast<std::ptrdiff_t>(query)],static_cast<unsigned>(stride),outLocations.data() + query * stride,outDistances.data() + query * stride);
+                                EndQuery(nFound,chunkStats);
+                            }
+                            EndChunk(chunkStats);
+                        });
+
+                        return stride;
+                    }
+                    /**
+                     * @brief Find all points within distance for each of the query points in [first,last). 
+                     * The results are written into caller-provided flat buffers with CSR-style offsets: the locations of the points within distance of the i-th query are stored at outLocations[outOffsets[i],outOffsets[i+1]) and their distances at the same positions of outDistances. 
+                     * The points themselves are not copied, they can be read through the locations (see GetPoint) until the tree is modified.
+                     * 
+                     * @tparam RandomIt random access iterator over Point<Leaf,T,Dims>
+                     * @param first beginning of the range of query points
+                     * @param last end of the range of query points
+                     * @param dist maximal distance from each query point (radius of the sphere)
+                     * @param outLocations buffer for the locations of the found points
+                     * @param outDistances buffer for the distances to the found points
+                     * @param outOffsets buffer for the offsets of the results of each query (resized to the number of queries + 1)
+                     * @param nThreads number of threads across which the queries are split
+                     */
+                    template <typename RandomIt>
+                    void FindWithinDistance(RandomIt first, RandomIt last, T dist, std::vector<PointLocation> &outLocations, std::vector<T> &outDistances, std::vector<std::size_t> &outOffsets, unsigned nThreads = 1) const
+                    {
+                        outLocations.clear();
+                        outDistances.clear();
+                        outOffsets.assign(1,0);
+                        if (!m_isSplit)
+                        {
+                            std::cerr << "Tree is not split\n";
+                            return;
+                        }
+
+                        const auto nQueries = static_cast<std::size_t>(last - first);
+                        outOffsets.resize(nQueries + 1);
+                        nThreads = static_cast<unsigned>(std::max<std::size_t>(1,std::min<std::size_t>(nThreads,nQueries)));
+
+                        // each chunk collects its results separately (the first one directly into the output), then they are concatenated in order
+                        std::vector<std::vector<PointLocation> > chunkLocations(nThreads - 1);
+                        std::vector<std::vector<T> > chunkDistances(nThreads - 1);
+                        JJUtils::for_each_chunk(nQueries,nThreads,[&](std::size_t begin, std::size_t end, unsigned chunk)
+                        {
+                            auto &locations = (chunk == 0) ? outLocations : chunkLocations[chunk - 1];
+                            auto &distances = (chunk == 0) ? outDistances : chunkDistances[chunk - 1];
+                            QueryStatsSummary chunkStats;
+                            for (std::size_t query = begin; query < end; ++query)
+                            {
+                                const std::size_t firstResult = locations.size();
+                                BeginQuery();
+                                m_distanceFinder.FindLocations(m_nodes,m_nodes.GetRootIndex(),first[static_cast<std::ptrdiff_t>(query)],dist,locations,distances);
+                                EndQuery(locations.size() - firstResult,chunkStats);
+
+                                outOffsets[query + 1] = locations.size(); // offset local to the chunk, fixed below
+                            }
+                            EndChunk(chunkStats);
+                        });
+
+                        for (unsigned chunk = 1; chunk < nThreads; ++chunk)
+                        {
+                            const std::size_t shift = outLocations.size();
+                            for (std::size_t query = nQueries * chunk / nThreads; query < nQueries * (chunk + 1) / nThreads; ++query)
+                                outOffsets[query + 1] += shift;
+
+                            outLocations.insert(outLocations.end(),chunkLocations[chunk - 1].begin(),chunkLocations[chunk - 1].end());
+                            outDistances.insert(outDistances.end(),chunkDistances[chunk - 1].begin(),chunkDistances[chunk - 1].end());
+                        }
+                    }
+                    /**
+                     * @brief Returns a copy of the point at location (given by the batched searches)
+                     * 
+                     * @param location valid location of a point of this tree, which has not been modified since
+                     * @return Point<Leaf,T,Dims> 
+                     */
+                    [[nodiscard]] Point<Leaf,T,Dims> GetPoint(PointLocation location) const {return m_nodes[location.nodeIndex].GetBucket().GetPoint(location.position);}
+                    /**
+                     * @brief Returns the object of the point at location (given by the batched searches), without copying it
+                     * 
+                     * @param location valid location of a point of this tree, which has not been modified since
+                     * @return const Leaf& 
+                     */
+                    [[nodiscard]] const Leaf& GetObject(PointLocation location) const noexcept {return m_nodes[location.nodeIndex].GetBucket().GetObject(location.position);}
+                    /**
+                     * @brief Returns the coordinates of the point at location (given by the batched searches)
+                     * 
+                     * @param location valid location of a point of this tree, which has not been modified since
+                     * @return std::array<T,Dims> 
+                     */
+                    [[nodiscard]] std::array<T,Dims> GetCoordinates(PointLocation location) const noexcept {return m_nodes[location.nodeIndex].GetBucket().GetCoordinates(location.position);}
                     /**
                      * @brief Print the structure of the whole tree. If a given node is a leaf node. then the value shown represents the size of the data vector. If a give node is not a leaf node, then the median value is shown.
                      * 
                      */
                     void Print() const 
                     {
-                        Print("",m_rootNode,false);
+                        if (m_isSplit)
+                            Print("",m_nodes.GetRootIndex(),false);
                     }
                     /**
-                     * @brief Returns number of stored points within the K-D Tree.
+                     * @brief Returns number of stored points within the K-D Tree. Every node keeps the number of points in its subtree up to date, so this takes O(1).
                      * 
                      * @return std::size_t 
                      */
                     [[nodiscard]] inline std::size_t size() const noexcept 
                     {
-                        if (m_rootNode == nullptr)
+                        return (m_isSplit) ? m_nodes[m_nodes.GetRootIndex()].GetSubtreeSize() : m_storedData.size();
+                    }
+                    /**
+                     * @brief Count the points whose coordinate along dim is smaller than value (the rank of value along dim). Subtrees lying entirely below value are counted from their cached sizes without visiting them.
+                     * 
+                     * @param dim dimension along which the points are compared
+                     * @param value coordinate to compare with
+                     * @return std::size_t 
+                     * @throws std::runtime_error if dim is not smaller than Dims
+                     */
+                    [[nodiscard]] std::size_t CountBelow(std::size_t dim, T value) const
+                    {
+                        if (m_isSplit)
                         {
-                            return m_storedData.size();
+                            return m_counter.CountBelow(m_nodes,m_nodes.GetRootIndex(),dim,value);
+                        }
+                        else if (dim < Dims)
+                        {
+                            return static_cast<std::size_t>(std::count_if(m_storedData.begin(),m_storedData.end(),[dim,value](const Point<Leaf,T,Dims> &point){return point.coords[dim] < value;}));
                         }
                         else
                         {
-                            std::function<std::size_t(const std::shared_ptr<Node<Leaf,T,Dims,Distance> > &)> sumElems;
-                            sumElems = [&sumElems](const std::shared_ptr<Node<Leaf,T,Dims,Distance> > &node)
-                            {
-                                if (node->IsSplit())
-                                {
-                                    return sumElems(node->GetLeftNode()) + sumElems(node->GetRightNode());
-                                }
-                                else
-                                {
-                                    return node->size();
-                                }
-                            };
-
-                            return sumElems(m_rootNode);
+                            throw std::runtime_error("KDTree::CountBelow - dimension is out of range");
                         }
                     }
+                    /**
+                     * @brief Returns the depth histogram and the bucket fill histogram of the leaves (empty if the tree is not split)
+                     * 
+                     * @return TreeShape 
+                     */
+                    [[nodiscard]] TreeShape GetTreeShape() const
+                    {
+                        return (m_isSplit) ? ::JJDataStruct::KDTree::GetTreeShape(m_nodes,m_nodes.GetRootIndex()) : TreeShape();
+                    }
+                    /**
+                     * @brief Returns the counters of the last query run on the calling thread by any tree (they stay at zero unless KDTREE_ENABLE_STATS is defined)
+                     * 
+                     * @return const QueryStats& 
+                     */
+                    [[nodiscard]] static const QueryStats& GetLastQueryStats() noexcept {return QueryStats::Current();}
+                    /**
+                     * @brief Returns the statistics of all the queries of this tree since the last ResetQueryStats call (empty unless KDTREE_ENABLE_STATS is defined)
+                     * 
+                     * @return QueryStatsSummary 
+                     */
+                    [[nodiscard]] QueryStatsSummary GetQueryStats() const noexcept {return m_queryStats.Get();}
+                    /**
+                     * @brief Clear the statistics of the queries of this tree
+                     * 
+                     */
+                    void ResetQueryStats() noexcept {m_queryStats.Reset();}
                     /**
                      * @brief Returns the max amout of points each leaf node can store
                      * 
@@ -277,6 +767,77 @@
                      * @return constexpr std::size_t 
                      */
                     [[nodiscard]] inline constexpr std::size_t GetMaxSizeBeforeSplit() const noexcept {return m_maxSizeBeforeSplit;}
+                    /**
+                     * @brief Set the number of threads used whenever the tree is built (by SplitTree, BuildTree or automatically once maxSize is exceeded). The tree built in parallel is identical to the one built by a single thread.
+                     * 
+                     * @param nThreads number of threads; 1 (default) builds the tree serially
+                     */
+                    inline void SetBuildThreads(unsigned nThreads) noexcept {m_buildThreads = std::max(nThreads,1u);}
+                    /**
+                     * @brief Let the split tree rebalance itself as points are added and removed: whenever one child of a node ends up holding more than balanceFactor of the points below the node, the highest such node is rebuilt into a balanced subtree (like in a scapegoat tree).
+                     * The cost of the rebuilds is spread over the insertions and removals, so a long-running tree whose input distribution drifts never needs a full rebuild with BuildTree. Lower values keep the tree more balanced at the cost of more frequent rebuilds. The handles stay valid.
+                     * 
+                     * @param balanceFactor the largest fraction of the points of a subtree that one of its children may hold, clamped to [0.5,1]; 1 (default) disables the rebalancing
+                     */
+                    inline void SetBalanceFactor(double balanceFactor) noexcept {m_nodes.SetBalanceFactor(balanceFactor);}
+                    /**
+                     * @brief Returns the balance factor (see SetBalanceFactor)
+                     * 
+                     * @return double 
+                     */
+                    [[nodiscard]] inline double GetBalanceFactor() const noexcept {return m_nodes.GetBalanceFactor();}
+                    /**
+                     * @brief Turn the tree into a sliding window over the most recently added points: once more than windowSize points have been added by AddPoint, adding a point removes the oldest one (first in, first out). 
+                     * The points stored before the window is enabled (or added by BuildTree) are not part of the window and stay in the tree. Shrinking the window removes the oldest points right away. 
+                     * The window keeps the handles of its points (see AddPointWithHandle), so a point leaves the tree in O(1) and equal Leaf-type objects are never mistaken for each other; a point removed by hand before its turn is skipped. 
+                     * While the window is enabled the tree is split at the first added point, and rebuilding the tree (BuildTree) leaves the points of the window in the tree for good.
+                     * 
+                     * @param windowSize maximal number of points in the window; 0 (default) disables the window
+                     */
+                    void SetWindowSize(std::size_t windowSize)
+                    {
+                        JJUtils::fixed_size_deque<PointHandle> window(windowSize);
+                        if (windowSize > 0)
+                        {
+                            for (const PointHandle handle : m_window)
+                            {
+                                auto evicted = window.push_back(handle);
+                                if (evicted.has_value())
+                                    m_nodes.Remove(evicted.value());
+                            }
+                        }
+                        m_window = std::move(window);
+                    }
+                    /**
+                     * @brief Returns the size of the sliding window (0 if it is disabled)
+                     * 
+                     * @return std::size_t 
+                     */
+                    [[nodiscard]] inline std::size_t GetWindowSize() const noexcept {return m_window.max_size();}
+                    /**
+                     * @brief Returns the number of threads used to build the tree
+                     * 
+                     * @return unsigned 
+                     */
+                    [[nodiscard]] inline unsigned GetBuildThreads() const noexcept {return m_buildThreads;}
+                    /**
+                     * @brief Returns the nodes of the tree (empty until the tree is split)
+                     * 
+                     * @return const NodeArray<Leaf,T,Dims,Distance,BucketCapacity,SplitPolicy>& 
+                     */
+                    [[nodiscard]] inline const NodeArray<Leaf,T,Dims,Distance,BucketCapacity,SplitPolicy>& GetNodes() const noexcept {return m_nodes;}
+                    /**
+                     * @brief Returns the memory resource from which the nodes and the buckets are allocated
+                     * 
+                     * @return std::pmr::memory_resource* 
+                     */
+                    [[nodiscard]] inline std::pmr::memory_resource* GetMemoryResource() const noexcept {return m_nodes.GetMemoryResource();}
+                    /**
+                     * @brief Returns the points collected before the tree is split (empty once it is split)
+                     * 
+                     * @return const std::vector<Point<Leaf,T,Dims> >& 
+                     */
+                    [[nodiscard]] inline const std::vector<Point<Leaf,T,Dims> >& GetStoredData() const noexcept {return m_storedData;}
                     /**
                      * @brief Check if the KDTree is split
                      * 
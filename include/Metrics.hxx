@@ -1,32 +1,74 @@
 #ifndef Metrics_hxx
     #define Metrics_hxx
 
+    #include <algorithm>
     #include <cmath>
+    #include <type_traits>
+    #include <utility>
 
     #include "Point.hxx"
+    #include "DistanceKernels.hxx"
 
     namespace JJDataStruct
     {  
        namespace KDTree
        {
             /**
-             * @brief Structure representic a distance metric. Here is a squared euclidean distance
+             * @brief Structure representic a distance metric. Here is a squared euclidean distance. 
+             * A metric works on coordinates only: distance(coords1,coords2) gives the distance between two points and axisDistance(x1,x2) gives the smallest possible distance between two points whose coordinates along one axis are x1 and x2 (used to decide if the other side of a splitting plane has to be searched).
              * 
              */
             struct SquaredDist
             {
-                template <typename Leaf, typename T , std::size_t Dims>
-                static T distance(Point<Leaf,T,Dims> p1, Point<Leaf,T,Dims> p2)
+                template <typename T , std::size_t Dims>
+                static T distance(const std::array<T,Dims> &p1, const std::array<T,Dims> &p2) noexcept
                 {
                     auto pow2 = [](T t){return t * t;};
                     T dist = 0;
                     for (std::size_t dim = 0; dim < Dims; ++dim)
                     {
-                        dist += pow2(p1.coords[dim] - p2.coords[dim]);
+                        dist += pow2(p1[dim] - p2[dim]);
                     }
 
                     return dist;
                 }
+                template <typename Leaf, typename T , std::size_t Dims>
+                static T distance(const Point<Leaf,T,Dims> &p1, const Point<Leaf,T,Dims> &p2) noexcept
+                {
+                    return distance(p1.coords,p2.coords);
+                }
+                template <typename T>
+                static T axisDistance(T x1, T x2) noexcept
+                {
+                    return (x1 - x2) * (x1 - x2);
+                }
+                /**
+                 * @brief Update the distance from a point to a box when the axis distance along one of the axes changes from oldAxisDistance to newAxisDistance. The squared distance is a sum over the axes, so it is just the difference.
+                 * 
+                 */
+                template <typename T>
+                static T regionDistance(T regionDist, T oldAxisDistance, T newAxisDistance) noexcept
+                {
+                    return regionDist - oldAxisDistance + newAxisDistance;
+                }
+                /**
+                 * @brief Distance between two points after the vector between them has been stretched by factor. The squared distance grows with the square of the factor.
+                 * 
+                 */
+                template <typename T>
+                static T scale(T dist, double factor) noexcept
+                {
+                    return static_cast<T>(static_cast<double>(dist) * factor * factor);
+                }
+                /**
+                 * @brief Calculate the distances of many points to the query point at once (see Kernels::SquaredDistances)
+                 * 
+                 */
+                template <typename T, std::size_t Dims>
+                static void distances(const std::array<const T*,Dims> &columns, std::size_t stride, std::size_t count, const std::array<T,Dims> &query, T *out) noexcept
+                {
+                    Kernels::SquaredDistances<T,Dims>(columns,stride,count,query,out);
+                }
             };
 
             /**
@@ -35,19 +77,175 @@
              */
             struct RootSquaredDist
             {
+                template <typename T , std::size_t Dims>
+                static T distance(const std::array<T,Dims> &p1, const std::array<T,Dims> &p2) noexcept
+                {
+                    return std::sqrt(SquaredDist::distance(p1,p2));
+                }
                 template <typename Leaf, typename T , std::size_t Dims>
-                static T distance(Point<Leaf,T,Dims> p1, Point<Leaf,T,Dims> p2)
+                static T distance(const Point<Leaf,T,Dims> &p1, const Point<Leaf,T,Dims> &p2) noexcept
                 {
-                    auto pow2 = [](T t){return t * t;};
-                    T dist = 0;
-                    for (std::size_t dim = 0; dim < Dims; ++dim)
+                    return distance(p1.coords,p2.coords);
+                }
+                template <typename T>
+                static T axisDistance(T x1, T x2) noexcept
+                {
+                    return (x1 > x2) ? x1 - x2 : x2 - x1;
+                }
+                /**
+                 * @brief Update the distance from a point to a box when the axis distance along one of the axes changes from oldAxisDistance to newAxisDistance
+                 * 
+                 */
+                template <typename T>
+                static T regionDistance(T regionDist, T oldAxisDistance, T newAxisDistance) noexcept
+                {
+                    const T squared = regionDist * regionDist - oldAxisDistance * oldAxisDistance + newAxisDistance * newAxisDistance;
+                    return (squared > T(0)) ? static_cast<T>(std::sqrt(squared)) : T(0);
+                }
+                /**
+                 * @brief Distance between two points after the vector between them has been stretched by factor
+                 * 
+                 */
+                template <typename T>
+                static T scale(T dist, double factor) noexcept
+                {
+                    return static_cast<T>(static_cast<double>(dist) * factor);
+                }
+                /**
+                 * @brief Calculate the distances of many points to the query point at once (see Kernels::SquaredDistances)
+                 * 
+                 */
+                template <typename T, std::size_t Dims>
+                static void distances(const std::array<const T*,Dims> &columns, std::size_t stride, std::size_t count, const std::array<T,Dims> &query, T *out) noexcept
+                {
+                    Kernels::SquaredDistances<T,Dims>(columns,stride,count,query,out);
+                    for (std::size_t i = 0; i < count; ++i)
+                        out[i] = std::sqrt(out[i]);
+                }
+            };
+
+            /**
+             * @brief Check if the metric can calculate the distances of many points at once, i.e. if it has a static method distances(columns,stride,count,query,out) like SquaredDist
+             * 
+             * @tparam Distance Metric upon which the distance will be calculated
+             * @tparam T Arithmetic type of point coordinates
+             * @tparam Dims Number of dimensions
+             */
+            template <typename Distance, typename T, std::size_t Dims, typename = void>
+            struct HasBatchDistance : std::false_type {};
+
+            template <typename Distance, typename T, std::size_t Dims>
+            struct HasBatchDistance<Distance,T,Dims,std::void_t<decltype(Distance::template distances<T,Dims>(std::declval<const std::array<const T*,Dims>&>(),std::size_t(),std::size_t(),std::declval<const std::array<T,Dims>&>(),std::declval<T*>()))> > : std::true_type {};
+
+            /**
+             * @brief Call func(position,distance) for every point at positions [first,last) of coordinates stored column by column (the d-th coordinate of the i-th point is at columns[d][i]), in order. 
+             * If the metric can calculate many distances at once (see HasBatchDistance), the range is processed in blocks with the vectorised kernels.
+             * 
+             * @tparam Distance Metric upon which the distance will be calculated
+             * @tparam T Arithmetic type of point coordinates
+             * @tparam Dims Number of dimensions
+             * @tparam Func function of signature (std::size_t,T) -> void
+             * @param columns pointers to the coordinate arrays, one for each dimension
+             * @param first position of the first point
+             * @param last position after the last point
+             * @param query coordinates of the point to which the distances are calculated
+             * @param func function called for every point in the range
+             */
+            template <typename Distance, typename T, std::size_t Dims, typename Func>
+            void ForEachDistance(const std::array<const T*,Dims> &columns, std::size_t first, std::size_t last, const std::array<T,Dims> &query, Func &func)
+            {
+                if constexpr (HasBatchDistance<Distance,T,Dims>::value)
+                {
+                    constexpr std::size_t blockSize = 64;
+
+                    std::array<T,blockSize> distances;
+                    std::array<const T*,Dims> blockColumns;
+                    for (std::size_t block = first; block < last; block += blockSize)
                     {
-                        dist += pow2(p1.coords[dim] - p2.coords[dim]);
+                        const std::size_t count = std::min(blockSize,last - block);
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            blockColumns[dim] = columns[dim] + block;
+
+                        Distance::template distances<T,Dims>(blockColumns,1,count,query,distances.data());
+                        for (std::size_t i = 0; i < count; ++i)
+                            func(block + i,distances[i]);
                     }
+                }
+                else
+                {
+                    std::array<T,Dims> coords;
+                    for (std::size_t i = first; i < last; ++i)
+                    {
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                            coords[dim] = columns[dim][i];
 
-                    return std::sqrt(dist);
+                        func(i,Distance::distance(query,coords));
+                    }
                 }
-            };
+            }
+
+            /**
+             * @brief Check if the metric can update the distance from a point to a box axis by axis, i.e. if it has a static method regionDistance(regionDist,oldAxisDistance,newAxisDistance) like SquaredDist
+             * 
+             * @tparam Distance Metric upon which the distance will be calculated
+             * @tparam T Arithmetic type of point coordinates
+             */
+            template <typename Distance, typename T, typename = void>
+            struct HasRegionDistance : std::false_type {};
+
+            template <typename Distance, typename T>
+            struct HasRegionDistance<Distance,T,std::void_t<decltype(Distance::template regionDistance<T>(T(),T(),T()))> > : std::true_type {};
+
+            /**
+             * @brief Lower bound of the distance from a point to a box, after the axis distance along one of the axes has changed from oldAxisDistance to newAxisDistance (the box has shrunk along that axis). 
+             * Metrics without regionDistance get the larger of the two bounds that are always valid: the old one (the box has only shrunk) and the new axis distance.
+             * 
+             * @tparam Distance Metric upon which the distance will be calculated
+             * @tparam T Arithmetic type of point coordinates
+             * @param regionDist lower bound of the distance to the box before the change
+             * @param oldAxisDistance axis distance before the change
+             * @param newAxisDistance axis distance after the change
+             * @return T 
+             */
+            template <typename Distance, typename T>
+            T RegionDistance(T regionDist, T oldAxisDistance, T newAxisDistance) noexcept
+            {
+                if constexpr (HasRegionDistance<Distance,T>::value)
+                    return Distance::template regionDistance<T>(regionDist,oldAxisDistance,newAxisDistance);
+                else
+                    return std::max(regionDist,newAxisDistance);
+            }
+
+            /**
+             * @brief Check if the metric can tell how a distance grows when the points move apart, i.e. if it has a static method scale(dist,factor) like SquaredDist
+             * 
+             * @tparam Distance Metric upon which the distance will be calculated
+             * @tparam T Arithmetic type of point coordinates
+             */
+            template <typename Distance, typename T, typename = void>
+            struct HasScale : std::false_type {};
+
+            template <typename Distance, typename T>
+            struct HasScale<Distance,T,std::void_t<decltype(Distance::template scale<T>(T(),double()))> > : std::true_type {};
+
+            /**
+             * @brief Distance between two points after the vector between them has been stretched by factor (used to widen the pruning of the approximate searches). 
+             * Metrics without scale are taken to be norms, which grow linearly with the factor.
+             * 
+             * @tparam Distance Metric upon which the distance will be calculated
+             * @tparam T Arithmetic type of point coordinates
+             * @param dist distance between the points
+             * @param factor stretch of the vector between the points
+             * @return T 
+             */
+            template <typename Distance, typename T>
+            T ScaleDistance(T dist, double factor) noexcept
+            {
+                if constexpr (HasScale<Distance,T>::value)
+                    return Distance::template scale<T>(dist,factor);
+                else
+                    return static_cast<T>(static_cast<double>(dist) * factor);
+            }
 
        } // namespace KDTree
         
@@ -1,231 +1,240 @@
 #ifndef Node_hxx
     #define Node_hxx
 
-    #include <memory>
+    #include <array>
+    #include <cstdint>
+    #include <limits>
     #include <algorithm>
     #include <optional>
     #include <utility>
+    #include <vector>
 
     #include "Metrics.hxx"
+    #include "Bucket.hxx"
     #include "JJUtils.hxx"
 
     namespace JJDataStruct
     {
         namespace KDTree
         {
+            template <typename Leaf, typename T , std::size_t Dims, typename Distance, std::size_t BucketCapacity, typename SplitPolicy>
+            class NodeArray;
+
             /**
-             * @brief Strucrure repsenting a node of a tree. It holds points (if it is at the bottom of the tree) or points to its two child nodes (if it is not at the bottom of the tree)
-             * 
-             * @tparam Leaf Object type that will be stored in leafs 
+             * @brief Strucrure repsenting a node of a tree. It holds points (if it is at the bottom of the tree) or the indices of its two child nodes (if it is not at the bottom of the tree).
+             * Nodes do not own each other, they are all stored in a single NodeArray and refer to each other by a 32-bit index.
+             *
+             * @tparam Leaf Object type that will be stored in leafs
              * @tparam T Arithmetic type of point coordinates
-             * @tparam Dims Number of dimensions over which the data will be divided 
-             * @tparam Distance Metric upon which the distance will be calculated 
+             * @tparam Dims Number of dimensions over which the data will be divided
+             * @tparam Distance Metric upon which the distance will be calculated
+             * @tparam BucketCapacity capacity of the points stored inside the node (see FixedBucket) or 0 for a growing bucket (see Bucket)
              */
-            template <typename Leaf, typename T , std::size_t Dims, typename Distance>
+            template <typename Leaf, typename T , std::size_t Dims, typename Distance, std::size_t BucketCapacity = 0>
             class Node
-            {                    
+            {
+                template <typename, typename, std::size_t, typename, std::size_t, typename> friend class NodeArray; // an array of any split policy
+
                 private:
-                    bool m_isSplit;
                     T m_median;
-                    std::size_t m_depth, m_dimensionIndex, m_bucketSize;
-                    std::vector<Point<Leaf,T,Dims> > m_storedData;
-                    std::shared_ptr<Node<Leaf,T,Dims,Distance> > m_leftNode, m_rightNode;
-                    Node<Leaf,T,Dims,Distance> *m_parentNode; // non-owning pointer
-
-                    void Split()
-                    {
-                        m_isSplit = true;
+                    std::uint32_t m_leftIndex, m_rightIndex, m_parentIndex, m_depth;
+                    std::uint32_t m_dimensionIndex;
+                    SelectBucket<Leaf,T,Dims,BucketCapacity> m_storedData;
+                    std::size_t m_subtreeSize; // number of points stored in the subtree of this node (kept up to date by NodeArray)
 
-                        // sort the passed data
-                        std::sort(m_storedData.begin(),m_storedData.end(),
-                            [&](const Point<Leaf,T,Dims> &p1, const Point<Leaf,T,Dims> &p2)
-                            {
-                                return p1.coords[m_dimensionIndex] < p2.coords[m_dimensionIndex];
-                            });
-
-                        // calculate median for our data at given Dim
-                        auto [leftData,rightData] = JJUtils::split<Point<Leaf,T,Dims> >(std::move(m_storedData));
-                        m_storedData.resize(0);
-
-                        if (leftData.size() == rightData.size()) // if the median is between the points
-                        {
-                            m_median = (leftData.back().coords.at(m_dimensionIndex) + rightData.front().coords.at(m_dimensionIndex)) / 2;
-                        }
-                        else // if the median is at point
-                        {
-                            m_median = rightData.front().coords.at(m_dimensionIndex);
-                        }
+                public:
+                    /**
+                     * @brief Allocator of the bucket. A container of nodes with a std::pmr allocator (like NodeArray) passes it on to every node it constructs.
+                     *
+                     */
+                    using allocator_type = typename SelectBucket<Leaf,T,Dims,BucketCapacity>::allocator_type;
 
-                        m_leftNode = std::make_shared<Node<Leaf,T,Dims,Distance> >(std::move(leftData), this, m_depth + 1, m_bucketSize);
-                        m_rightNode = std::make_shared<Node<Leaf,T,Dims,Distance> >(std::move(rightData), this, m_depth + 1, m_bucketSize);
+                    /**
+                     * @brief Construct a new leaf Node object
+                     *
+                     * @param data points stored in this node
+                     * @param parentIndex index of the parent node (or InvalidIndex for the root node)
+                     * @param depth depth of the node in the tree
+                     * @param alloc allocator of the memory resource from which the bucket is allocated
+                     */
+                    Node(std::vector<Point<Leaf,T,Dims> > &&data, std::uint32_t parentIndex, std::size_t depth, const allocator_type &alloc = {}): m_median(T()), m_leftIndex(InvalidIndex), m_rightIndex(InvalidIndex),
+                        m_parentIndex(parentIndex), m_depth(static_cast<std::uint32_t>(depth)), m_dimensionIndex(static_cast<std::uint32_t>(depth % Dims)), m_storedData(std::move(data),alloc), m_subtreeSize(m_storedData.size())
+                    {
                     }
-                    void Join()
+                    Node(const Node &other) = default;
+                    Node(Node &&other) = default;
+                    Node(const Node &other, const allocator_type &alloc) : m_median(other.m_median), m_leftIndex(other.m_leftIndex), m_rightIndex(other.m_rightIndex),
+                        m_parentIndex(other.m_parentIndex), m_depth(other.m_depth), m_dimensionIndex(other.m_dimensionIndex), m_storedData(other.m_storedData,alloc), m_subtreeSize(other.m_subtreeSize)
                     {
-                        if (!m_leftNode->IsEmpty())
-                        {
-                            auto data = m_leftNode->GetData();
-                            std::move(data.begin(),data.end(),std::back_inserter(m_storedData));
-                        }
-                        if (!m_rightNode->IsEmpty())
-                        {
-                            auto data = m_rightNode->GetData();
-                            std::move(data.begin(),data.end(),std::back_inserter(m_storedData));
-                        }
-
-                        m_leftNode = nullptr;
-                        m_rightNode = nullptr;
-                        m_isSplit = false;
-                        m_median = T();
                     }
-
-                public:
-                    Node(std::vector<Point<Leaf,T,Dims> > &&data, Node<Leaf,T,Dims,Distance> *parentNode, std::size_t depth ,std::size_t bucketSize): m_isSplit(false), m_median(T()), 
-                        m_depth(depth), m_dimensionIndex(depth % Dims), m_bucketSize(bucketSize), m_storedData(std::move(data)),m_leftNode(nullptr), m_rightNode(nullptr), m_parentNode(parentNode)
+                    Node(Node &&other, const allocator_type &alloc) : m_median(other.m_median), m_leftIndex(other.m_leftIndex), m_rightIndex(other.m_rightIndex),
+                        m_parentIndex(other.m_parentIndex), m_depth(other.m_depth), m_dimensionIndex(other.m_dimensionIndex), m_storedData(std::move(other.m_storedData),alloc), m_subtreeSize(other.m_subtreeSize)
                     {
-                        if (m_storedData.size() > m_bucketSize)
-                        {
-                            Split();
-                        }
                     }
-                    [[nodiscard]] std::shared_ptr<Node<Leaf,T,Dims,Distance> > GetChild(const Point<Leaf,T,Dims> &point) const noexcept
+                    Node& operator=(const Node &other) = default;
+                    Node& operator=(Node &&other) = default;
+                    [[nodiscard]] std::uint32_t GetChildIndex(const Point<Leaf,T,Dims> &point) const noexcept
                     {
-                        if (point.coords.at(m_dimensionIndex) > m_median)
+                        if (point.coords[m_dimensionIndex] > m_median)
                         {
-                            return GetRightNode();
+                            return m_rightIndex;
                         }
                         else
                         {
-                            return GetLeftNode();
-                        } 
+                            return m_leftIndex;
+                        }
                     }
-                    [[nodiscard]] std::shared_ptr<Node<Leaf,T,Dims,Distance> > GetOtherChild(const Point<Leaf,T,Dims> &point) const noexcept
+                    [[nodiscard]] std::uint32_t GetOtherChildIndex(const Point<Leaf,T,Dims> &point) const noexcept
                     {
-                        if (point.coords.at(m_dimensionIndex) <= m_median)
+                        if (point.coords[m_dimensionIndex] <= m_median)
                         {
-                            return GetRightNode();
+                            return m_rightIndex;
                         }
                         else
                         {
-                            return GetLeftNode();
-                        } 
+                            return m_leftIndex;
+                        }
                     }
                     [[nodiscard]] T CalculateDistanceToMedian(const Point<Leaf,T,Dims> &point) const noexcept
                     {
-                        Point<Leaf,T,Dims> pointOnHyperplane{{},std::array<T,Dims>{}};
-                        std::fill_n(pointOnHyperplane.coords.begin(),Dims,T(0));
-                        pointOnHyperplane.coords.at(m_dimensionIndex) = m_median;
-                        
-                        return Distance::distance(point,pointOnHyperplane);
-                    }
-                    bool TryJoin()
-                    {
-                        if (!m_leftNode->IsSplit() && !m_rightNode->IsSplit() && (m_leftNode->size() + m_rightNode->size() <= m_bucketSize))
-                        {
-                            Join();
-                            return true;
-                        }
-                        else
-                        {
-                            return false;
-                        }
+                        return Distance::axisDistance(point.coords[m_dimensionIndex],m_median);
                     }
                     bool AddPoint(Point<Leaf,T,Dims> &&point)
                     {
-                        if (m_isSplit)
+                        if (IsSplit())
                         {
                             return false;
                         }
                         else
                         {
-                            m_storedData.push_back(std::move(point));
-                            if (m_storedData.size() > m_bucketSize)
-                            {
-                                Split();
-                            }
+                            m_storedData.PushBack(std::move(point));
+                            ++m_subtreeSize;
                             return true;
                         }
                     }
                     bool AddPoint(const Point<Leaf,T,Dims> &point)
                     {
-                        if (m_isSplit)
+                        if (IsSplit())
                         {
                             return false;
                         }
                         else
                         {
-                            m_storedData.push_back(point);
-                            if (m_storedData.size() > m_bucketSize)
-                            {
-                                Split();
-                            }
+                            m_storedData.PushBack(point);
+                            ++m_subtreeSize;
                             return true;
                         }
                     }
                     std::optional<Point<Leaf,T,Dims>> RemovePoint(const Point<Leaf,T,Dims> &point)
                     {
-                        auto location = std::find(m_storedData.begin(),m_storedData.end(),point);
+                        auto location = m_storedData.Find(point);
 
-                        if (location != m_storedData.end())
+                        if (location.has_value())
                         {
-                            Point<Leaf,T,Dims> removed_point = *location;
-                            m_storedData.erase(std::remove(m_storedData.begin(),m_storedData.end(),point),m_storedData.end());
-                            return removed_point;
+                            --m_subtreeSize;
+                            return m_storedData.Erase(location.value());
                         }
                         else
                         {
                             return std::nullopt;
                         }
                     }
-                    [[nodiscard]] std::optional<Point<Leaf,T,Dims> > FindNearest(const Point<Leaf,T,Dims> &point) noexcept
+                    /**
+                     * @brief Call func(position,distance) for every point stored in this node, in order (the position refers to the bucket, see GetBucket). 
+                     * If the metric can calculate many distances at once (see HasBatchDistance), the bucket is processed in blocks with the vectorised kernels, which read only the coordinate arrays.
+                     * 
+                     * @tparam Func function of signature (std::size_t,T) -> void
+                     * @param point point to which the distances are calculated
+                     * @param func function called for every stored point
+                     */
+                    template <typename Func>
+                    void ForEachDistance(const Point<Leaf,T,Dims> &point, Func func) const
                     {
-                        if (m_storedData.empty())
-                        {
-                            return std::nullopt;
-                        }
-                        else
-                        {
-                            std::sort(m_storedData.begin(),m_storedData.end(),[&point](const Point<Leaf,T,Dims> &lhs, const Point<Leaf,T,Dims> &rhs){return Distance::distance(point,lhs) < Distance::distance(point,rhs);});
-                            return m_storedData.front();
-                        }
+                        m_storedData.template ForEachDistance<Distance>(0,m_storedData.size(),point.coords,func);
                     }
-                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > FindNNearest(const Point<Leaf,T,Dims> &point, unsigned nPoints)
+                    /**
+                     * @brief Call func(position,distance) for the first nPoints points stored in this node, in order (e.g. for a search whose budget of distance evaluations runs out inside this leaf)
+                     * 
+                     */
+                    template <typename Func>
+                    void ForEachDistance(const Point<Leaf,T,Dims> &point, std::size_t nPoints, Func func) const
                     {
-                        if (m_storedData.empty())
-                        {
-                            return {};
-                        }
-                        else
-                        {
-                            std::sort(m_storedData.begin(),m_storedData.end(),[&point](const Point<Leaf,T,Dims> &lhs, const Point<Leaf,T,Dims> &rhs){return Distance::distance(point,lhs) < Distance::distance(point,rhs);});
-                            return std::vector<Point<Leaf,T,Dims> >(m_storedData.begin(),(m_storedData.begin() + nPoints > m_storedData.end()) ? m_storedData.end() : m_storedData.begin() + nPoints);
-                        }
+                        m_storedData.template ForEachDistance<Distance>(0,std::min(nPoints,m_storedData.size()),point.coords,func);
                     }
-                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > FindWithinDistance(const Point<Leaf,T,Dims> &point, T dist)
+                    [[nodiscard]] std::optional<Point<Leaf,T,Dims> > FindNearest(const Point<Leaf,T,Dims> &point) const
                     {
-                        if (m_storedData.empty())
+                        std::optional<std::size_t> closestPoint;
+                        T closestDistance = T();
+                        ForEachDistance(point,[&closestPoint,&closestDistance](std::size_t i, T dist)
                         {
-                            return {};
-                        }
-                        else
+                            if (!closestPoint.has_value() || dist < closestDistance)
+                            {
+                                closestPoint = i;
+                                closestDistance = dist;
+                            }
+                        });
+
+                        return (closestPoint.has_value()) ? std::optional<Point<Leaf,T,Dims> >{m_storedData.GetPoint(closestPoint.value())} : std::nullopt;
+                    }
+                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > FindNNearest(const Point<Leaf,T,Dims> &point, unsigned nPoints) const
+                    {
+                        std::vector<std::pair<T,std::size_t> > candidates;
+                        candidates.reserve(m_storedData.size());
+                        ForEachDistance(point,[&candidates](std::size_t i, T dist){candidates.emplace_back(dist,i);});
+
+                        const auto nClosest = static_cast<std::ptrdiff_t>(std::min<std::size_t>(nPoints,candidates.size()));
+                        std::partial_sort(candidates.begin(),candidates.begin() + nClosest,candidates.end());
+
+                        std::vector<Point<Leaf,T,Dims> > outVec;
+                        outVec.reserve(static_cast<std::size_t>(nClosest));
+                        for (auto it = candidates.begin(); it != candidates.begin() + nClosest; ++it)
+                            outVec.push_back(m_storedData.GetPoint(it->second));
+                        return outVec;
+                    }
+                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > FindWithinDistance(const Point<Leaf,T,Dims> &point, T dist) const
+                    {
+                        std::vector<Point<Leaf,T,Dims> > outVec;
+                        FindWithinDistance(point,dist,outVec);
+                        return outVec;
+                    }
+                    /**
+                     * @brief Append all points within distance to outVec
+                     * 
+                     */
+                    void FindWithinDistance(const Point<Leaf,T,Dims> &point, T dist, std::vector<Point<Leaf,T,Dims> > &outVec) const
+                    {
+                        ForEachDistance(point,[this,&outVec,&dist](std::size_t i, T ptDist)
                         {
-                            std::vector<Point<Leaf,T,Dims> > outVec;
-                            std::copy_if(m_storedData.begin(),m_storedData.end(),std::back_inserter(outVec),[&point,&dist](const Point<Leaf,T,Dims> &pt){return Distance::distance(point,pt) <= dist;});
-                            return outVec;
-                        }
+                            if (ptDist <= dist)
+                                outVec.push_back(m_storedData.GetPoint(i));
+                        });
                     }
-                    [[nodiscard]] inline std::vector<Point<Leaf,T,Dims> > GetData() const noexcept {return m_storedData;}
+                    /**
+                     * @brief Get copies of all the points stored in this node
+                     * 
+                     * @return std::vector<Point<Leaf,T,Dims> > 
+                     */
+                    [[nodiscard]] inline std::vector<Point<Leaf,T,Dims> > GetData() const {return m_storedData.GetPoints();}
+                    [[nodiscard]] inline const SelectBucket<Leaf,T,Dims,BucketCapacity>& GetBucket() const noexcept {return m_storedData;}
                     [[nodiscard]] inline std::size_t size() const noexcept {return m_storedData.size();}
-                    [[nodiscard]] inline bool IsEmpty() const noexcept {return m_storedData.empty();}
-                    [[nodiscard]] inline bool IsSplit() const noexcept {return m_isSplit;}
+                    [[nodiscard]] inline bool IsEmpty() const noexcept {return m_storedData.IsEmpty();}
+                    [[nodiscard]] inline bool IsSplit() const noexcept {return m_leftIndex != InvalidIndex;}
+                    /**
+                     * @brief Returns the number of points stored in the subtree of this node (in this node alone, if it is a leaf)
+                     *
+                     */
+                    [[nodiscard]] inline std::size_t GetSubtreeSize() const noexcept {return m_subtreeSize;}
                     [[nodiscard]] inline T GetMedian() const noexcept {return m_median;}
-                    [[nodiscard]] inline Node<Leaf,T,Dims,Distance>* GetParentNode() const noexcept {return m_parentNode;}
-                    [[nodiscard]] inline std::shared_ptr<Node<Leaf,T,Dims,Distance> > GetLeftNode() const noexcept {return m_leftNode;}
-                    [[nodiscard]] inline std::shared_ptr<Node<Leaf,T,Dims,Distance> > GetRightNode() const noexcept {return m_rightNode;}
+                    [[nodiscard]] inline std::size_t GetDepth() const noexcept {return m_depth;}
+                    [[nodiscard]] inline std::size_t GetDimensionIndex() const noexcept {return m_dimensionIndex;}
+                    [[nodiscard]] inline std::uint32_t GetParentIndex() const noexcept {return m_parentIndex;}
+                    [[nodiscard]] inline std::uint32_t GetLeftIndex() const noexcept {return m_leftIndex;}
+                    [[nodiscard]] inline std::uint32_t GetRightIndex() const noexcept {return m_rightIndex;}
             };
 
         } // namespace KDTree
-        
+
     } // namespace JJDataStruct
-    
 
-#endif
\ No newline at end of file
+
+#endif
@@ -0,0 +1,674 @@
+#ifndef NodeArray_hxx
+    #define NodeArray_hxx
+
+    #include <stdexcept>
+    #include <future>
+    #include <memory_resource>
+
+    #include "Node.hxx"
+    #include "SplitPolicies.hxx"
+
+    namespace JJDataStruct
+    {
+        namespace KDTree
+        {
+            /**
+             * @brief Stable reference to a point stored in a tree, valid until the point is removed (or the tree is rebuilt). A handle of a removed point is recognised as invalid by its generation, even if its slot was reused since.
+             *
+             */
+            struct PointHandle
+            {
+                std::uint32_t index = InvalidIndex;
+                std::uint32_t generation = 0;
+                [[nodiscard]] bool operator==(const PointHandle &other) const noexcept {return index == other.index && generation == other.generation;}
+                [[nodiscard]] bool operator!=(const PointHandle &other) const noexcept {return !(*this == other);}
+            };
+
+            /**
+             * @brief Position of a point stored in a tree: the index of its leaf and its position in the bucket of the leaf. Unlike a PointHandle every stored point has one, but it is valid only until the tree is modified.
+             *
+             */
+            struct PointLocation
+            {
+                std::uint32_t nodeIndex = InvalidIndex; // InvalidIndex if there is no point
+                std::uint32_t position = 0;
+                [[nodiscard]] bool IsValid() const noexcept {return nodeIndex != InvalidIndex;}
+                [[nodiscard]] bool operator==(const PointLocation &other) const noexcept {return nodeIndex == other.nodeIndex && position == other.position;}
+                [[nodiscard]] bool operator!=(const PointLocation &other) const noexcept {return !(*this == other);}
+            };
+
+            /**
+             * @brief Contiguous storage of all the nodes of a tree. The root node always sits at index 0 and each split node refers to its children by their 32-bit index, so the traversal never has to chase heap pointers.
+             * Nodes released by a join are kept on a free list and reused by the next split.
+             * Every node counts the points of its subtree. With a balance factor below 1 (see SetBalanceFactor) a subtree whose larger child holds more than that fraction of its points is rebuilt after an insertion or removal (like a scapegoat tree), so the tree stays balanced as the distribution of the points drifts.
+             * Points may be given a handle (see PointHandle), which keeps track of the node and position of the point as it moves between nodes, so the point can be removed in O(1) without searching for it.
+             * The nodes and the buckets of the leaves are all allocated from a single std::pmr::memory_resource, e.g. a std::pmr::unsynchronized_pool_resource to recycle the buckets freed by splits and joins, or a std::pmr::monotonic_buffer_resource to drop the whole tree at once.
+             *
+             * @tparam Leaf Object type that will be stored in leafs
+             * @tparam T Arithmetic type of point coordinates
+             * @tparam Dims Number of dimensions over which the data will be divided
+             * @tparam Distance Metric upon which the distance will be calculated
+             * @tparam BucketCapacity capacity of the points stored inside each node (see FixedBucket) or 0 for growing buckets (see Bucket)
+             * @tparam SplitPolicy how the points of a node are split between its children (see CyclicMedianSplit)
+             */
+            template <typename Leaf, typename T , std::size_t Dims, typename Distance, std::size_t BucketCapacity = 0, typename SplitPolicy = CyclicMedianSplit>
+            class NodeArray
+            {
+                public:
+                    using NodeType = Node<Leaf,T,Dims,Distance,BucketCapacity>;
+                    using BucketType = SelectBucket<Leaf,T,Dims,BucketCapacity>;
+
+                private:
+                    using Iterator = typename std::vector<Point<Leaf,T,Dims> >::iterator;
+                    using TrackedPoint = std::pair<Point<Leaf,T,Dims>,std::uint32_t>; // point and the index of its handle
+
+                    /**
+                     * @brief Location of the point held by a handle. Free slots have nodeIndex == InvalidIndex and are reused with the next generation.
+                     *
+                     */
+                    struct HandleSlot
+                    {
+                        std::uint32_t nodeIndex;
+                        std::uint32_t position;
+                        std::uint32_t generation;
+                    };
+
+                    /**
+                     * @brief Subtrees with fewer points than this are always built by the thread which reached them
+                     *
+                     */
+                    static constexpr std::size_t ParallelBuildThreshold = 1 << 14;
+
+                    std::size_t m_bucketSize;
+                    double m_balanceFactor; // 1 disables the rebalancing
+                    std::pmr::vector<NodeType> m_nodes;
+                    std::pmr::vector<std::uint32_t> m_freeIndices;
+                    std::vector<TrackedPoint> m_splitBuffer; // reused by every split, so splitting a bucket does not allocate temporary vectors
+                    std::vector<HandleSlot> m_handleSlots;
+                    std::vector<std::uint32_t> m_freeHandles;
+                    std::array<std::pair<T,T>,Dims> m_bounds; // smallest and largest coordinate of the points added since the last build (removals do not shrink it)
+
+                    [[nodiscard]] static inline const Point<Leaf,T,Dims>& AsPoint(const Point<Leaf,T,Dims> &point) noexcept {return point;}
+                    [[nodiscard]] static inline const Point<Leaf,T,Dims>& AsPoint(const TrackedPoint &point) noexcept {return point.first;}
+                    static inline void MoveInto(BucketType &bucket, Point<Leaf,T,Dims> &point) {bucket.PushBack(std::move(point));}
+                    static inline void MoveInto(BucketType &bucket, TrackedPoint &point) {bucket.PushBack(std::move(point.first),point.second);}
+                    /**
+                     * @brief Point the handles of the points stored in the leaf at index to their current positions
+                     *
+                     */
+                    void UpdateHandles(std::uint32_t index, std::size_t firstPosition = 0) noexcept
+                    {
+                        const BucketType &bucket = m_nodes[index].m_storedData;
+                        for (std::size_t i = firstPosition; i < bucket.size(); ++i)
+                        {
+                            const std::uint32_t handleIndex = bucket.GetHandleIndex(i);
+                            if (handleIndex != InvalidIndex)
+                            {
+                                m_handleSlots[handleIndex].nodeIndex = index;
+                                m_handleSlots[handleIndex].position = static_cast<std::uint32_t>(i);
+                            }
+                        }
+                    }
+                    void FreeHandle(std::uint32_t handleIndex)
+                    {
+                        if (handleIndex != InvalidIndex)
+                        {
+                            m_handleSlots[handleIndex].nodeIndex = InvalidIndex;
+                            ++m_handleSlots[handleIndex].generation;
+                            m_freeHandles.push_back(handleIndex);
+                        }
+                    }
+                    /**
+                     * @brief Invalidate all the handles (the points lose track of them when the tree is rebuilt)
+                     *
+                     */
+                    void FreeAllHandles()
+                    {
+                        for (std::size_t handleIndex = 0; handleIndex < m_handleSlots.size(); ++handleIndex)
+                            if (m_handleSlots[handleIndex].nodeIndex != InvalidIndex)
+                                FreeHandle(static_cast<std::uint32_t>(handleIndex));
+                    }
+                    /**
+                     * @brief Remove the point at position of the leaf at index in O(1), moving the last point of the leaf into its place
+                     *
+                     */
+                    Point<Leaf,T,Dims> RemoveAt(std::uint32_t index, std::size_t position)
+                    {
+                        BucketType &bucket = m_nodes[index].m_storedData;
+                        FreeHandle(bucket.GetHandleIndex(position));
+                        Point<Leaf,T,Dims> removed = bucket.SwapErase(position);
+                        UpdateHandles(index,position); // only the moved point, if any, is left from position on
+                        for (; index != InvalidIndex; index = m_nodes[index].m_parentIndex)
+                            --m_nodes[index].m_subtreeSize;
+
+                        return removed;
+                    }
+                    void ResetBounds() noexcept
+                    {
+                        m_bounds.fill({std::numeric_limits<T>::max(),std::numeric_limits<T>::lowest()});
+                    }
+                    void ExtendBounds(const Point<Leaf,T,Dims> &point) noexcept
+                    {
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                        {
+                            m_bounds[dim].first = std::min(m_bounds[dim].first,point.coords[dim]);
+                            m_bounds[dim].second = std::max(m_bounds[dim].second,point.coords[dim]);
+                        }
+                    }
+                    [[nodiscard]] bool IsBalanced(const NodeType &node) const noexcept
+                    {
+                        if (!node.IsSplit())
+                            return true;
+
+                        const std::size_t larger = std::max(m_nodes[node.m_leftIndex].m_subtreeSize,m_nodes[node.m_rightIndex].m_subtreeSize);
+                        return static_cast<double>(larger) <= m_balanceFactor * static_cast<double>(node.m_subtreeSize) + 1.; // + 1, as an odd number of points cannot be split evenly
+                    }
+                    /**
+                     * @brief Move the points of the subtree at index (with their handles) to m_splitBuffer, release all the nodes below index and leave it an empty leaf
+                     *
+                     */
+                    void Collect(std::uint32_t index)
+                    {
+                        NodeType &node = m_nodes[index];
+                        if (node.IsSplit())
+                        {
+                            for (std::uint32_t childIndex : {node.m_leftIndex, node.m_rightIndex})
+                            {
+                                Collect(childIndex);
+                                m_freeIndices.push_back(childIndex);
+                            }
+
+                            node.m_leftIndex = InvalidIndex;
+                            node.m_rightIndex = InvalidIndex;
+                            node.m_median = T();
+                        }
+                        else
+                        {
+                            node.m_storedData.MoveTo(m_splitBuffer);
+                        }
+                    }
+                    /**
+                     * @brief Turn the empty leaf at index into a subtree holding the points from [first,last), split by SplitPolicy until no bucket exceeds bucketSize
+                     *
+                     * @tparam It iterator over points or over points with their handle indices
+                     */
+                    template <typename It>
+                    void Rebuild(std::uint32_t index, It first, It last)
+                    {
+                        const auto nPoints = static_cast<std::size_t>(last - first);
+                        m_nodes[index].m_subtreeSize = nPoints;
+                        if (nPoints > m_bucketSize)
+                        {
+                            const SplitPlane<T> plane = ChooseSplit(first,last,m_nodes[index].m_depth);
+                            const It mid = first + static_cast<std::ptrdiff_t>(plane.nLeft);
+                            const std::size_t depth = m_nodes[index].m_depth;
+
+                            // the references are not kept over Allocate, as it may reallocate the underlying vector
+                            const std::uint32_t leftIndex = Allocate(index, depth + 1);
+                            const std::uint32_t rightIndex = Allocate(index, depth + 1);
+                            m_nodes[index].m_median = plane.value;
+                            m_nodes[index].m_dimensionIndex = static_cast<std::uint32_t>(plane.dimension);
+                            m_nodes[index].m_leftIndex = leftIndex;
+                            m_nodes[index].m_rightIndex = rightIndex;
+
+                            Rebuild(leftIndex,first,mid);
+                            Rebuild(rightIndex,mid,last);
+                        }
+                        else
+                        {
+                            BucketType &bucket = m_nodes[index].m_storedData;
+                            bucket.Reserve(nPoints);
+                            for (; first != last; ++first)
+                                MoveInto(bucket,*first);
+
+                            UpdateHandles(index);
+                        }
+                    }
+                    /**
+                     * @brief Make a new empty leaf node (or reuse a released one)
+                     *
+                     */
+                    std::uint32_t Allocate(std::uint32_t parentIndex, std::size_t depth)
+                    {
+                        std::uint32_t index;
+                        if (!m_freeIndices.empty())
+                        {
+                            index = m_freeIndices.back();
+                            m_freeIndices.pop_back();
+                            m_nodes[index] = NodeType({}, parentIndex, depth, m_nodes.get_allocator());
+                        }
+                        else
+                        {
+                            if (m_nodes.size() >= InvalidIndex)
+                                throw std::length_error("NodeArray::Allocate - too many nodes for a 32-bit index");
+
+                            m_nodes.emplace_back(std::vector<Point<Leaf,T,Dims> >{}, parentIndex, depth);
+                            index = static_cast<std::uint32_t>(m_nodes.size() - 1);
+                        }
+
+                        return index;
+                    }
+                    /**
+                     * @brief Make a new leaf node (or reuse a released one) holding the points from [first,last), which are moved in
+                     *
+                     */
+                    std::uint32_t Allocate(typename std::vector<TrackedPoint>::iterator first, typename std::vector<TrackedPoint>::iterator last, std::uint32_t parentIndex, std::size_t depth)
+                    {
+                        const std::uint32_t index = Allocate(parentIndex,depth);
+                        BucketType &bucket = m_nodes[index].m_storedData;
+                        bucket.Reserve(static_cast<std::size_t>(last - first));
+                        for (; first != last; ++first)
+                            MoveInto(bucket,*first);
+
+                        m_nodes[index].m_subtreeSize = bucket.size();
+                        UpdateHandles(index);
+                        return index;
+                    }
+                    /**
+                     * @brief Partition [first,last) in place (selection, not sorting) as SplitPolicy decides for a node at depth
+                     *
+                     */
+                    template <typename It>
+                    static SplitPlane<T> ChooseSplit(It first, It last, std::size_t depth)
+                    {
+                        return SplitPolicy::template Split<T,Dims>(first,last,depth,[](const auto &point, std::size_t dim){return AsPoint(point).coords[dim];});
+                    }
+                    /**
+                     * @brief Number of leaves in a subtree built from nPoints and from nPoints + 1 points. Both halves of a split differ by at most one point, so carrying the pair is enough to get the answer in O(log n).
+                     *
+                     */
+                    std::pair<std::size_t,std::size_t> CountLeaves(std::size_t nPoints) const noexcept
+                    {
+                        if (nPoints + 1 <= m_bucketSize)
+                            return {1,1};
+
+                        auto [half,halfPlusOne] = CountLeaves(nPoints / 2);
+                        if (nPoints % 2 == 0)
+                        {
+                            return {(nPoints <= m_bucketSize) ? 1 : 2 * half, half + halfPlusOne};
+                        }
+                        else
+                        {
+                            return {(nPoints <= m_bucketSize) ? 1 : half + halfPlusOne, 2 * halfPlusOne};
+                        }
+                    }
+                    /**
+                     * @brief Number of nodes in a subtree built from nPoints points
+                     *
+                     */
+                    [[nodiscard]] std::size_t CountNodes(std::size_t nPoints) const noexcept
+                    {
+                        return 2 * CountLeaves(nPoints).first - 1;
+                    }
+                    /**
+                     * @brief Build the subtree of [first,last) with its root at index. The nodes are laid out in pre-order: the left child directly follows its parent and the right child follows the whole left subtree.
+                     * Since the position of every subtree is known beforehand, for the top parallelDepth levels the left subtree is built by a separate task, while the current thread builds the right one.
+                     *
+                     */
+                    void BuildSubtree(std::uint32_t index, Iterator first, Iterator last, std::uint32_t parentIndex, std::size_t depth, std::size_t parallelDepth)
+                    {
+                        NodeType &node = m_nodes[index];
+                        node = NodeType({}, parentIndex, depth, m_nodes.get_allocator());
+
+                        const auto nPoints = static_cast<std::size_t>(last - first);
+                        node.m_subtreeSize = nPoints;
+                        if (nPoints > m_bucketSize)
+                        {
+                            const SplitPlane<T> plane = ChooseSplit(first,last,depth);
+                            Iterator mid = first + static_cast<std::ptrdiff_t>(plane.nLeft);
+                            node.m_median = plane.value;
+                            node.m_dimensionIndex = static_cast<std::uint32_t>(plane.dimension);
+                            node.m_leftIndex = index + 1;
+                            node.m_rightIndex = index + 1 + static_cast<std::uint32_t>(CountNodes(nPoints / 2));
+
+                            if (parallelDepth > 0 && nPoints >= ParallelBuildThreshold)
+                            {
+                                auto leftTask = std::async(std::launch::async,[this,&node,first,mid,index,depth,parallelDepth]()
+                                {
+                                    BuildSubtree(node.m_leftIndex, first, mid, index, depth + 1, parallelDepth - 1);
+                                });
+                                BuildSubtree(node.m_rightIndex, mid, last, index, depth + 1, parallelDepth - 1);
+                                leftTask.get();
+                            }
+                            else
+                            {
+                                BuildSubtree(node.m_leftIndex, first, mid, index, depth + 1, 0);
+                                BuildSubtree(node.m_rightIndex, mid, last, index, depth + 1, 0);
+                            }
+                        }
+                        else
+                        {
+                            node.m_storedData.Assign(std::make_move_iterator(first),std::make_move_iterator(last));
+                        }
+                    }
+                    /**
+                     * @brief Split the full leaf at index into two leaves, sharing its points and the new point between them. The point is never stored in the full bucket first, so it never has to hold more than bucketSize points.
+                     * Every split policy leaves at least one of the bucketSize + 1 points on each side, so both sides fit into a bucket again and a single split is always enough.
+                     *
+                     */
+                    void Split(std::uint32_t index, Point<Leaf,T,Dims> &&point, std::uint32_t handleIndex)
+                    {
+                        // the references are not kept over Allocate, as it may reallocate the underlying vector
+                        m_splitBuffer.clear();
+                        m_nodes[index].m_storedData.MoveTo(m_splitBuffer);
+                        m_splitBuffer.emplace_back(std::move(point),handleIndex);
+                        const std::size_t depth = m_nodes[index].m_depth;
+
+                        const SplitPlane<T> plane = ChooseSplit(m_splitBuffer.begin(),m_splitBuffer.end(),depth);
+                        auto mid = m_splitBuffer.begin() + static_cast<std::ptrdiff_t>(plane.nLeft);
+
+                        const std::uint32_t leftIndex = Allocate(m_splitBuffer.begin(), mid, index, depth + 1);
+                        const std::uint32_t rightIndex = Allocate(mid, m_splitBuffer.end(), index, depth + 1);
+
+                        m_nodes[index].m_median = plane.value;
+                        m_nodes[index].m_dimensionIndex = static_cast<std::uint32_t>(plane.dimension);
+                        m_nodes[index].m_leftIndex = leftIndex;
+                        m_nodes[index].m_rightIndex = rightIndex;
+                    }
+                    void Join(std::uint32_t index)
+                    {
+                        NodeType &node = m_nodes[index];
+                        for (std::uint32_t childIndex : {node.m_leftIndex, node.m_rightIndex})
+                        {
+                            node.m_storedData.Append(std::move(m_nodes[childIndex].m_storedData));
+                            m_freeIndices.push_back(childIndex);
+                        }
+
+                        node.m_leftIndex = InvalidIndex;
+                        node.m_rightIndex = InvalidIndex;
+                        node.m_median = T();
+                        UpdateHandles(index);
+                    }
+                    bool AddPoint(std::uint32_t index, Point<Leaf,T,Dims> &&point, std::uint32_t handleIndex)
+                    {
+                        NodeType &node = m_nodes[index];
+                        if (node.IsSplit())
+                            return false;
+
+                        ExtendBounds(point);
+                        if (node.size() < m_bucketSize)
+                        {
+                            node.m_storedData.PushBack(std::move(point),handleIndex);
+                            UpdateHandles(index,node.size() - 1);
+                        }
+                        else
+                        {
+                            Split(index,std::move(point),handleIndex);
+                        }
+
+                        for (std::uint32_t ancestor = index; ancestor != InvalidIndex; ancestor = m_nodes[ancestor].m_parentIndex)
+                            ++m_nodes[ancestor].m_subtreeSize;
+
+                        Rebalance(index);
+                        return true;
+                    }
+
+                public:
+                    /**
+                     * @brief Construct a new empty NodeArray object (without even a root node)
+                     *
+                     * @param bucketSize the maximal size of each bucket before it splits into two nodes
+                     * @param resource memory resource from which the nodes and their buckets are allocated (it has to outlive the array)
+                     * @throws std::length_error if bucketSize exceeds BucketCapacity
+                     */
+                    explicit NodeArray(std::size_t bucketSize, std::pmr::memory_resource *resource = std::pmr::get_default_resource()) : m_bucketSize(bucketSize), m_balanceFactor(1.), m_nodes(resource), m_freeIndices(resource), m_splitBuffer(), m_handleSlots(), m_freeHandles(), m_bounds()
+                    {
+                        ResetBounds();
+                        if (BucketCapacity != 0 && bucketSize > BucketCapacity)
+                            throw std::length_error("NodeArray::NodeArray - bucket size exceeds the capacity of the buckets");
+                    }
+                    /**
+                     * @brief Construct a new NodeArray object with a root node holding data. The root is split recursively until no bucket exceeds bucketSize.
+                     *
+                     * @param data points to be stored in the tree
+                     * @param bucketSize the maximal size of each bucket before it splits into two nodes
+                     * @param resource memory resource from which the nodes and their buckets are allocated (it has to outlive the array)
+                     */
+                    NodeArray(std::vector<Point<Leaf,T,Dims> > &&data, std::size_t bucketSize, std::pmr::memory_resource *resource = std::pmr::get_default_resource()) : NodeArray(bucketSize,resource)
+                    {
+                        Build(std::move(data));
+                    }
+                    /**
+                     * @brief Drop all the nodes and build a balanced tree from data at once. The points are partitioned in place with a selection algorithm at each level, so the build takes O(n log n) and only the leaves allocate their buckets.
+                     * With nThreads > 1 independent subtrees are built concurrently; the resulting tree is identical to the one built by a single thread. Only a SplitPolicy which splits the points in half lays out the whole tree up front and builds it in parallel, other policies build the tree serially.
+                     *
+                     * @param data points to be stored in the tree
+                     * @param nThreads number of threads used to build the tree
+                     * @param rootDepth depth given to the root node (when the tree becomes a subtree of a bigger one, so that the splitting dimensions continue where the bigger tree stopped)
+                     * @throws std::length_error if the tree would need more nodes than a 32-bit index can address
+                     */
+                    void Build(std::vector<Point<Leaf,T,Dims> > &&data, unsigned nThreads = 1, std::size_t rootDepth = 0)
+                    {
+                        m_nodes.clear();
+                        m_freeIndices.clear();
+                        FreeAllHandles();
+                        ResetBounds();
+                        for (const auto &point : data)
+                            ExtendBounds(point);
+
+                        const std::size_t nNodes = CountNodes(data.size());
+                        if (nNodes >= InvalidIndex)
+                            throw std::length_error("NodeArray::Build - too many nodes for a 32-bit index");
+
+                        std::size_t parallelDepth = 0;
+                        while ((std::size_t(1) << parallelDepth) < nThreads)
+                            ++parallelDepth;
+
+                        if constexpr (SplitPolicy::SplitsInHalf)
+                        {
+                            m_nodes.assign(nNodes, NodeType({}, InvalidIndex, 0));
+                            BuildSubtree(GetRootIndex(), data.begin(), data.end(), InvalidIndex, rootDepth, parallelDepth);
+                        }
+                        else
+                        {
+                            Rebuild(Allocate(InvalidIndex,rootDepth), data.begin(), data.end());
+                        }
+                    }
+                    /**
+                     * @brief Move all the stored points out of the leaves and drop all the nodes
+                     *
+                     * @return std::vector<Point<Leaf,T,Dims> > all the points that were stored in the tree
+                     */
+                    [[nodiscard]] std::vector<Point<Leaf,T,Dims> > Release()
+                    {
+                        std::vector<Point<Leaf,T,Dims> > data;
+                        for (auto &node : m_nodes)
+                        {
+                            node.m_storedData.MoveTo(data);
+                        }
+
+                        m_nodes.clear();
+                        m_freeIndices.clear();
+                        FreeAllHandles();
+                        ResetBounds();
+                        return data;
+                    }
+                    /**
+                     * @brief Add point to the leaf node at index. If the bucket overflows, the node will be split.
+                     *
+                     * @param index index of a leaf node
+                     * @param point point to be added
+                     * @return true if successful, false if the node was already split
+                     */
+                    bool AddPoint(std::uint32_t index, Point<Leaf,T,Dims> &&point)
+                    {
+                        return AddPoint(index,std::move(point),InvalidIndex);
+                    }
+                    /**
+                     * @brief Add point to the leaf node at index. If the bucket overflows, the node will be split.
+                     *
+                     * @param index index of a leaf node
+                     * @param point point to be added
+                     * @return true if successful, false if the node was already split
+                     */
+                    bool AddPoint(std::uint32_t index, const Point<Leaf,T,Dims> &point)
+                    {
+                        return AddPoint(index,Point<Leaf,T,Dims>(point));
+                    }
+                    /**
+                     * @brief Add point to the leaf node at index and give it a handle, through which it can be removed in O(1) (see Remove). If the bucket overflows, the node will be split.
+                     *
+                     * @param index index of a leaf node
+                     * @param point point to be added
+                     * @return handle of the point or std::nullopt if the node was already split
+                     * @throws std::length_error if there are more handles than a 32-bit index can address
+                     */
+                    std::optional<PointHandle> AddPointWithHandle(std::uint32_t index, Point<Leaf,T,Dims> &&point)
+                    {
+                        if (m_nodes[index].IsSplit())
+                            return std::nullopt;
+
+                        std::uint32_t handleIndex;
+                        if (!m_freeHandles.empty())
+                        {
+                            handleIndex = m_freeHandles.back();
+                            m_freeHandles.pop_back();
+                        }
+                        else
+                        {
+                            if (m_handleSlots.size() >= InvalidIndex)
+                                throw std::length_error("NodeArray::AddPointWithHandle - too many handles for a 32-bit index");
+
+                            m_handleSlots.push_back({InvalidIndex,0,0});
+                            handleIndex = static_cast<std::uint32_t>(m_handleSlots.size() - 1);
+                        }
+
+                        AddPoint(index,std::move(point),handleIndex);
+                        return PointHandle{handleIndex,m_handleSlots[handleIndex].generation};
+                    }
+                    /**
+                     * @brief Remove the point held by handle in O(1): the last point of its leaf is moved into its place. If the leaf and its sibling have shrunk to half a bucket together, they are joined (and so on up the tree) (the join waits for half a bucket, not a full one, so that a tree which removes as many points as it adds does not split and join the same leaves over and over).
+                     *
+                     * @param handle handle of the point, given by AddPointWithHandle
+                     * @return the removed point or std::nullopt if the handle is not valid (anymore)
+                     */
+                    std::optional<Point<Leaf,T,Dims> > Remove(PointHandle handle)
+                    {
+                        if (!IsValidHandle(handle))
+                            return std::nullopt;
+
+                        const HandleSlot slot = m_handleSlots[handle.index];
+                        Point<Leaf,T,Dims> removed = RemoveAt(slot.nodeIndex,slot.position);
+                        std::uint32_t parentIndex = m_nodes[slot.nodeIndex].m_parentIndex;
+                        std::uint32_t index = slot.nodeIndex;
+                        while (parentIndex != InvalidIndex && TryJoin(parentIndex,m_bucketSize / 2)) // a joined node may be joined with its sibling right away
+                        {
+                            index = parentIndex;
+                            parentIndex = m_nodes[parentIndex].m_parentIndex;
+                        }
+
+                        Rebalance(index);
+
+                        return removed;
+                    }
+                    /**
+                     * @brief Remove a point from the leaf node at index. Uses operator== of the stored Leaf-type object to find it, the last point of the leaf is moved into its place.
+                     *
+                     * @param index index of a leaf node
+                     * @param point point to be removed
+                     * @return the removed point or std::nullopt if the leaf does not hold it
+                     */
+                    std::optional<Point<Leaf,T,Dims> > RemovePoint(std::uint32_t index, const Point<Leaf,T,Dims> &point)
+                    {
+                        const auto position = m_nodes[index].m_storedData.Find(point);
+                        if (!position.has_value())
+                            return std::nullopt;
+
+                        return RemoveAt(index,position.value());
+                    }
+                    /**
+                     * @brief Rebuild the highest unbalanced subtree (see SetBalanceFactor) on the path from the node at index to the root. The handles stay valid.
+                     *
+                     * @param index index of the node whose points have changed
+                     * @return true if a subtree was rebuilt
+                     * @return false otherwise
+                     */
+                    bool Rebalance(std::uint32_t index)
+                    {
+                        if (m_balanceFactor >= 1.)
+                            return false;
+
+                        std::uint32_t scapegoat = InvalidIndex;
+                        for (; index != InvalidIndex; index = m_nodes[index].m_parentIndex)
+                            if (!IsBalanced(m_nodes[index]))
+                                scapegoat = index;
+
+                        if (scapegoat == InvalidIndex)
+                            return false;
+
+                        m_splitBuffer.clear();
+                        Collect(scapegoat);
+                        Rebuild(scapegoat,m_splitBuffer.begin(),m_splitBuffer.end());
+                        return true;
+                    }
+                    /**
+                     * @brief Set how unbalanced a subtree may get before it is rebuilt (see Rebalance)
+                     *
+                     * @param balanceFactor the largest fraction of the points of a subtree that one of its children may hold, clamped to [0.5,1]; 1 (default) never rebuilds
+                     */
+                    inline void SetBalanceFactor(double balanceFactor) noexcept {m_balanceFactor = std::clamp(balanceFactor,0.5,1.);}
+                    [[nodiscard]] inline double GetBalanceFactor() const noexcept {return m_balanceFactor;}
+                    /**
+                     * @brief Check whether handle still holds a point of this tree
+                     *
+                     */
+                    [[nodiscard]] bool IsValidHandle(PointHandle handle) const noexcept
+                    {
+                        return handle.index < m_handleSlots.size() && m_handleSlots[handle.index].generation == handle.generation && m_handleSlots[handle.index].nodeIndex != InvalidIndex;
+                    }
+                    /**
+                     * @brief Join the children of the node at index back into it, if both are leaves and together they hold at most maxSize points
+                     *
+                     * @param index index of a split node
+                     * @param maxSize the maximal number of points of the joined node (the bucket size by default)
+                     * @return true if the node has joined
+                     * @return false otherwise
+                     */
+                    bool TryJoin(std::uint32_t index, std::size_t maxSize)
+                    {
+                        const NodeType &node = m_nodes[index];
+                        if (!node.IsSplit())
+                            return false;
+
+                        const NodeType &left = m_nodes[node.m_leftIndex];
+                        const NodeType &right = m_nodes[node.m_rightIndex];
+                        if (!left.IsSplit() && !right.IsSplit() && (left.size() + right.size() <= maxSize))
+                        {
+                            Join(index);
+                            return true;
+                        }
+                        else
+                        {
+                            return false;
+                        }
+                    }
+                    bool TryJoin(std::uint32_t index)
+                    {
+                        return TryJoin(index,m_bucketSize);
+                    }
+                    [[nodiscard]] inline NodeType& operator[](std::uint32_t index) noexcept {return m_nodes[index];}
+                    [[nodiscard]] inline const NodeType& operator[](std::uint32_t index) const noexcept {return m_nodes[index];}
+                    [[nodiscard]] inline NodeType& GetLeftNode(std::uint32_t index) noexcept {return m_nodes[m_nodes[index].m_leftIndex];}
+                    [[nodiscard]] inline const NodeType& GetLeftNode(std::uint32_t index) const noexcept {return m_nodes[m_nodes[index].m_leftIndex];}
+                    [[nodiscard]] inline NodeType& GetRightNode(std::uint32_t index) noexcept {return m_nodes[m_nodes[index].m_rightIndex];}
+                    [[nodiscard]] inline const NodeType& GetRightNode(std::uint32_t index) const noexcept {return m_nodes[m_nodes[index].m_rightIndex];}
+                    [[nodiscard]] inline static constexpr std::uint32_t GetRootIndex() noexcept {return 0;}
+                    [[nodiscard]] inline bool IsValidIndex(std::uint32_t index) const noexcept {return index < m_nodes.size();}
+                    [[nodiscard]] inline bool IsEmpty() const noexcept {return m_nodes.empty();}
+                    [[nodiscard]] inline std::size_t GetNumberOfNodes() const noexcept {return m_nodes.size() - m_freeIndices.size();}
+                    [[nodiscard]] inline std::size_t GetBucketSize() const noexcept {return m_bucketSize;}
+                    /**
+                     * @brief Returns the smallest and the largest coordinate along every dimension of the points added since the last build. Every stored point lies inside these bounds, but they do not shrink when points are removed.
+                     *
+                     * @return const std::array<std::pair<T,T>,Dims>& (the first of the pair is larger than the second while the array holds no points)
+                     */
+                    [[nodiscard]] inline const std::array<std::pair<T,T>,Dims>& GetBounds() const noexcept {return m_bounds;}
+                    [[nodiscard]] inline std::pmr::memory_resource* GetMemoryResource() const noexcept {return m_nodes.get_allocator().resource();}
+            };
+
+        } // namespace KDTree
+
+    } // namespace JJDataStruct
+
+
+#endif
@@ -0,0 +1,374 @@
+#ifndef OutOfCoreBuilder_hxx
+    #define OutOfCoreBuilder_hxx
+
+    #include <algorithm>
+    #include <filesystem>
+    #include <fstream>
+    #include <random>
+    #include <stdexcept>
+    #include <string>
+    #include <system_error>
+    #include <type_traits>
+    #include <vector>
+
+    #include "NodeArray.hxx"
+    #include "FrozenNodeArray.hxx"
+    #include "FileFormat.hxx"
+
+    namespace JJDataStruct
+    {
+        namespace KDTree
+        {
+            /**
+             * @brief Builder of frozen tree files (see FrozenKDTree::Map) for data sets which do not fit into memory. The points are read from a file in chunks and partitioned on disk around medians estimated from a sample, until each part fits into the memory budget; such a part is then built in memory and its leaves are appended to the output.
+             * Only the points count towards the memory budget; the nodes of the tree (sizeof(FrozenNodeRecord<T>) bytes for about every bucketSize / 2 points) are kept in memory until the file is written. The temporary files take at most about three times the size of the input at once (the packed points, which are a full copy of the input, and the parts being partitioned).
+             *
+             * @tparam Leaf Object type that will be stored in leafs (has to be trivially copyable)
+             * @tparam Dims Number of dimensions over which the data will be divided
+             * @tparam T Arithmetic type of point coordinates
+             */
+            template <typename Leaf, std::size_t Dims, typename T = double>
+            class OutOfCoreBuilder
+            {
+                private:
+                    using PointType = Point<Leaf,T,Dims>;
+                    using Record = FrozenNodeRecord<T>;
+
+                    static_assert(std::is_trivially_copyable_v<PointType> && std::is_default_constructible_v<PointType>,"Only points of trivially copyable and default constructible objects can be read from a file");
+
+                    /**
+                     * @brief Number of coordinates from which a median is estimated
+                     *
+                     */
+                    static constexpr std::size_t SampleSize = 1 << 16;
+
+                    /**
+                     * @brief File of points which is removed once it goes out of scope (unless it belongs to the caller)
+                     *
+                     */
+                    class TemporaryFile
+                    {
+                        private:
+                            std::filesystem::path m_path;
+                            bool m_isOwned;
+
+                        public:
+                            TemporaryFile(std::filesystem::path path, bool isOwned) : m_path(std::move(path)), m_isOwned(isOwned) {}
+                            TemporaryFile(TemporaryFile &&other) noexcept : m_path(std::move(other.m_path)), m_isOwned(other.m_isOwned) {other.m_isOwned = false;}
+                            TemporaryFile(const TemporaryFile&) = delete;
+                            TemporaryFile& operator=(const TemporaryFile&) = delete;
+                            TemporaryFile& operator=(TemporaryFile&&) = delete;
+                            ~TemporaryFile() {Remove();}
+                            void Remove() noexcept
+                            {
+                                if (m_isOwned)
+                                {
+                                    std::error_code error;
+                                    std::filesystem::remove(m_path,error);
+                                    m_isOwned = false;
+                                }
+                            }
+                            [[nodiscard]] inline const std::filesystem::path& GetPath() const noexcept {return m_path;}
+                    };
+
+                    std::size_t m_bucketSize, m_memoryBudget;
+                    std::filesystem::path m_tempDirectory;
+                    std::string m_tempPrefix;
+                    std::size_t m_nTempFiles;
+                    std::vector<Record> m_records;
+                    std::ofstream m_packedPoints;
+                    std::uint64_t m_nPackedPoints;
+                    std::mt19937_64 m_generator;
+
+                    [[nodiscard]] std::size_t GetChunkSize() const noexcept {return std::max<std::size_t>(1,m_memoryBudget / sizeof(PointType) / 4);}
+                    // a part built in memory is held twice for a moment: as a vector of points and in the buckets of the nodes
+                    [[nodiscard]] std::uint64_t GetInMemoryLimit() const noexcept {return std::max<std::uint64_t>(m_bucketSize,m_memoryBudget / sizeof(PointType) / 2);}
+                    [[nodiscard]] TemporaryFile MakeTemporaryFile()
+                    {
+                        return TemporaryFile(m_tempDirectory / (m_tempPrefix + std::to_string(m_nTempFiles++) + ".tmp"),true);
+                    }
+                    /**
+                     * @brief Call func(points,count) for consecutive chunks of the points stored in a file
+                     *
+                     */
+                    template <typename Func>
+                    void ForEachChunk(const std::filesystem::path &path, Func func) const
+                    {
+                        std::ifstream file(path,std::ios::binary);
+                        if (!file)
+                            throw std::runtime_error("OutOfCoreBuilder::ForEachChunk - cannot open " + path.string());
+
+                        std::vector<PointType> chunk(GetChunkSize());
+                        while (file)
+                        {
+                            file.read(reinterpret_cast<char*>(chunk.data()),static_cast<std::streamsize>(chunk.size() * sizeof(PointType)));
+                            const auto count = static_cast<std::size_t>(file.gcount()) / sizeof(PointType);
+                            if (count > 0)
+                                func(chunk.data(),count);
+                        }
+                        if (!file.eof())
+                            throw std::runtime_error("OutOfCoreBuilder::ForEachChunk - cannot read " + path.string());
+                    }
+                    static void Write(std::ofstream &file, const PointType &point)
+                    {
+                        file.write(reinterpret_cast<const char*>(&point),sizeof(PointType));
+                    }
+                    /**
+                     * @brief Estimate the median of the dim-th coordinate of the nPoints points stored in a file from a uniform sample of them (reservoir sampling)
+                     *
+                     */
+                    T SampleMedian(const std::filesystem::path &path, std::uint64_t nPoints, std::size_t dim)
+                    {
+                        std::vector<T> sample;
+                        sample.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(nPoints,SampleSize)));
+                        std::uint64_t nSeen = 0;
+                        ForEachChunk(path,[&](const PointType *points, std::size_t count)
+                        {
+                            for (std::size_t i = 0; i < count; ++i, ++nSeen)
+                            {
+                                if (sample.size() < SampleSize)
+                                {
+                                    sample.push_back(points[i].coords[dim]);
+                                }
+                                else
+                                {
+                                    const std::uint64_t slot = std::uniform_int_distribution<std::uint64_t>(0,nSeen)(m_generator);
+                                    if (slot < SampleSize)
+                                        sample[static_cast<std::size_t>(slot)] = points[i].coords[dim];
+                                }
+                            }
+                        });
+
+                        auto mid = sample.begin() + static_cast<std::ptrdiff_t>(sample.size() / 2);
+                        std::nth_element(sample.begin(),mid,sample.end());
+                        return *mid;
+                    }
+                    /**
+                     * @brief Append the nodes of a subtree built in memory to the records (in pre-order) and the points of its leaves to the packed points (from left to right)
+                     *
+                     * @return index of the subtree's root in the records
+                     */
+                    template <typename Distance>
+                    std::uint32_t CopySubtree(const NodeArray<Leaf,T,Dims,Distance> &nodes, std::uint32_t index)
+                    {
+                        const auto &node = nodes[index];
+                        const auto recordIndex = static_cast<std::uint32_t>(m_records.size());
+                        m_records.push_back({node.GetMedian(),static_cast<std::uint32_t>(node.GetDimensionIndex()),0,0});
+                        if (node.IsSplit())
+                        {
+                            const std::uint32_t left = CopySubtree(nodes,node.GetLeftIndex());
+                            const std::uint32_t right = CopySubtree(nodes,node.GetRightIndex());
+                            m_records[recordIndex].first = left;
+                            m_records[recordIndex].second = right;
+                        }
+                        else
+                        {
+                            const auto &bucket = node.GetBucket();
+                            m_records[recordIndex] = {T(),Record::LeafMarker,static_cast<std::uint32_t>(m_nPackedPoints),static_cast<std::uint32_t>(m_nPackedPoints + bucket.size())};
+                            for (std::size_t i = 0; i < bucket.size(); ++i)
+                                Write(m_packedPoints,bucket.GetPoint(i));
+                            m_nPackedPoints += bucket.size();
+                        }
+
+                        return recordIndex;
+                    }
+                    /**
+                     * @brief Build the subtree of the nPoints points stored in file: in memory if they fit into the budget, otherwise by partitioning the file into two around the estimated median of the splitting dimension
+                     *
+                     * @return index of the subtree's root in the records
+                     */
+                    std::uint32_t BuildSubtree(TemporaryFile file, std::uint64_t nPoints, std::size_t depth)
+                    {
+                        if (nPoints <= GetInMemoryLimit())
+                        {
+                            std::vector<PointType> data;
+                            data.reserve(static_cast<std::size_t>(nPoints));
+                            ForEachChunk(file.GetPath(),[&data](const PointType *points, std::size_t count){data.insert(data.end(),points,points + count);});
+                            file.Remove();
+
+                            NodeArray<Leaf,T,Dims,SquaredDist> nodes(m_bucketSize); // the metric plays no role in building
+                            nodes.Build(std::move(data),1,depth);
+                            return CopySubtree(nodes,nodes.GetRootIndex());
+                        }
+
+                        const std::size_t dim = depth % Dims;
+                        const T median = SampleMedian(file.GetPath(),nPoints,dim);
+
+                        // points lying on the median may go to either side, they are split so that both sides end up as close to a half as possible (and never empty)
+                        std::uint64_t nLess = 0, nEqual = 0;
+                        ForEachChunk(file.GetPath(),[&](const PointType *points, std::size_t count)
+                        {
+                            for (std::size_t i = 0; i < count; ++i)
+                            {
+                                nLess += (points[i].coords[dim] < median);
+                                nEqual += (points[i].coords[dim] == median);
+                            }
+                        });
+                        const std::uint64_t half = nPoints / 2;
+                        std::uint64_t nEqualLeft = (nLess < half) ? std::min(half - nLess,nEqual) : 0;
+                        const std::uint64_t nLeft = nLess + nEqualLeft;
+
+                        TemporaryFile leftFile = MakeTemporaryFile();
+                        TemporaryFile rightFile = MakeTemporaryFile();
+                        {
+                            std::ofstream left(leftFile.GetPath(),std::ios::binary | std::ios::trunc);
+                            std::ofstream right(rightFile.GetPath(),std::ios::binary | std::ios::trunc);
+                            ForEachChunk(file.GetPath(),[&](const PointType *points, std::size_t count)
+                            {
+                                for (std::size_t i = 0; i < count; ++i)
+                                {
+                                    const T coord = points[i].coords[dim];
+                                    if (coord < median || (coord == median && nEqualLeft > 0))
+                                    {
+                                        nEqualLeft -= (coord == median);
+                                        Write(left,points[i]);
+                                    }
+                                    else
+                                    {
+                                        Write(right,points[i]);
+                                    }
+                                }
+                            });
+                            if (!left.flush() || !right.flush())
+                                throw std::runtime_error("OutOfCoreBuilder::BuildSubtree - cannot write to " + m_tempDirectory.string());
+                        }
+                        file.Remove();
+
+                        const auto recordIndex = static_cast<std::uint32_t>(m_records.size());
+                        m_records.push_back({median,static_cast<std::uint32_t>(dim),0,0});
+                        const std::uint32_t leftIndex = BuildSubtree(std::move(leftFile),nLeft,depth + 1);
+                        const std::uint32_t rightIndex = BuildSubtree(std::move(rightFile),nPoints - nLeft,depth + 1);
+                        m_records[recordIndex].first = leftIndex;
+                        m_records[recordIndex].second = rightIndex;
+
+                        return recordIndex;
+                    }
+                    /**
+                     * @brief Write the tree file: the nodes in van Emde Boas order and then the packed points, transposed column by column in chunks
+                     *
+                     */
+                    void WriteOutput(const std::filesystem::path &packedPath, const std::string &outputPath)
+                    {
+                        const std::vector<Record> records = VanEmdeBoasLayout<T>::Apply(m_records);
+                        const FileFormat::Header header = FileFormat::MakeHeader<Leaf,T,Dims>(records.size(),m_nPackedPoints);
+
+                        std::ofstream output(outputPath,std::ios::binary | std::ios::trunc);
+                        if (!output)
+                            throw std::runtime_error("OutOfCoreBuilder::WriteOutput - cannot open " + outputPath);
+
+                        FileFormat::WriteAt(output,0,&header,sizeof(header));
+                        FileFormat::WriteRecords(output,header.recordsOffset,records.data(),records.size());
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                        {
+                            std::uint64_t offset = header.columnsOffset + dim * header.columnStride;
+                            std::vector<T> column;
+                            ForEachChunk(packedPath,[&](const PointType *points, std::size_t count)
+                            {
+                                column.resize(count);
+                                for (std::size_t i = 0; i < count; ++i)
+                                    column[i] = points[i].coords[dim];
+
+                                FileFormat::WriteAt(output,offset,column.data(),count * sizeof(T));
+                                offset += count * sizeof(T);
+                            });
+                        }
+
+                        std::uint64_t offset = header.objectsOffset;
+                        std::vector<Leaf> objects;
+                        ForEachChunk(packedPath,[&](const PointType *points, std::size_t count)
+                        {
+                            objects.resize(count);
+                            std::transform(points,points + count,objects.begin(),[](const PointType &point){return point.object;});
+                            FileFormat::WriteAt(output,offset,objects.data(),count * sizeof(Leaf));
+                            offset += count * sizeof(Leaf);
+                        });
+                        FileFormat::WriteAt(output,header.fileSize,nullptr,0); // without any points nothing else reaches the end of the file
+
+                        if (!output.flush())
+                            throw std::runtime_error("OutOfCoreBuilder::WriteOutput - cannot write " + outputPath);
+                    }
+
+                public:
+                    /**
+                     * @brief Construct a new OutOfCoreBuilder object
+                     *
+                     * @param bucketSize the maximal number of points in each leaf
+                     * @param memoryBudget number of bytes of memory which the points may take at once
+                     * @param tempDirectory directory for the temporary files
+                     */
+                    OutOfCoreBuilder(std::size_t bucketSize, std::size_t memoryBudget, std::filesystem::path tempDirectory = std::filesystem::temp_directory_path()) :
+                        m_bucketSize(bucketSize), m_memoryBudget(memoryBudget), m_tempDirectory(std::move(tempDirectory)), m_tempPrefix(), m_nTempFiles(0), m_records(), m_packedPoints(), m_nPackedPoints(0), m_generator(42)
+                    {
+                        m_tempPrefix = "kdtree-" + std::to_string(std::random_device{}()) + "-";
+                    }
+                    /**
+                     * @brief Build a tree from the points stored in a file and write it to another file, from which it can be mapped with FrozenKDTree::Map.
+                     * The input file holds the points one after another, as they are laid out in memory (an array of Point<Leaf,T,Dims> written byte by byte).
+                     *
+                     * @param inputPath path to the file with the points
+                     * @param outputPath path to the tree file (it is overwritten)
+                     * @throws std::runtime_error if one of the files cannot be read or written
+                     * @throws std::length_error if there are more points than a 32-bit index can address
+                     */
+                    void Build(const std::string &inputPath, const std::string &outputPath)
+                    {
+                        FileFormat::CheckTypes<Leaf,T>();
+
+                        std::error_code error;
+                        const std::uintmax_t inputSize = std::filesystem::file_size(inputPath,error);
+                        if (error || inputSize % sizeof(PointType) != 0)
+                            throw std::runtime_error("OutOfCoreBuilder::Build - " + inputPath + " is not a file of points");
+
+                        const std::uint64_t nPoints = inputSize / sizeof(PointType);
+                        if (nPoints >= InvalidIndex)
+                            throw std::length_error("OutOfCoreBuilder::Build - too many points for a 32-bit index");
+
+                        TemporaryFile packedFile = MakeTemporaryFile();
+                        m_records.clear();
+                        m_nPackedPoints = 0;
+                        m_generator.seed(42); // the same input always gives the same file
+                        m_packedPoints.open(packedFile.GetPath(),std::ios::binary | std::ios::trunc);
+                        if (!m_packedPoints)
+                            throw std::runtime_error("OutOfCoreBuilder::Build - cannot write to " + m_tempDirectory.string());
+
+                        BuildSubtree(TemporaryFile(inputPath,false),nPoints,0);
+
+                        m_packedPoints.close();
+                        if (!m_packedPoints)
+                            throw std::runtime_error("OutOfCoreBuilder::Build - cannot write to " + m_tempDirectory.string());
+
+                        WriteOutput(packedFile.GetPath(),outputPath);
+                        m_records.clear();
+                        m_records.shrink_to_fit();
+                    }
+                    /**
+                     * @brief Build a tree from the points in [first,last) (e.g. read from a stream) and write it to a file, from which it can be mapped with FrozenKDTree::Map. The points are first copied to a temporary file.
+                     *
+                     * @tparam InputIt input iterator over Point<Leaf,T,Dims>
+                     * @param first beginning of the range of points
+                     * @param last end of the range of points
+                     * @param outputPath path to the tree file (it is overwritten)
+                     * @throws std::runtime_error if one of the files cannot be read or written
+                     * @throws std::length_error if there are more points than a 32-bit index can address
+                     */
+                    template <typename InputIt>
+                    void Build(InputIt first, InputIt last, const std::string &outputPath)
+                    {
+                        TemporaryFile inputFile = MakeTemporaryFile();
+                        {
+                            std::ofstream input(inputFile.GetPath(),std::ios::binary | std::ios::trunc);
+                            for (; first != last; ++first)
+                                Write(input,*first);
+                            if (!input.flush())
+                                throw std::runtime_error("OutOfCoreBuilder::Build - cannot write to " + m_tempDirectory.string());
+                        }
+
+                        Build(inputFile.GetPath().string(),outputPath);
+                    }
+            };
+
+        } // namespace KDTree
+
+    } // namespace JJDataStruct
+
+#endif
@@ -0,0 +1,232 @@
+#ifndef QueryStats_hxx
+    #define QueryStats_hxx
+
+    #include <algorithm>
+    #include <array>
+    #include <atomic>
+    #include <cstddef>
+    #include <cstdint>
+    #include <utility>
+    #include <vector>
+
+    // The finders count their work only if KDTREE_ENABLE_STATS is defined before including the tree, otherwise the counters compile to nothing
+    #ifdef KDTREE_ENABLE_STATS
+        #define KDTREE_COUNT(field,n) (::JJDataStruct::KDTree::QueryStats::Current().field += static_cast<std::size_t>(n))
+    #else
+        #define KDTREE_COUNT(field,n) ((void)0)
+    #endif
+
+    namespace JJDataStruct
+    {
+        namespace KDTree
+        {
+            /**
+             * @brief Work performed by one query (or summed over many of them)
+             *
+             */
+            struct QueryStats
+            {
+                std::size_t nodesVisited = 0; // internal (split) nodes
+                std::size_t leavesScanned = 0;
+                std::size_t distanceEvaluations = 0;
+                std::size_t prunedSubtrees = 0; // far children skipped because their cell was too far away
+                std::size_t resultSize = 0;
+
+                QueryStats& operator+=(const QueryStats &other) noexcept
+                {
+                    nodesVisited += other.nodesVisited;
+                    leavesScanned += other.leavesScanned;
+                    distanceEvaluations += other.distanceEvaluations;
+                    prunedSubtrees += other.prunedSubtrees;
+                    resultSize += other.resultSize;
+                    return *this;
+                }
+                /**
+                 * @brief Counters of the query running on the calling thread (the finders add to them through KDTREE_COUNT)
+                 *
+                 * @return QueryStats&
+                 */
+                [[nodiscard]] static QueryStats& Current() noexcept
+                {
+                    thread_local QueryStats stats;
+                    return stats;
+                }
+            };
+
+            /**
+             * @brief Statistics of all the queries recorded since the last reset
+             *
+             */
+            struct QueryStatsSummary
+            {
+                std::size_t nQueries = 0;
+                QueryStats total, max; // sum and maximum of every counter over the queries
+
+                void Add(const QueryStats &query) noexcept
+                {
+                    ++nQueries;
+                    total += query;
+                    max.nodesVisited = std::max(max.nodesVisited,query.nodesVisited);
+                    max.leavesScanned = std::max(max.leavesScanned,query.leavesScanned);
+                    max.distanceEvaluations = std::max(max.distanceEvaluations,query.distanceEvaluations);
+                    max.prunedSubtrees = std::max(max.prunedSubtrees,query.prunedSubtrees);
+                    max.resultSize = std::max(max.resultSize,query.resultSize);
+                }
+                /**
+                 * @brief Mean of a counter per query, e.g. Mean(&QueryStats::leavesScanned)
+                 *
+                 * @param field counter
+                 * @return double (0 if there were no queries)
+                 */
+                [[nodiscard]] double Mean(std::size_t QueryStats::*field) const noexcept
+                {
+                    return (nQueries == 0) ? 0. : static_cast<double>(total.*field) / static_cast<double>(nQueries);
+                }
+            };
+
+            /**
+             * @brief Thread safe collection of QueryStatsSummary, so the queries split across threads can record their statistics in the same tree. 
+             * It takes no lock: the counters are relaxed atomics and the maxima are raised with compare-and-swap, so recording does not serialise the queries it measures. 
+             * Get is not a snapshot, a summary read while queries are being recorded may mix counters from before and after some of them.
+             *
+             */
+            class QueryStatsRecorder
+            {
+                private:
+                    static constexpr std::size_t NFields = 5;
+                    static constexpr std::size_t QueryStats::*Fields[NFields] = {&QueryStats::nodesVisited,&QueryStats::leavesScanned,&QueryStats::distanceEvaluations,&QueryStats::prunedSubtrees,&QueryStats::resultSize};
+
+                    std::atomic<std::size_t> m_nQueries;
+                    std::array<std::atomic<std::size_t>,NFields> m_total, m_max;
+
+                    void Store(const QueryStatsSummary &summary) noexcept
+                    {
+                        m_nQueries.store(summary.nQueries,std::memory_order_relaxed);
+                        for (std::size_t i = 0; i < NFields; ++i)
+                        {
+                            m_total[i].store(summary.total.*Fields[i],std::memory_order_relaxed);
+                            m_max[i].store(summary.max.*Fields[i],std::memory_order_relaxed);
+                        }
+                    }
+
+                public:
+                    QueryStatsRecorder() noexcept {Store(QueryStatsSummary());}
+                    QueryStatsRecorder(const QueryStatsRecorder &other) noexcept {Store(other.Get());}
+                    QueryStatsRecorder& operator=(const QueryStatsRecorder &other) noexcept
+                    {
+                        if (this != &other)
+                            Store(other.Get());
+
+                        return *this;
+                    }
+                    /**
+                     * @brief Record a single query
+                     *
+                     */
+                    void Record(const QueryStats &query) noexcept
+                    {
+                        QueryStatsSummary summary;
+                        summary.Add(query);
+                        Record(summary);
+                    }
+                    /**
+                     * @brief Record many queries at once (e.g. summed over a chunk of a batched search, so the shared counters are touched once per chunk)
+                     *
+                     */
+                    void Record(const QueryStatsSummary &queries) noexcept
+                    {
+                        if (queries.nQueries == 0)
+                            return;
+
+                        m_nQueries.fetch_add(queries.nQueries,std::memory_order_relaxed);
+                        for (std::size_t i = 0; i < NFields; ++i)
+                        {
+                            m_total[i].fetch_add(queries.total.*Fields[i],std::memory_order_relaxed);
+                            const std::size_t value = queries.max.*Fields[i];
+                            std::size_t current = m_max[i].load(std::memory_order_relaxed);
+                            while (current < value && !m_max[i].compare_exchange_weak(current,value,std::memory_order_relaxed)) {}
+                        }
+                    }
+                    [[nodiscard]] QueryStatsSummary Get() const noexcept
+                    {
+                        QueryStatsSummary summary;
+                        summary.nQueries = m_nQueries.load(std::memory_order_relaxed);
+                        for (std::size_t i = 0; i < NFields; ++i)
+                        {
+                            summary.total.*Fields[i] = m_total[i].load(std::memory_order_relaxed);
+                            summary.max.*Fields[i] = m_max[i].load(std::memory_order_relaxed);
+                        }
+
+                        return summary;
+                    }
+                    void Reset() noexcept {Store(QueryStatsSummary());}
+            };
+
+            /**
+             * @brief Shape of a tree: how deep its leaves lie and how full their buckets are
+             *
+             */
+            struct TreeShape
+            {
+                std::size_t nInternalNodes = 0;
+                std::vector<std::size_t> depthHistogram; // depthHistogram[d] is the number of leaves at depth d (the root has depth 0)
+                std::vector<std::size_t> fillHistogram; // fillHistogram[n] is the number of leaves holding n points
+
+                [[nodiscard]] std::size_t GetNumberOfLeaves() const noexcept
+                {
+                    std::size_t nLeaves = 0;
+                    for (std::size_t count : depthHistogram)
+                        nLeaves += count;
+
+                    return nLeaves;
+                }
+                [[nodiscard]] std::size_t GetMaxDepth() const noexcept {return depthHistogram.empty() ? 0 : depthHistogram.size() - 1;}
+            };
+
+            /**
+             * @brief Walk the tree from the given node and histogram the depths and the fill of its leaves
+             *
+             * @tparam Nodes array holding the tree (NodeArray or FrozenNodeArray)
+             * @param nodes array holding the tree
+             * @param index starting node index (top of the tree)
+             * @return TreeShape
+             */
+            template <typename Nodes>
+            [[nodiscard]] TreeShape GetTreeShape(const Nodes &nodes, std::uint32_t index)
+            {
+                TreeShape shape;
+                if (!nodes.IsValidIndex(index))
+                    return shape;
+
+                std::vector<std::pair<std::uint32_t,std::size_t> > stack = {{index,0}};
+                while (!stack.empty())
+                {
+                    const auto [current,depth] = stack.back();
+                    stack.pop_back();
+                    const auto &node = nodes[current];
+                    if (node.IsSplit())
+                    {
+                        ++shape.nInternalNodes;
+                        stack.push_back({node.GetLeftIndex(),depth + 1});
+                        stack.push_back({node.GetRightIndex(),depth + 1});
+                    }
+                    else
+                    {
+                        if (shape.depthHistogram.size() <= depth)
+                            shape.depthHistogram.resize(depth + 1,0);
+                        if (shape.fillHistogram.size() <= node.size())
+                            shape.fillHistogram.resize(node.size() + 1,0);
+
+                        ++shape.depthHistogram[depth];
+                        ++shape.fillHistogram[node.size()];
+                    }
+                }
+
+                return shape;
+            }
+
+        } // namespace KDTree
+
+    } // namespace JJDataStruct
+
+#endif
@@ -0,0 +1,250 @@
+#ifndef SplitPolicies_hxx
+    #define SplitPolicies_hxx
+
+    #include <algorithm>
+    #include <array>
+    #include <cstddef>
+    #include <iterator>
+    #include <limits>
+    #include <utility>
+
+    namespace JJDataStruct
+    {
+        namespace KDTree
+        {
+            /**
+             * @brief Plane along which a split policy has divided the points of a node
+             *
+             * @tparam T Arithmetic type of point coordinates
+             */
+            template <typename T>
+            struct SplitPlane
+            {
+                std::size_t dimension;
+                T value;
+                std::size_t nLeft; // the first nLeft points lie at or below value, the others at or above it
+            };
+
+            /**
+             * @brief Building blocks of the split policies. Every policy works on a range of any elements, of which it reads the coordinates through coordinate(element,dim).
+             *
+             */
+            namespace Splits
+            {
+                /**
+                 * @brief Partition [first,last) around its middle element along dim (selection, not sorting) and return the plane through the median
+                 *
+                 */
+                template <typename T, typename RandomIt, typename Coordinate>
+                SplitPlane<T> AtMedian(RandomIt first, RandomIt last, std::size_t dim, Coordinate &coordinate)
+                {
+                    auto compare = [dim,&coordinate](const auto &p1, const auto &p2){return coordinate(p1,dim) < coordinate(p2,dim);};
+                    const auto nPoints = static_cast<std::size_t>(last - first);
+                    RandomIt mid = first + static_cast<std::ptrdiff_t>(nPoints / 2);
+                    std::nth_element(first,mid,last,compare);
+
+                    if (mid - first == last - mid) // if the median is between the points
+                    {
+                        return {dim,(coordinate(*std::max_element(first,mid,compare),dim) + coordinate(*mid,dim)) / 2,nPoints / 2};
+                    }
+                    else // if the median is at point
+                    {
+                        return {dim,coordinate(*mid,dim),nPoints / 2};
+                    }
+                }
+                /**
+                 * @brief Smallest and largest coordinate of [first,last) in every dimension
+                 *
+                 */
+                template <typename T, std::size_t Dims, typename RandomIt, typename Coordinate>
+                std::array<std::pair<T,T>,Dims> Bounds(RandomIt first, RandomIt last, Coordinate &coordinate)
+                {
+                    std::array<std::pair<T,T>,Dims> bounds;
+                    bounds.fill({std::numeric_limits<T>::max(),std::numeric_limits<T>::lowest()});
+                    for (; first != last; ++first)
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                        {
+                            const T x = coordinate(*first,dim);
+                            bounds[dim].first = std::min(bounds[dim].first,x);
+                            bounds[dim].second = std::max(bounds[dim].second,x);
+                        }
+
+                    return bounds;
+                }
+                template <typename T, std::size_t Dims>
+                std::size_t WidestDimension(const std::array<std::pair<T,T>,Dims> &bounds) noexcept
+                {
+                    std::size_t widest = 0;
+                    for (std::size_t dim = 1; dim < Dims; ++dim)
+                        if (bounds[dim].second - bounds[dim].first > bounds[widest].second - bounds[widest].first)
+                            widest = dim;
+
+                    return widest;
+                }
+                /**
+                 * @brief Partition [first,last) into the points at or below value along dim and the others. If either side would be empty, the plane slides to the nearest point, which then forms the empty side alone.
+                 *
+                 */
+                template <typename T, typename RandomIt, typename Coordinate>
+                SplitPlane<T> AtValue(RandomIt first, RandomIt last, std::size_t dim, T value, Coordinate &coordinate)
+                {
+                    auto compare = [dim,&coordinate](const auto &p1, const auto &p2){return coordinate(p1,dim) < coordinate(p2,dim);};
+                    const RandomIt mid = std::partition(first,last,[dim,value,&coordinate](const auto &p){return coordinate(p,dim) <= value;});
+                    const auto nLeft = static_cast<std::size_t>(mid - first);
+                    if (mid == first)
+                    {
+                        std::nth_element(first,first,last,compare);
+                        return {dim,coordinate(*first,dim),1};
+                    }
+                    else if (mid == last)
+                    {
+                        std::nth_element(first,last - 1,last,compare);
+                        return {dim,coordinate(*(last - 1),dim),nLeft - 1};
+                    }
+                    else
+                    {
+                        return {dim,value,nLeft};
+                    }
+                }
+            } // namespace Splits
+
+            /**
+             * @brief Split policy of a classic k-d tree: the dimensions take turns with the depth of the node and the points are split at the median. Every split halves the points.
+             * A split policy is a type with a static Split<T,Dims>(first,last,depth,coordinate) function, which partitions a range of at least two points and returns the SplitPlane, and a SplitsInHalf constant, which tells whether the left side always gets half of the points (the tree can then be built in parallel, see NodeArray::Build).
+             *
+             */
+            struct CyclicMedianSplit
+            {
+                static constexpr bool SplitsInHalf = true;
+
+                template <typename T, std::size_t Dims, typename RandomIt, typename Coordinate>
+                static SplitPlane<T> Split(RandomIt first, RandomIt last, std::size_t depth, Coordinate coordinate)
+                {
+                    return Splits::AtMedian<T>(first,last,depth % Dims,coordinate);
+                }
+            };
+
+            /**
+             * @brief Split policy choosing the dimension in which the points are spread the most and splitting the points at the median. Every split halves the points, but the cells stay closer to cubes when the points are spread much more along some axes than along others.
+             *
+             */
+            struct MaxSpreadSplit
+            {
+                static constexpr bool SplitsInHalf = true;
+
+                template <typename T, std::size_t Dims, typename RandomIt, typename Coordinate>
+                static SplitPlane<T> Split(RandomIt first, RandomIt last, std::size_t, Coordinate coordinate)
+                {
+                    const auto bounds = Splits::Bounds<T,Dims>(first,last,coordinate);
+                    return Splits::AtMedian<T>(first,last,Splits::WidestDimension<T,Dims>(bounds),coordinate);
+                }
+            };
+
+            /**
+             * @brief Split policy of the sliding midpoint rule (Maneewongvatana & Mount): the points are split at the middle of their extent in the dimension in which they are spread the most. If all the points lie on one side, the plane slides to the nearest of them.
+             * The cells never get long and thin, whatever the distribution of the points, at the cost of subtrees of different sizes.
+             *
+             */
+            struct SlidingMidpointSplit
+            {
+                static constexpr bool SplitsInHalf = false;
+
+                template <typename T, std::size_t Dims, typename RandomIt, typename Coordinate>
+                static SplitPlane<T> Split(RandomIt first, RandomIt last, std::size_t, Coordinate coordinate)
+                {
+                    const auto bounds = Splits::Bounds<T,Dims>(first,last,coordinate);
+                    const std::size_t dim = Splits::WidestDimension<T,Dims>(bounds);
+                    return Splits::AtValue<T>(first,last,dim,static_cast<T>(bounds[dim].first + (bounds[dim].second - bounds[dim].first) / 2),coordinate);
+                }
+            };
+
+            /**
+             * @brief Split policy minimising a cost model of the search (the surface area heuristic): the chance that a search visits a child is taken as proportional to the surface of the bounding box of the child, so the plane minimises the sum of surface times number of points over both children.
+             * The candidate planes lie at the boundaries of Bins equal bins along every dimension, so choosing a plane takes O(Dims * n).
+             *
+             * @tparam Bins number of bins along every dimension
+             */
+            template <std::size_t Bins = 16>
+            struct SurfaceAreaSplit
+            {
+                static constexpr bool SplitsInHalf = false;
+
+                template <std::size_t Dims>
+                static double Surface(const std::array<double,Dims> &extents) noexcept
+                {
+                    if constexpr (Dims == 1)
+                    {
+                        return 1.;
+                    }
+                    else
+                    {
+                        double surface = 0.;
+                        for (std::size_t dim = 0; dim < Dims; ++dim)
+                        {
+                            double face = 1.;
+                            for (std::size_t other = 0; other < Dims; ++other)
+                                if (other != dim)
+                                    face *= extents[other];
+                            surface += face;
+                        }
+
+                        return surface;
+                    }
+                }
+                template <typename T, std::size_t Dims, typename RandomIt, typename Coordinate>
+                static SplitPlane<T> Split(RandomIt first, RandomIt last, std::size_t depth, Coordinate coordinate)
+                {
+                    const auto bounds = Splits::Bounds<T,Dims>(first,last,coordinate);
+                    std::array<double,Dims> extents;
+                    for (std::size_t dim = 0; dim < Dims; ++dim)
+                        extents[dim] = static_cast<double>(bounds[dim].second) - static_cast<double>(bounds[dim].first);
+
+                    const auto nPoints = static_cast<std::size_t>(last - first);
+                    double bestCost = std::numeric_limits<double>::max();
+                    std::size_t bestDim = Dims;
+                    T bestValue = T();
+                    for (std::size_t dim = 0; dim < Dims; ++dim)
+                    {
+                        if (!(extents[dim] > 0.))
+                            continue;
+
+                        std::array<std::size_t,Bins> counts{};
+                        for (RandomIt it = first; it != last; ++it)
+                        {
+                            const double position = (static_cast<double>(coordinate(*it,dim)) - static_cast<double>(bounds[dim].first)) / extents[dim];
+                            ++counts[std::min(static_cast<std::size_t>(position * static_cast<double>(Bins)),Bins - 1)];
+                        }
+
+                        std::size_t nLeft = 0;
+                        for (std::size_t bin = 1; bin < Bins; ++bin)
+                        {
+                            nLeft += counts[bin - 1];
+                            if (nLeft == 0 || nLeft == nPoints)
+                                continue;
+
+                            const double fraction = static_cast<double>(bin) / static_cast<double>(Bins);
+                            std::array<double,Dims> leftExtents = extents, rightExtents = extents;
+                            leftExtents[dim] = extents[dim] * fraction;
+                            rightExtents[dim] = extents[dim] - leftExtents[dim];
+                            const double cost = Surface(leftExtents) * static_cast<double>(nLeft) + Surface(rightExtents) * static_cast<double>(nPoints - nLeft);
+                            if (cost < bestCost)
+                            {
+                                bestCost = cost;
+                                bestDim = dim;
+                                bestValue = static_cast<T>(static_cast<double>(bounds[dim].first) + extents[dim] * fraction);
+                            }
+                        }
+                    }
+
+                    if (bestDim == Dims) // the points cannot be told apart by the bins
+                        return Splits::AtMedian<T>(first,last,depth % Dims,coordinate);
+
+                    return Splits::AtValue<T>(first,last,bestDim,bestValue,coordinate);
+                }
+            };
+
+        } // namespace KDTree
+
+    } // namespace JJDataStruct
+
+#endif
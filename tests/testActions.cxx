@@ -17,43 +17,44 @@ TEST_CASE("Inserter class tests","[node][point][distance][action]")
 {
     JJDataStruct::KDTree::Inserter<OneDim,double,1,SquaredDist> inserter;
 
-    SECTION("Inserter throws an exception if the node is a null pointer")
+    SECTION("Inserter throws an exception if the node index is out of range")
     {
+        NodeArray<OneDim,double,1,SquaredDist> emptyNodes(1); // array without even a root node
         Point<OneDim,double,1> newPointOneDim = {objOneDim1,objOneDim1.x};
-        REQUIRE_THROWS(inserter.Insert(nullptr,std::move(newPointOneDim))); // passing a nullptr should throw std::runtime_error
+        REQUIRE_THROWS(inserter.Insert(emptyNodes,0,std::move(newPointOneDim))); // passing an index of a non-existent node should throw std::runtime_error
     }
 
     SECTION("Inserter can add point to empty node")
     {
-        std::shared_ptr<Node<OneDim,double,1,SquaredDist> > node = std::make_shared<Node<OneDim,double,1,SquaredDist> >(std::vector<Point<OneDim,double,1> >(),nullptr,0,1);
-        CHECK(node->IsEmpty());
-        CHECK(node->size() == 0); // making sure the node is empty
+        NodeArray<OneDim,double,1,SquaredDist> nodes(std::vector<Point<OneDim,double,1> >(),1);
+        CHECK(nodes[0].IsEmpty());
+        CHECK(nodes[0].size() == 0); // making sure the node is empty
 
         Point<OneDim,double,1> point1 = {objOneDim1,objOneDim1.x};
-        REQUIRE(inserter.Insert(node,std::move(point1))); // insert x = 1
+        REQUIRE(inserter.Insert(nodes,0,std::move(point1))); // insert x = 1
 
-        REQUIRE_FALSE(node->IsEmpty()); // has elements
-        REQUIRE(node->size() == 1); // has one element
-        REQUIRE(node->GetData().at(0) == point1); // the point is point with x = 1
+        REQUIRE_FALSE(nodes[0].IsEmpty()); // has elements
+        REQUIRE(nodes[0].size() == 1); // has one element
+        REQUIRE(nodes[0].GetData().at(0) == point1); // the point is point with x = 1
     }
 
     SECTION("Inserter can add point to a full node")
     {
         Point<OneDim,double,1> point1 = {objOneDim1,objOneDim1.x};
-        std::shared_ptr<Node<OneDim,double,1,SquaredDist> > node = std::make_shared<Node<OneDim,double,1,SquaredDist> >(std::vector<Point<OneDim,double,1> >{point1},nullptr,0,1);
-        CHECK_FALSE(node->IsEmpty());
-        CHECK(node->size() == 1); // making sure the node is not empty
-        CHECK_FALSE(node->IsSplit()); // making sure the node was not split beforehand
+        NodeArray<OneDim,double,1,SquaredDist> nodes(std::vector<Point<OneDim,double,1> >{point1},1);
+        CHECK_FALSE(nodes[0].IsEmpty());
+        CHECK(nodes[0].size() == 1); // making sure the node is not empty
+        CHECK_FALSE(nodes[0].IsSplit()); // making sure the node was not split beforehand
 
         Point<OneDim,double,1> point2 = {objOneDim2,objOneDim2.x};
-        REQUIRE(inserter.Insert(node,std::move(point2))); // insert x = 4
+        REQUIRE(inserter.Insert(nodes,0,std::move(point2))); // insert x = 4
 
-        REQUIRE(node->IsEmpty()); // has no emtries
-        REQUIRE(node->size() == 0); // ibid.
-        REQUIRE(node->IsSplit()); // has split
-        REQUIRE_THAT(node->GetMedian(),Catch::Matchers::WithinRel(2.5)); // median is (1 + 4) / 2 = 2.5
-        REQUIRE(node->GetLeftNode()->GetData().at(0) == point1); // point x = 1 went left
-        REQUIRE(node->GetRightNode()->GetData().at(0) == point2); // point x = 4 went right
+        REQUIRE(nodes[0].IsEmpty()); // has no emtries
+        REQUIRE(nodes[0].size() == 0); // ibid.
+        REQUIRE(nodes[0].IsSplit()); // has split
+        REQUIRE_THAT(nodes[0].GetMedian(),Catch::Matchers::WithinRel(2.5)); // median is (1 + 4) / 2 = 2.5
+        REQUIRE(nodes[Descend(nodes,"L")].GetData().at(0) == point1); // point x = 1 went left
+        REQUIRE(nodes[Descend(nodes,"R")].GetData().at(0) == point2); // point x = 4 went right
     }
 
     SECTION("Inserter can add point the correct node in a tree")
@@ -61,28 +62,28 @@ TEST_CASE("Inserter class tests","[node][point][distance][action]")
         Point<OneDim,double,1> point1 = {objOneDim1,objOneDim1.x};
         Point<OneDim,double,1> point2 = {objOneDim2,objOneDim2.x};
         Point<OneDim,double,1> point3 = {objOneDim3,objOneDim3.x};
-        std::shared_ptr<Node<OneDim,double,1,SquaredDist> > node = std::make_shared<Node<OneDim,double,1,SquaredDist> >(std::vector<Point<OneDim,double,1> >{point1,point2,point3},nullptr,0,2);
-        CHECK(node->IsEmpty());
-        CHECK(node->size() == 0); // making sure the node is empty
-        CHECK(node->IsSplit()); // making sure it is split
-        CHECK_THAT(node->GetMedian(),Catch::Matchers::WithinRel(4.)); // median is 4
+        NodeArray<OneDim,double,1,SquaredDist> nodes(std::vector<Point<OneDim,double,1> >{point1,point2,point3},2);
+        CHECK(nodes[0].IsEmpty());
+        CHECK(nodes[0].size() == 0); // making sure the node is empty
+        CHECK(nodes[0].IsSplit()); // making sure it is split
+        CHECK_THAT(nodes[0].GetMedian(),Catch::Matchers::WithinRel(4.)); // median is 4
 
-        CHECK(node->GetLeftNode()->size() == 1); // left node has 1 point
-        CHECK(node->GetLeftNode()->GetData().at(0) == point1); // x = 1
+        CHECK(nodes[Descend(nodes,"L")].size() == 1); // left node has 1 point
+        CHECK(nodes[Descend(nodes,"L")].GetData().at(0) == point1); // x = 1
 
-        CHECK(node->GetRightNode()->size() == 2); // right node has 2 points
-        CHECK(node->GetRightNode()->GetData().at(0) == point2); // x = 4
-        CHECK(node->GetRightNode()->GetData().at(1) == point3); // x = 5
+        CHECK(nodes[Descend(nodes,"R")].size() == 2); // right node has 2 points
+        CHECK(nodes[Descend(nodes,"R")].GetData().at(0) == point2); // x = 4
+        CHECK(nodes[Descend(nodes,"R")].GetData().at(1) == point3); // x = 5
 
         Point<OneDim,double,1> newPoint = {OneDim{9,2},2};
-        REQUIRE(inserter.Insert(node,std::move(newPoint))); // insert x = 2
+        REQUIRE(inserter.Insert(nodes,0,std::move(newPoint))); // insert x = 2
 
-        CHECK(node->GetRightNode()->size() == 2); // right node has 2 points
-        CHECK(node->GetRightNode()->GetData().at(0) == point2); // x = 4
-        CHECK(node->GetRightNode()->GetData().at(1) == point3); // x = 5
+        CHECK(nodes[Descend(nodes,"R")].size() == 2); // right node has 2 points
+        CHECK(nodes[Descend(nodes,"R")].GetData().at(0) == point2); // x = 4
+        CHECK(nodes[Descend(nodes,"R")].GetData().at(1) == point3); // x = 5
 
-        REQUIRE(node->GetLeftNode()->size() == 2); // right node has 2 points
-        REQUIRE(node->GetLeftNode()->GetData().at(1) == newPoint); // x = 2
+        REQUIRE(nodes[Descend(nodes,"L")].size() == 2); // right node has 2 points
+        REQUIRE(nodes[Descend(nodes,"L")].GetData().at(1) == newPoint); // x = 2
     }
 }
 
@@ -90,47 +91,48 @@ TEST_CASE("Deleter class tests","[node][point][distance][action]")
 {
     JJDataStruct::KDTree::Deleter<OneDim,double,1,SquaredDist> deleter;
 
-    SECTION("Deleter returns std::nullopt if the node is a null pointer")
+    SECTION("Deleter returns std::nullopt if the node index is out of range")
     {
+        NodeArray<OneDim,double,1,SquaredDist> emptyNodes(1); // array without even a root node
         Point<OneDim,double,1> newPointOneDim = {objOneDim1,objOneDim1.x};
-        REQUIRE(deleter.Remove(nullptr,newPointOneDim) == std::nullopt);
+        REQUIRE(deleter.Remove(emptyNodes,0,newPointOneDim) == std::nullopt);
     }
 
     SECTION("Deleter tries to delete an element in an empty node")
     {
-        std::shared_ptr<Node<OneDim,double,1,SquaredDist> > node = std::make_shared<Node<OneDim,double,1,SquaredDist> >(std::vector<Point<OneDim,double,1> >(),nullptr,0,1);
-        CHECK(node->IsEmpty());
-        CHECK(node->size() == 0); // making sure the node is empty
+        NodeArray<OneDim,double,1,SquaredDist> nodes(std::vector<Point<OneDim,double,1> >(),1);
+        CHECK(nodes[0].IsEmpty());
+        CHECK(nodes[0].size() == 0); // making sure the node is empty
 
         Point<OneDim,double,1> point1 = {objOneDim1,objOneDim1.x};
-        REQUIRE_FALSE(deleter.Remove(node,point1).has_value()); // try to remove x = 1
+        REQUIRE_FALSE(deleter.Remove(nodes,0,point1).has_value()); // try to remove x = 1
     }
 
     SECTION("Deleter tries to delete an element which doesn't exist in the tree")
     {
         Point<OneDim,double,1> point1 = {objOneDim1,objOneDim1.x};
         Point<OneDim,double,1> point2 = {objOneDim2,objOneDim2.x};
-        std::shared_ptr<Node<OneDim,double,1,SquaredDist> > node = std::make_shared<Node<OneDim,double,1,SquaredDist> >(std::vector<Point<OneDim,double,1> >{point1,point2},nullptr,0,1);
-        CHECK(node->IsEmpty());
-        CHECK(node->size() == 0); // making sure the node is empty
-        CHECK(node->IsSplit()); // making sure it is split
-        CHECK_THAT(node->GetMedian(),Catch::Matchers::WithinRel(2.5)); // median is 2.5
-        CHECK_FALSE(node->GetLeftNode()->IsEmpty());
-        CHECK(node->GetLeftNode()->size() == 1);
-        CHECK(node->GetLeftNode()->GetData().at(0) == point1); // left node has x = 1
-        CHECK_FALSE(node->GetRightNode()->IsEmpty());
-        CHECK(node->GetRightNode()->size() == 1);
-        CHECK(node->GetRightNode()->GetData().at(0) == point2); // right node has x = 4
+        NodeArray<OneDim,double,1,SquaredDist> nodes(std::vector<Point<OneDim,double,1> >{point1,point2},1);
+        CHECK(nodes[0].IsEmpty());
+        CHECK(nodes[0].size() == 0); // making sure the node is empty
+        CHECK(nodes[0].IsSplit()); // making sure it is split
+        CHECK_THAT(nodes[0].GetMedian(),Catch::Matchers::WithinRel(2.5)); // median is 2.5
+        CHECK_FALSE(nodes[Descend(nodes,"L")].IsEmpty());
+        CHECK(nodes[Descend(nodes,"L")].size() == 1);
+        CHECK(nodes[Descend(nodes,"L")].GetData().at(0) == point1); // left node has x = 1
+        CHECK_FALSE(nodes[Descend(nodes,"R")].IsEmpty());
+        CHECK(nodes[Descend(nodes,"R")].size() == 1);
+        CHECK(nodes[Descend(nodes,"R")].GetData().at(0) == point2); // right node has x = 4
 
         Point<OneDim,double,1> point3 = {objOneDim3,objOneDim3.x};
-        REQUIRE_FALSE(deleter.Remove(node,point3).has_value()); // try remove x = 5
+        REQUIRE_FALSE(deleter.Remove(nodes,0,point3).has_value()); // try remove x = 5
         
-        CHECK_FALSE(node->GetLeftNode()->IsEmpty());
-        CHECK(node->GetLeftNode()->size() == 1);
-        CHECK(node->GetLeftNode()->GetData().at(0) == point1); // left node still has x = 1
-        CHECK_FALSE(node->GetRightNode()->IsEmpty());
-        CHECK(node->GetRightNode()->size() == 1);
-        CHECK(node->GetRightNode()->GetData().at(0) == point2); // right node still has x = 4
+        CHECK_FALSE(nodes[Descend(nodes,"L")].IsEmpty());
+        CHECK(nodes[Descend(nodes,"L")].size() == 1);
+        CHECK(nodes[Descend(nodes,"L")].GetData().at(0) == point1); // left node still has x = 1
+        CHECK_FALSE(nodes[Descend(nodes,"R")].IsEmpty());
+        CHECK(nodes[Descend(nodes,"R")].size() == 1);
+        CHECK(nodes[Descend(nodes,"R")].GetData().at(0) == point2); // right node still has x = 4
     }
 
     SECTION("Deleter deletes an element which exists in the left sub-tree")
@@ -139,13 +141,13 @@ TEST_CASE("Deleter class tests","[node][point][distance][action]")
         Point<OneDim,double,1> point2 = {objOneDim2,objOneDim2.x};
         Point<OneDim,double,1> point3 = {objOneDim3,objOneDim3.x};
         Point<OneDim,double,1> point4 = {objOneDim4,objOneDim4.x};
-        std::shared_ptr<Node<OneDim,double,1,SquaredDist> > node = std::make_shared<Node<OneDim,double,1,SquaredDist> >(std::vector<Point<OneDim,double,1> >{point1,point2,point3,point4},nullptr,0,2);
+        NodeArray<OneDim,double,1,SquaredDist> nodes(std::vector<Point<OneDim,double,1> >{point1,point2,point3,point4},2);
         
-        CHECK(node->GetLeftNode()->size() == 2); // node has two points
-        auto removed_point1 = deleter.Remove(node,point1);
+        CHECK(nodes[Descend(nodes,"L")].size() == 2); // node has two points
+        auto removed_point1 = deleter.Remove(nodes,0,point1);
         REQUIRE(removed_point1.has_value()); // remove x = 1
         REQUIRE(removed_point1.value() == point1);
-        REQUIRE(node->GetLeftNode()->size() == 1); // node has one point left
+        REQUIRE(nodes[Descend(nodes,"L")].size() == 1); // node has one point left
     }
 
     SECTION("Deleter deletes an element which exists in the right sub-tree")
@@ -154,28 +156,28 @@ TEST_CASE("Deleter class tests","[node][point][distance][action]")
         Point<OneDim,double,1> point2 = {objOneDim2,objOneDim2.x};
         Point<OneDim,double,1> point3 = {objOneDim3,objOneDim3.x};
         Point<OneDim,double,1> point4 = {objOneDim4,objOneDim4.x};
-        std::shared_ptr<Node<OneDim,double,1,SquaredDist> > node = std::make_shared<Node<OneDim,double,1,SquaredDist> >(std::vector<Point<OneDim,double,1> >{point1,point2,point3,point4},nullptr,0,2);
+        NodeArray<OneDim,double,1,SquaredDist> nodes(std::vector<Point<OneDim,double,1> >{point1,point2,point3,point4},2);
         
-        CHECK(node->GetRightNode()->size() == 2); // node has two points
-        auto remove_point2 = deleter.Remove(node,point3);
+        CHECK(nodes[Descend(nodes,"R")].size() == 2); // node has two points
+        auto remove_point2 = deleter.Remove(nodes,0,point3);
         REQUIRE(remove_point2.has_value()); // remove x = 7
         REQUIRE(remove_point2.value() == point3);
-        REQUIRE(node->GetRightNode()->size() == 1); // node has one point left
+        REQUIRE(nodes[Descend(nodes,"R")].size() == 1); // node has one point left
     }
 
     SECTION("Deleter deletes an element and causes the parent node to join")
     {
         Point<OneDim,double,1> point1 = {objOneDim1,objOneDim1.x};
         Point<OneDim,double,1> point2 = {objOneDim2,objOneDim2.x};
-        std::shared_ptr<Node<OneDim,double,1,SquaredDist> > node = std::make_shared<Node<OneDim,double,1,SquaredDist> >(std::vector<Point<OneDim,double,1> >{point1,point2},nullptr,0,1);
+        NodeArray<OneDim,double,1,SquaredDist> nodes(std::vector<Point<OneDim,double,1> >{point1,point2},1);
         
-        CHECK(node->IsSplit());
+        CHECK(nodes[0].IsSplit());
 
-        auto removed_point1 = deleter.Remove(node,point1);
+        auto removed_point1 = deleter.Remove(nodes,0,point1);
         CHECK(removed_point1.has_value()); // remove x = 1
         CHECK(removed_point1.value() == point1);
 
-        REQUIRE_FALSE(node->IsSplit());
+        REQUIRE_FALSE(nodes[0].IsSplit());
     }
 }
 
@@ -190,29 +192,26 @@ TEST_CASE("NearestFinder class tests","[node][point][distance][action]")
     Point<OneDim,double,1> point7 = {objOneDim7,objOneDim7.x};
     Point<OneDim,double,1> point8 = {objOneDim8,objOneDim8.x};
 
-    std::shared_ptr<Node<OneDim,double,1,SquaredDist> > node = std::make_shared<Node<OneDim,double,1,SquaredDist> >(
-        std::vector<Point<OneDim,double,1> >{point1,point2,point3,point4,point5,point6,point7,point8},
-        nullptr,
-        0,
-        1);
-
-    REQUIRE(node->IsEmpty());
-    REQUIRE(node->IsSplit());
-    REQUIRE(node->GetLeftNode()->GetLeftNode()->GetLeftNode()->GetData().at(0) == point1);
-    REQUIRE(node->GetLeftNode()->GetLeftNode()->GetRightNode()->GetData().at(0) == point2);
-    REQUIRE(node->GetLeftNode()->GetRightNode()->GetLeftNode()->GetData().at(0) == point3);
-    REQUIRE(node->GetLeftNode()->GetRightNode()->GetRightNode()->GetData().at(0) == point4);
-    REQUIRE(node->GetRightNode()->GetLeftNode()->GetLeftNode()->GetData().at(0) == point5);
-    REQUIRE(node->GetRightNode()->GetLeftNode()->GetRightNode()->GetData().at(0) == point6);
-    REQUIRE(node->GetRightNode()->GetRightNode()->GetLeftNode()->GetData().at(0) == point7);
-    REQUIRE(node->GetRightNode()->GetRightNode()->GetRightNode()->GetData().at(0) == point8);
+    NodeArray<OneDim,double,1,SquaredDist> nodes(std::vector<Point<OneDim,double,1> >{point1,point2,point3,point4,point5,point6,point7,point8},1);
+
+    REQUIRE(nodes[0].IsEmpty());
+    REQUIRE(nodes[0].IsSplit());
+    REQUIRE(nodes[Descend(nodes,"LLL")].GetData().at(0) == point1);
+    REQUIRE(nodes[Descend(nodes,"LLR")].GetData().at(0) == point2);
+    REQUIRE(nodes[Descend(nodes,"LRL")].GetData().at(0) == point3);
+    REQUIRE(nodes[Descend(nodes,"LRR")].GetData().at(0) == point4);
+    REQUIRE(nodes[Descend(nodes,"RLL")].GetData().at(0) == point5);
+    REQUIRE(nodes[Descend(nodes,"RLR")].GetData().at(0) == point6);
+    REQUIRE(nodes[Descend(nodes,"RRL")].GetData().at(0) == point7);
+    REQUIRE(nodes[Descend(nodes,"RRR")].GetData().at(0) == point8);
 
     JJDataStruct::KDTree::NearestFinder<OneDim,double,1,SquaredDist> finder;
 
-    SECTION("Finder throws an exception if the node is a null pointer")
+    SECTION("Finder throws an exception if the node index is out of range")
     {
+        NodeArray<OneDim,double,1,SquaredDist> emptyNodes(1); // array without even a root node
         Point<OneDim,double,1> newPointOneDim = {objOneDim1,objOneDim1.x};
-        REQUIRE_THROWS(finder.Find(nullptr,newPointOneDim));
+        REQUIRE_THROWS(finder.Find(emptyNodes,0,newPointOneDim));
     }
 
     SECTION("Finder goes to a node with the closest point")
@@ -220,7 +219,7 @@ TEST_CASE("NearestFinder class tests","[node][point][distance][action]")
         OneDim newObjOneDim{9,5};
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto closestPoint = finder.Find(node,newPointOneDim);
+        auto closestPoint = finder.Find(nodes,0,newPointOneDim);
         CHECK(closestPoint.has_value()); // make sure that we found a point
 
         REQUIRE(closestPoint.value() == point2); // the point we found is x = 4
@@ -228,13 +227,13 @@ TEST_CASE("NearestFinder class tests","[node][point][distance][action]")
 
     SECTION("Finder goes to a node where the closest point should be, but it has been removed")
     {
-        CHECK(node->GetLeftNode()->GetLeftNode()->GetRightNode()->RemovePoint(point2).has_value()); // we remove the closest point
-        CHECK(node->GetLeftNode()->GetLeftNode()->GetRightNode()->IsEmpty());
+        CHECK(nodes[Descend(nodes,"LLR")].RemovePoint(point2).has_value()); // we remove the closest point
+        CHECK(nodes[Descend(nodes,"LLR")].IsEmpty());
 
         OneDim newObjOneDim{9,5};
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto closestPoint = finder.Find(node,newPointOneDim);
+        auto closestPoint = finder.Find(nodes,0,newPointOneDim);
         CHECK(closestPoint.has_value()); // make sure that we found a point
 
         REQUIRE(closestPoint.value() == point3); // the point we found is x = 7
@@ -245,7 +244,7 @@ TEST_CASE("NearestFinder class tests","[node][point][distance][action]")
         OneDim newObjOneDim{9,5.5};
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto closestPoint = finder.Find(node,newPointOneDim);
+        auto closestPoint = finder.Find(nodes,0,newPointOneDim);
         CHECK(closestPoint.has_value()); // make sure that we found a point
 
         CHECK_THAT(std::abs(SquaredDist::distance(newPointOneDim,point2) - SquaredDist::distance(newPointOneDim,point3)), Catch::Matchers::WithinRel(double())); // check if the two points are approx. within the same distance
@@ -255,7 +254,7 @@ TEST_CASE("NearestFinder class tests","[node][point][distance][action]")
 
     SECTION("Returns actual closest point because Cond is true")
     {
-        auto closestPoint = finder.FindIf(node,point2,[](const Point<OneDim,double,1> &lhs, const Point<OneDim,double,1> &rhs){return lhs == rhs;});
+        auto closestPoint = finder.FindIf(nodes,0,point2,[](const Point<OneDim,double,1> &lhs, const Point<OneDim,double,1> &rhs){return lhs == rhs;});
         CHECK(closestPoint.has_value()); // make sure that we found a point
 
         REQUIRE(closestPoint.value() == point2); // the point we found is x = 4
@@ -263,11 +262,25 @@ TEST_CASE("NearestFinder class tests","[node][point][distance][action]")
 
     SECTION("Returns second closest point because Cond is false")
     {
-        auto closestPoint = finder.FindIf(node,point2,[](const Point<OneDim,double,1> &lhs, const Point<OneDim,double,1> &rhs){return lhs != rhs;});
+        auto closestPoint = finder.FindIf(nodes,0,point2,[](const Point<OneDim,double,1> &lhs, const Point<OneDim,double,1> &rhs){return lhs != rhs;});
         CHECK(closestPoint.has_value()); // make sure that we found a point
 
         REQUIRE(closestPoint.value() == point1); // the point we found is x = 1
     }
+
+    SECTION("Searching does not reorder the points stored in a node")
+    {
+        const NodeArray<OneDim,double,1,SquaredDist> bigBucket(std::vector<Point<OneDim,double,1> >{point8,point1,point5,point3,point7,point2},10); // everything stays in the root node
+        const auto dataBefore = bigBucket[0].GetData();
+
+        auto closestPoint = finder.Find(bigBucket,0,point4);
+        auto nClosestPoints = JJDataStruct::KDTree::NNearestFinder<OneDim,double,1,SquaredDist>().Find(bigBucket,0,point4,3);
+
+        CHECK(closestPoint.value() == point3); // the point we found is x = 7
+        CHECK(nClosestPoints.size() == 3);
+
+        REQUIRE(bigBucket[0].GetData() == dataBefore);
+    }
 }
 
 TEST_CASE("NNearestFinder class tests","[node][point][distance][action]")
@@ -281,30 +294,27 @@ TEST_CASE("NNearestFinder class tests","[node][point][distance][action]")
     Point<OneDim,double,1> point7 = {objOneDim7,objOneDim7.x};
     Point<OneDim,double,1> point8 = {objOneDim8,objOneDim8.x};
 
-    std::shared_ptr<Node<OneDim,double,1,SquaredDist> > node = std::make_shared<Node<OneDim,double,1,SquaredDist> >(
-        std::vector<Point<OneDim,double,1> >{point1,point2,point3,point4,point5,point6,point7,point8},
-        nullptr,
-        0,
-        1);
-
-    REQUIRE(node->IsEmpty());
-    REQUIRE(node->IsSplit());
-    REQUIRE(node->GetLeftNode()->GetLeftNode()->GetLeftNode()->GetData().at(0) == point1); // x = 1
-    REQUIRE(node->GetLeftNode()->GetLeftNode()->GetRightNode()->GetData().at(0) == point2); // x = 4
-    REQUIRE(node->GetLeftNode()->GetRightNode()->GetLeftNode()->GetData().at(0) == point3); // x = 7
-    REQUIRE(node->GetLeftNode()->GetRightNode()->GetRightNode()->GetData().at(0) == point4); // x = 8
-    REQUIRE(node->GetRightNode()->GetLeftNode()->GetLeftNode()->GetData().at(0) == point5); // x = 12
-    REQUIRE(node->GetRightNode()->GetLeftNode()->GetRightNode()->GetData().at(0) == point6); // x = 14
-    REQUIRE(node->GetRightNode()->GetRightNode()->GetLeftNode()->GetData().at(0) == point7); // x = 17
-    REQUIRE(node->GetRightNode()->GetRightNode()->GetRightNode()->GetData().at(0) == point8); // x = 18
+    NodeArray<OneDim,double,1,SquaredDist> nodes(std::vector<Point<OneDim,double,1> >{point1,point2,point3,point4,point5,point6,point7,point8},1);
+
+    REQUIRE(nodes[0].IsEmpty());
+    REQUIRE(nodes[0].IsSplit());
+    REQUIRE(nodes[Descend(nodes,"LLL")].GetData().at(0) == point1); // x = 1
+    REQUIRE(nodes[Descend(nodes,"LLR")].GetData().at(0) == point2); // x = 4
+    REQUIRE(nodes[Descend(nodes,"LRL")].GetData().at(0) == point3); // x = 7
+    REQUIRE(nodes[Descend(nodes,"LRR")].GetData().at(0) == point4); // x = 8
+    REQUIRE(nodes[Descend(nodes,"RLL")].GetData().at(0) == point5); // x = 12
+    REQUIRE(nodes[Descend(nodes,"RLR")].GetData().at(0) == point6); // x = 14
+    REQUIRE(nodes[Descend(nodes,"RRL")].GetData().at(0) == point7); // x = 17
+    REQUIRE(nodes[Descend(nodes,"RRR")].GetData().at(0) == point8); // x = 18
 
     JJDataStruct::KDTree::NearestFinder<OneDim,double,1,SquaredDist> finder;
     JJDataStruct::KDTree::NNearestFinder<OneDim,double,1,SquaredDist> nFinder;
 
-    SECTION("Finder throws an exception if the node is a null pointer")
+    SECTION("Finder throws an exception if the node index is out of range")
     {
+        NodeArray<OneDim,double,1,SquaredDist> emptyNodes(1); // array without even a root node
         Point<OneDim,double,1> newPointOneDim = {objOneDim1,objOneDim1.x};
-        REQUIRE_THROWS(nFinder.Find(nullptr,newPointOneDim,1));
+        REQUIRE_THROWS(nFinder.Find(emptyNodes,0,newPointOneDim,1));
     }
 
     SECTION("Finder goes to a node with the closest point")
@@ -312,8 +322,8 @@ TEST_CASE("NNearestFinder class tests","[node][point][distance][action]")
         OneDim newObjOneDim{9,5};
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto closestPoint = finder.Find(node,newPointOneDim);
-        auto nClosestPoints = nFinder.Find(node,newPointOneDim,1);
+        auto closestPoint = finder.Find(nodes,0,newPointOneDim);
+        auto nClosestPoints = nFinder.Find(nodes,0,newPointOneDim,1);
 
         CHECK(closestPoint.has_value()); // make sure that we found a point
         CHECK(nClosestPoints.size() == 1);
@@ -322,10 +332,28 @@ TEST_CASE("NNearestFinder class tests","[node][point][distance][action]")
         REQUIRE(nClosestPoints.at(0) == closestPoint.value()); // finders are consistent
     }
 
+    SECTION("Finder returns N closest points sorted by distance")
+    {
+        OneDim newObjOneDim{9,9};
+        Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
+
+        auto nClosestPoints = nFinder.Find(nodes,0,newPointOneDim,3);
+
+        REQUIRE(nClosestPoints.size() == 3);
+        CHECK(nClosestPoints.at(0) == point4); // x = 8
+        CHECK(nClosestPoints.at(1) == point3); // x = 7
+        CHECK(nClosestPoints.at(2) == point5); // x = 12
+
+        nClosestPoints = nFinder.Find(nodes,0,newPointOneDim,100); // more than there is in the tree
+
+        REQUIRE(nClosestPoints.size() == 8);
+        CHECK(nClosestPoints.back() == point8); // x = 18
+    }
+
     SECTION("FindIf for 1 point works the same as NearestFinder")
     {
-        auto closestPoint = finder.FindIf(node,point2,[](const Point<OneDim,double,1> &lhs, const Point<OneDim,double,1> &rhs){return lhs == rhs;});
-        auto nClosestPoints = nFinder.FindIf(node,point2,1,[](const Point<OneDim,double,1> &lhs, const Point<OneDim,double,1> &rhs){return lhs == rhs;});
+        auto closestPoint = finder.FindIf(nodes,0,point2,[](const Point<OneDim,double,1> &lhs, const Point<OneDim,double,1> &rhs){return lhs == rhs;});
+        auto nClosestPoints = nFinder.FindIf(nodes,0,point2,1,[](const Point<OneDim,double,1> &lhs, const Point<OneDim,double,1> &rhs){return lhs == rhs;});
 
         CHECK(closestPoint.has_value()); // make sure that we found a point
         CHECK(nClosestPoints.size() == 1);
@@ -336,14 +364,14 @@ TEST_CASE("NNearestFinder class tests","[node][point][distance][action]")
 
     SECTION("Finder goes to a node where the closest point should be, but it has been removed")
     {
-        CHECK(node->GetLeftNode()->GetLeftNode()->GetRightNode()->RemovePoint(point2).has_value()); // we remove the closest point
-        CHECK(node->GetLeftNode()->GetLeftNode()->GetRightNode()->IsEmpty());
+        CHECK(nodes[Descend(nodes,"LLR")].RemovePoint(point2).has_value()); // we remove the closest point
+        CHECK(nodes[Descend(nodes,"LLR")].IsEmpty());
 
         OneDim newObjOneDim{9,5};
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto closestPoint = finder.Find(node,newPointOneDim);
-        auto nClosestPoints = nFinder.Find(node,newPointOneDim,1);
+        auto closestPoint = finder.Find(nodes,0,newPointOneDim);
+        auto nClosestPoints = nFinder.Find(nodes,0,newPointOneDim,1);
 
         CHECK(closestPoint.has_value()); // make sure that we found a point
         CHECK(nClosestPoints.size() == 1);
@@ -357,8 +385,8 @@ TEST_CASE("NNearestFinder class tests","[node][point][distance][action]")
         OneDim newObjOneDim{9,5.5};
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto closestPoint = finder.Find(node,newPointOneDim);
-        auto nClosestPoints = nFinder.Find(node,newPointOneDim,1);
+        auto closestPoint = finder.Find(nodes,0,newPointOneDim);
+        auto nClosestPoints = nFinder.Find(nodes,0,newPointOneDim,1);
 
         CHECK(closestPoint.has_value()); // make sure that we found a point
         CHECK(nClosestPoints.size() == 1);
@@ -374,7 +402,7 @@ TEST_CASE("NNearestFinder class tests","[node][point][distance][action]")
         OneDim newObjOneDim{9,5.5};
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto nClosestPoints = nFinder.Find(node,newPointOneDim,2);
+        auto nClosestPoints = nFinder.Find(nodes,0,newPointOneDim,2);
         CHECK(nClosestPoints.size() == 2); // make sure that we found two points
 
         REQUIRE(nClosestPoints.at(0) == point2); // the first point we found is x = 4
@@ -386,7 +414,7 @@ TEST_CASE("NNearestFinder class tests","[node][point][distance][action]")
         OneDim newObjOneDim{9,5.5};
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto nClosestPoints = nFinder.Find(node,newPointOneDim,3);
+        auto nClosestPoints = nFinder.Find(nodes,0,newPointOneDim,3);
         CHECK(nClosestPoints.size() == 3); // make sure that we found three points
 
         REQUIRE(nClosestPoints.at(0) == point2); // the first point we found is x = 4
@@ -399,7 +427,7 @@ TEST_CASE("NNearestFinder class tests","[node][point][distance][action]")
         OneDim newObjOneDim{9,5.5}; // has the same ID as point2, in order to remove it
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto nClosestPoints = nFinder.FindIf(node,newPointOneDim,3,[](const Point<OneDim,double,1> &lhs, const Point<OneDim,double,1> &rhs){return true;});
+        auto nClosestPoints = nFinder.FindIf(nodes,0,newPointOneDim,3,[](const Point<OneDim,double,1> &lhs, const Point<OneDim,double,1> &rhs){return true;});
         CHECK(nClosestPoints.size() == 3); // make sure that we found three points
 
         REQUIRE(nClosestPoints.at(0) == point2); // the first point we found is x = 4
@@ -412,7 +440,7 @@ TEST_CASE("NNearestFinder class tests","[node][point][distance][action]")
         OneDim newObjOneDim{objOneDim2.id,5.5}; // has the same ID as point2, in order to remove it
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto nClosestPoints = nFinder.FindIf(node,newPointOneDim,3,[](const Point<OneDim,double,1> &lhs, const Point<OneDim,double,1> &rhs){return lhs != rhs;});
+        auto nClosestPoints = nFinder.FindIf(nodes,0,newPointOneDim,3,[](const Point<OneDim,double,1> &lhs, const Point<OneDim,double,1> &rhs){return lhs != rhs;});
         CHECK(nClosestPoints.size() == 3); // make sure that we found three points
 
         REQUIRE(nClosestPoints.at(0) == point3); // the first point we found is x = 7 and not x = 4 as before
@@ -432,29 +460,26 @@ TEST_CASE("DistanceFinder class tests","[node][point][distance][action]")
     Point<OneDim,double,1> point7 = {objOneDim7,objOneDim7.x};
     Point<OneDim,double,1> point8 = {objOneDim8,objOneDim8.x};
 
-    std::shared_ptr<Node<OneDim,double,1,SquaredDist> > node = std::make_shared<Node<OneDim,double,1,SquaredDist> >(
-        std::vector<Point<OneDim,double,1> >{point1,point2,point3,point4,point5,point6,point7,point8},
-        nullptr,
-        0,
-        1);
-
-    REQUIRE(node->IsEmpty());
-    REQUIRE(node->IsSplit());
-    REQUIRE(node->GetLeftNode()->GetLeftNode()->GetLeftNode()->GetData().at(0) == point1); // x = 1
-    REQUIRE(node->GetLeftNode()->GetLeftNode()->GetRightNode()->GetData().at(0) == point2); // x = 4
-    REQUIRE(node->GetLeftNode()->GetRightNode()->GetLeftNode()->GetData().at(0) == point3); // x = 7
-    REQUIRE(node->GetLeftNode()->GetRightNode()->GetRightNode()->GetData().at(0) == point4); // x = 8
-    REQUIRE(node->GetRightNode()->GetLeftNode()->GetLeftNode()->GetData().at(0) == point5); // x = 12
-    REQUIRE(node->GetRightNode()->GetLeftNode()->GetRightNode()->GetData().at(0) == point6); // x = 14
-    REQUIRE(node->GetRightNode()->GetRightNode()->GetLeftNode()->GetData().at(0) == point7); // x = 17
-    REQUIRE(node->GetRightNode()->GetRightNode()->GetRightNode()->GetData().at(0) == point8); // x = 18
+    NodeArray<OneDim,double,1,SquaredDist> nodes(std::vector<Point<OneDim,double,1> >{point1,point2,point3,point4,point5,point6,point7,point8},1);
+
+    REQUIRE(nodes[0].IsEmpty());
+    REQUIRE(nodes[0].IsSplit());
+    REQUIRE(nodes[Descend(nodes,"LLL")].GetData().at(0) == point1); // x = 1
+    REQUIRE(nodes[Descend(nodes,"LLR")].GetData().at(0) == point2); // x = 4
+    REQUIRE(nodes[Descend(nodes,"LRL")].GetData().at(0) == point3); // x = 7
+    REQUIRE(nodes[Descend(nodes,"LRR")].GetData().at(0) == point4); // x = 8
+    REQUIRE(nodes[Descend(nodes,"RLL")].GetData().at(0) == point5); // x = 12
+    REQUIRE(nodes[Descend(nodes,"RLR")].GetData().at(0) == point6); // x = 14
+    REQUIRE(nodes[Descend(nodes,"RRL")].GetData().at(0) == point7); // x = 17
+    REQUIRE(nodes[Descend(nodes,"RRR")].GetData().at(0) == point8); // x = 18
 
     JJDataStruct::KDTree::DistanceFinder<OneDim,double,1,SquaredDist> distFinder;
 
-    SECTION("Finder throws an exception if the node is a null pointer")
+    SECTION("Finder throws an exception if the node index is out of range")
     {
+        NodeArray<OneDim,double,1,SquaredDist> emptyNodes(1); // array without even a root node
         Point<OneDim,double,1> newPointOneDim = {objOneDim1,objOneDim1.x};
-        REQUIRE_THROWS(distFinder.Find(nullptr,newPointOneDim,1));
+        REQUIRE_THROWS(distFinder.Find(emptyNodes,0,newPointOneDim,1));
     }
 
     SECTION("Finder returns a point that is well within the hypersphere")
@@ -462,7 +487,7 @@ TEST_CASE("DistanceFinder class tests","[node][point][distance][action]")
         OneDim newObjOneDim{9,5};
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto closestPoints = distFinder.Find(node,newPointOneDim,2);
+        auto closestPoints = distFinder.Find(nodes,0,newPointOneDim,2);
 
         CHECK_FALSE(closestPoints.empty()); // make sure that we found a point
         CHECK(closestPoints.size() == 1);
@@ -475,7 +500,7 @@ TEST_CASE("DistanceFinder class tests","[node][point][distance][action]")
         OneDim newObjOneDim{9,5};
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto closestPoints = distFinder.Find(node,newPointOneDim,1);
+        auto closestPoints = distFinder.Find(nodes,0,newPointOneDim,1);
 
         CHECK_FALSE(closestPoints.empty()); // make sure that we found a point
         CHECK(closestPoints.size() == 1);
@@ -485,13 +510,13 @@ TEST_CASE("DistanceFinder class tests","[node][point][distance][action]")
 
     SECTION("Finder returns empty vector if no point was within distance (point within distance was removed)")
     {
-        CHECK(node->GetLeftNode()->GetLeftNode()->GetRightNode()->RemovePoint(point2).has_value()); // we remove the closest point
-        CHECK(node->GetLeftNode()->GetLeftNode()->GetRightNode()->IsEmpty());
+        CHECK(nodes[Descend(nodes,"LLR")].RemovePoint(point2).has_value()); // we remove the closest point
+        CHECK(nodes[Descend(nodes,"LLR")].IsEmpty());
 
         OneDim newObjOneDim{9,5};
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto closestPoints = distFinder.Find(node,newPointOneDim,2);
+        auto closestPoints = distFinder.Find(nodes,0,newPointOneDim,2);
 
         REQUIRE(closestPoints.empty()); // no point was found
         REQUIRE(closestPoints.size() == 0);
@@ -502,7 +527,7 @@ TEST_CASE("DistanceFinder class tests","[node][point][distance][action]")
         OneDim newObjOneDim{9,5};
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto closestPoints = distFinder.Find(node,newPointOneDim,0.5);
+        auto closestPoints = distFinder.Find(nodes,0,newPointOneDim,0.5);
 
         REQUIRE(closestPoints.empty()); // no point was found
         REQUIRE(closestPoints.size() == 0);
@@ -513,7 +538,7 @@ TEST_CASE("DistanceFinder class tests","[node][point][distance][action]")
         OneDim newObjOneDim{9,13};
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto closestPoints = distFinder.Find(node,newPointOneDim,1);
+        auto closestPoints = distFinder.Find(nodes,0,newPointOneDim,1);
 
         CHECK(closestPoints.size() == 2);
 
@@ -528,7 +553,7 @@ TEST_CASE("DistanceFinder class tests","[node][point][distance][action]")
         OneDim newObjOneDim{9,10};
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto closestPoints = distFinder.Find(node,newPointOneDim,100);
+        auto closestPoints = distFinder.Find(nodes,0,newPointOneDim,100);
         CHECK(closestPoints.size() == 8); // make sure that we found all points
 
         std::sort(closestPoints.begin(),closestPoints.end(),
@@ -552,8 +577,8 @@ TEST_CASE("DistanceFinder class tests","[node][point][distance][action]")
         OneDim newObjOneDim{9,5};
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto closestPoints = distFinder.Find(node,newPointOneDim,2);
-        auto closestPointsCond = distFinder.FindIf(node,newPointOneDim,2,[](const Point<OneDim,double,1> &lhs, const Point<OneDim,double,1> &rhs){return true;});
+        auto closestPoints = distFinder.Find(nodes,0,newPointOneDim,2);
+        auto closestPointsCond = distFinder.FindIf(nodes,0,newPointOneDim,2,[](const Point<OneDim,double,1> &lhs, const Point<OneDim,double,1> &rhs){return true;});
 
         CHECK_FALSE(closestPoints.empty()); // make sure that we found a point
         CHECK(closestPoints.size() == 1);
@@ -569,7 +594,7 @@ TEST_CASE("DistanceFinder class tests","[node][point][distance][action]")
         OneDim newObjOneDim{objOneDim2.id,5}; // same ID as for point2
         Point<OneDim,double,1> newPointOneDim = {newObjOneDim,newObjOneDim.x};
 
-        auto closestPointsCond = distFinder.FindIf(node,newPointOneDim,2,[](const Point<OneDim,double,1> &lhs, const Point<OneDim,double,1> &rhs){return lhs != rhs;});
+        auto closestPointsCond = distFinder.FindIf(nodes,0,newPointOneDim,2,[](const Point<OneDim,double,1> &lhs, const Point<OneDim,double,1> &rhs){return lhs != rhs;});
 
         REQUIRE(closestPointsCond.empty());
     }
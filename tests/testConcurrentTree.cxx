@@ -0,0 +1,151 @@
+#include "testsHeader.hxx"
+#include "ConcurrentKDTree.hxx"
+
+#include <atomic>
+#include <random>
+#include <thread>
+
+// =====================================================================================================
+// ConcurrentKDTree class tests
+// =====================================================================================================
+
+template <typename Leaf, std::size_t Dims, typename T, typename Distance> using ConcurrentKDTree = JJDataStruct::KDTree::ConcurrentKDTree<Leaf,Dims,T,Distance>;
+
+TEST_CASE("ConcurrentKDTree class test","[kdtree][concurrent]")
+{
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<double> coord(0.,10.);
+    std::vector<Point<Event,double,3> > points;
+    for (std::size_t i = 0; i < 1000; ++i)
+    {
+        Event evt{i,coord(gen),coord(gen),coord(gen)};
+        points.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+    }
+
+    ConcurrentKDTree<Event,3,double,SquaredDist> tree(8);
+    tree.BuildTree(points.begin(),points.end());
+
+    REQUIRE(tree.IsSplit() == true);
+    REQUIRE(tree.size() == 1000);
+
+    SECTION("Modifications are visible to the readers")
+    {
+        Event evt{5000,20.,20.,20.};
+        Point<Event,double,3> farPoint = {evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}};
+
+        REQUIRE(tree.AddPoint(farPoint));
+        REQUIRE(tree.size() == 1001);
+        REQUIRE(tree.FindNearest(farPoint).value() == farPoint);
+
+        REQUIRE(tree.RemovePoint(farPoint).has_value());
+        REQUIRE(tree.size() == 1000);
+        REQUIRE_FALSE(tree.FindNearest(farPoint).value() == farPoint);
+        REQUIRE_FALSE(tree.RemovePoint(farPoint).has_value());
+    }
+
+    SECTION("Readers see a consistent tree while a writer modifies it")
+    {
+        std::atomic<bool> writerDone{false};
+        std::atomic<std::size_t> nErrors{0};
+
+        std::thread writer([&]()
+        {
+            for (std::size_t i = 0; i < 300; ++i)
+            {
+                Event evt{10000 + i,20. + coord(gen),20. + coord(gen),20. + coord(gen)}; // far away from the points the readers look for
+                Point<Event,double,3> newPoint = {evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}};
+                tree.AddPoint(newPoint);
+                if (i % 2 == 0)
+                    tree.RemovePoint(newPoint);
+            }
+            writerDone = true;
+        });
+
+        std::vector<std::thread> readers;
+        for (std::size_t reader = 0; reader < 3; ++reader)
+        {
+            readers.emplace_back([&,reader]()
+            {
+                std::size_t query = reader;
+                do
+                {
+                    const auto &pt = points.at(query % points.size());
+                    if (!(tree.FindNearest(pt).value() == pt) || tree.FindWithinDistance(pt,0.).size() != 1)
+                        ++nErrors;
+                    query += 7;
+                } while (!writerDone);
+            });
+        }
+
+        writer.join();
+        for (auto &reader : readers)
+            reader.join();
+
+        REQUIRE(nErrors == 0);
+        REQUIRE(tree.size() == 1150);
+    }
+}
+
+// object whose copy throws once the countdown reaches zero, like a bad_alloc in the middle of a write
+struct Fragile
+{
+    static inline int copiesLeft = -1; // negative for no failure
+
+    std::size_t id;
+    Fragile(std::size_t i) : id(i) {}
+    Fragile(const Fragile &other) : id(other.id)
+    {
+        if (copiesLeft == 0)
+        {
+            copiesLeft = -1;
+            throw std::bad_alloc();
+        }
+        else if (copiesLeft > 0)
+        {
+            --copiesLeft;
+        }
+    }
+    Fragile(Fragile&&) = default;
+    Fragile& operator=(const Fragile&) = default;
+    Fragile& operator=(Fragile&&) = default;
+    [[nodiscard]] bool operator==(const Fragile &other) const noexcept {return (id == other.id);}
+};
+
+TEST_CASE("ConcurrentKDTree failing writes test","[kdtree][concurrent]")
+{
+    std::vector<Point<Fragile,double,2> > points;
+    for (std::size_t i = 0; i < 100; ++i)
+        points.push_back({Fragile(i),{static_cast<double>(i % 10),static_cast<double>(i / 10)}});
+
+    ConcurrentKDTree<Fragile,2,double,SquaredDist> tree(4);
+    tree.BuildTree(points.begin(),points.end());
+    REQUIRE(tree.size() == 100);
+
+    // both copies of the tree are published in turn by the following writes, so each of them is checked
+    auto requireSize = [&tree](std::size_t size)
+    {
+        for (std::size_t i = 0; i < 2; ++i)
+        {
+            REQUIRE(tree.size() == size);
+            tree.SplitTree();
+        }
+    };
+
+    SECTION("A write failing on the first copy is not published")
+    {
+        Fragile::copiesLeft = 0;
+        REQUIRE_THROWS_AS(tree.AddPoint({Fragile(1000),{20.,20.}}),std::bad_alloc);
+        requireSize(100);
+        REQUIRE(tree.AddPoint({Fragile(1001),{21.,21.}}));
+        requireSize(101);
+    }
+
+    SECTION("A write failing on the second copy is published on both")
+    {
+        Fragile::copiesLeft = 1;
+        REQUIRE(tree.AddPoint({Fragile(1000),{20.,20.}}));
+        requireSize(101);
+        REQUIRE(tree.RemovePoint({Fragile(1000),{20.,20.}}).has_value());
+        requireSize(100);
+    }
+}
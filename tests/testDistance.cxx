@@ -1,5 +1,7 @@
 #include "testsHeader.hxx"
 
+#include <random>
+
 // =====================================================================================================
 // Distance class tests
 // =====================================================================================================
@@ -24,4 +26,126 @@ TEST_CASE("Distance class tests","[distance]")
         REQUIRE_THAT(SquaredDist::distance(point1,point2), Catch::Matchers::WithinRel(SquaredDist::distance(point2,point1)));
         REQUIRE_THAT(RootSquaredDist::distance(point1,point2), Catch::Matchers::WithinRel(RootSquaredDist::distance(point2,point1)));
     }
-}
\ No newline at end of file
+}
+struct CopyCounter
+{
+    static inline std::size_t nCopies = 0;
+    std::size_t id;
+
+    CopyCounter(std::size_t newId) : id(newId) {}
+    CopyCounter(const CopyCounter &other) : id(other.id) {++nCopies;}
+    [[nodiscard]] bool operator==(const CopyCounter &other) const noexcept {return (id == other.id);}
+};
+
+TEST_CASE("Metrics work on coordinates only","[distance]")
+{
+    std::array<double,3> coords1 = {0.0,0.0,0.0};
+    std::array<double,3> coords2 = {1.0,2.0,2.0};
+
+    SECTION("Coordinate arrays give the same distance as points")
+    {
+        REQUIRE_THAT(SquaredDist::distance(coords1,coords2), Catch::Matchers::WithinRel(double(9)));
+        REQUIRE_THAT(RootSquaredDist::distance(coords1,coords2), Catch::Matchers::WithinRel(double(3)));
+    }
+
+    SECTION("Axis distance is the distance to the splitting plane")
+    {
+        REQUIRE_THAT(SquaredDist::axisDistance(1.0,-2.0), Catch::Matchers::WithinRel(double(9)));
+        REQUIRE_THAT(RootSquaredDist::axisDistance(1.0,-2.0), Catch::Matchers::WithinRel(double(3)));
+        REQUIRE_THAT(RootSquaredDist::axisDistance(-2.0,1.0), Catch::Matchers::WithinRel(double(3)));
+    }
+
+    SECTION("Calculating a distance does not copy the stored objects")
+    {
+        Point<CopyCounter,double,3> point1 = {CopyCounter(1),coords1};
+        Point<CopyCounter,double,3> point2 = {CopyCounter(2),coords2};
+        const std::size_t nCopiesBefore = CopyCounter::nCopies;
+
+        CHECK_THAT(SquaredDist::distance(point1,point2), Catch::Matchers::WithinRel(double(9)));
+        CHECK_THAT(RootSquaredDist::distance(point1,point2), Catch::Matchers::WithinRel(double(3)));
+
+        REQUIRE(CopyCounter::nCopies == nCopiesBefore);
+    }
+
+    SECTION("Distance to a cell is updated one axis at a time")
+    {
+        using JJDataStruct::KDTree::RegionDistance;
+
+        // query at the origin, cell starting at x = 1 and y = 2; the cell is then moved to start at x = 2
+        REQUIRE_THAT(RegionDistance<SquaredDist>(SquaredDist::axisDistance(0.,1.) + SquaredDist::axisDistance(0.,2.),SquaredDist::axisDistance(0.,1.),SquaredDist::axisDistance(0.,2.)), Catch::Matchers::WithinRel(double(8)));
+        REQUIRE_THAT(RegionDistance<RootSquaredDist>(RootSquaredDist::distance(coords1,std::array<double,3>{1.,2.,0.}),RootSquaredDist::axisDistance(0.,1.),RootSquaredDist::axisDistance(0.,2.)), Catch::Matchers::WithinRel(std::sqrt(double(8))));
+        REQUIRE(RegionDistance<RootSquaredDist>(0.,0.,0.) == 0.);
+    }
+}
+
+TEMPLATE_TEST_CASE("Distance kernels tests","[distance][kernels]",float,double)
+{
+    namespace Kernels = JJDataStruct::KDTree::Kernels;
+
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<TestType> coord(-100,100);
+    std::vector<Point<int,TestType,3> > points;
+    for (int i = 0; i < 101; ++i)
+        points.push_back({i,{coord(gen),coord(gen),coord(gen)}});
+
+    Point<int,TestType,3> query = {-1,{coord(gen),coord(gen),coord(gen)}};
+
+    // the same coordinates laid out as points one after another (strided) and as separate arrays (contiguous)
+    constexpr std::size_t stride = sizeof(Point<int,TestType,3>) / sizeof(TestType);
+    std::array<const TestType*,3> stridedColumns = {&points[0].coords[0],&points[0].coords[1],&points[0].coords[2]};
+    std::array<std::vector<TestType>,3> soa;
+    for (const auto &pt : points)
+        for (std::size_t dim = 0; dim < 3; ++dim)
+            soa[dim].push_back(pt.coords[dim]);
+    std::array<const TestType*,3> contiguousColumns = {soa[0].data(),soa[1].data(),soa[2].data()};
+
+    std::vector<TestType> expected(points.size());
+    for (std::size_t i = 0; i < points.size(); ++i)
+        expected[i] = SquaredDist::distance(query,points[i]);
+
+    SECTION("Dispatched kernel gives the same distances as the scalar metric")
+    {
+        for (std::size_t count : {std::size_t(0),std::size_t(1),std::size_t(7),std::size_t(17),points.size()})
+        {
+            std::vector<TestType> strided(count), contiguous(count);
+            Kernels::SquaredDistances<TestType,3>(stridedColumns,stride,count,query.coords,strided.data());
+            Kernels::SquaredDistances<TestType,3>(contiguousColumns,1,count,query.coords,contiguous.data());
+
+            REQUIRE(std::equal(strided.begin(),strided.end(),expected.begin()));
+            REQUIRE(std::equal(contiguous.begin(),contiguous.end(),expected.begin()));
+        }
+    }
+
+#ifdef KDTREE_X86_KERNELS
+    SECTION("Every instruction set supported by the CPU gives the same distances")
+    {
+        std::vector<TestType> out(points.size());
+        auto check = [&](std::size_t done)
+        {
+            Kernels::SquaredDistancesScalar<TestType,3>(stridedColumns,stride,done,points.size(),query.coords,out.data());
+            REQUIRE(out == expected);
+        };
+
+        check(Kernels::SquaredDistancesSSE<3>(stridedColumns,stride,points.size(),query.coords,out.data()));
+        if (__builtin_cpu_supports("avx2"))
+            check(Kernels::SquaredDistancesAVX2<3>(stridedColumns,stride,points.size(),query.coords,out.data()));
+        if (__builtin_cpu_supports("avx512f"))
+            check(Kernels::SquaredDistancesAVX512<3>(stridedColumns,stride,points.size(),query.coords,out.data()));
+    }
+#endif
+
+    SECTION("Metrics with batched distances are used in leaf scans")
+    {
+        STATIC_REQUIRE(JJDataStruct::KDTree::HasBatchDistance<SquaredDist,TestType,3>::value);
+        STATIC_REQUIRE(JJDataStruct::KDTree::HasBatchDistance<RootSquaredDist,TestType,3>::value);
+
+        NodeArray<int,TestType,3,RootSquaredDist> nodes(std::vector<Point<int,TestType,3> >(points),1000); // everything stays in the root node
+        std::size_t nVisited = 0;
+        nodes[0].ForEachDistance(query,[&](std::size_t i, TestType dist)
+        {
+            CHECK(i == nVisited++);
+            CHECK(dist == RootSquaredDist::distance(query,points.at(i)));
+        });
+        REQUIRE(nVisited == points.size());
+    }
+}
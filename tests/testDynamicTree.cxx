@@ -0,0 +1,90 @@
+#include "testsHeader.hxx"
+#include "DynamicKDTree.hxx"
+
+#include <random>
+
+// =====================================================================================================
+// DynamicKDTree class tests
+// =====================================================================================================
+
+template <typename Leaf, std::size_t Dims, typename T, typename Distance> using DynamicKDTree = JJDataStruct::KDTree::DynamicKDTree<Leaf,Dims,T,Distance>;
+
+TEST_CASE("DynamicKDTree class test","[kdtree][dynamic]")
+{
+    std::mt19937 gen(29);
+    std::uniform_real_distribution<double> coord(-10.,10.);
+    std::vector<Point<Event,double,3> > points, queries;
+    for (std::size_t i = 0; i < 1500; ++i)
+    {
+        Event evt{i,coord(gen),coord(gen),coord(gen)};
+        points.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+    }
+    for (std::size_t i = 0; i < 50; ++i)
+    {
+        Event evt{10000 + i,coord(gen),coord(gen),coord(gen)};
+        queries.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+    }
+
+    SECTION("Levels hold at most bucketSize * 2^level points")
+    {
+        DynamicKDTree<Event,3,double,SquaredDist> tree(4);
+        for (const auto &point : points)
+            REQUIRE(tree.AddPoint(point));
+
+        REQUIRE(tree.size() == points.size());
+        std::size_t nPoints = 0;
+        for (std::size_t level = 0; level < tree.GetLevels().size(); ++level)
+        {
+            const auto &nodes = tree.GetLevels().at(level);
+            const std::size_t levelSize = (nodes.IsEmpty()) ? 0 : nodes[0].GetSubtreeSize();
+            CHECK(levelSize <= (std::size_t(4) << level));
+            nPoints += levelSize;
+        }
+        REQUIRE(nPoints == points.size());
+        REQUIRE(tree.GetLevels().size() <= 10);
+    }
+
+    SECTION("Forest gives the same results as a single tree")
+    {
+        DynamicKDTree<Event,3,double,SquaredDist> dynamic(4);
+        for (const auto &point : points)
+            dynamic.AddPoint(point);
+        KDTree<Event,3,double,SquaredDist> tree(4,points.begin(),points.end());
+
+        // removing some points leaves partly filled levels behind
+        for (std::size_t i = 0; i < points.size(); i += 3)
+        {
+            REQUIRE(dynamic.RemovePoint(points.at(i)).value() == points.at(i));
+            REQUIRE(tree.RemovePoint(points.at(i)).has_value());
+        }
+        REQUIRE(dynamic.RemovePoint(points.at(0)).has_value() == false);
+        REQUIRE(dynamic.size() == 1000);
+
+        for (const auto &query : queries)
+        {
+            CHECK(dynamic.FindNearest(query).value() == tree.FindNearest(query).value());
+
+            auto dynamicNNearest = dynamic.FindNNearest(query,7);
+            auto nNearest = tree.FindNNearest(query,7);
+            CHECK(std::equal(dynamicNNearest.begin(),dynamicNNearest.end(),nNearest.begin(),nNearest.end()));
+
+            auto dynamicWithin = dynamic.FindWithinDistance(query,6.);
+            auto within = tree.FindWithinDistance(query,6.);
+            auto byId = [](const Point<Event,double,3> &p1, const Point<Event,double,3> &p2){return p1.object.id < p2.object.id;};
+            std::sort(dynamicWithin.begin(),dynamicWithin.end(),byId);
+            std::sort(within.begin(),within.end(),byId);
+            CHECK(std::equal(dynamicWithin.begin(),dynamicWithin.end(),within.begin(),within.end()));
+        }
+    }
+
+    SECTION("Forest built from a range of points")
+    {
+        DynamicKDTree<Event,3,double,SquaredDist> tree(8,points.begin(),points.end());
+        REQUIRE(tree.size() == points.size());
+        REQUIRE(tree.FindNearest(points.at(42)).value() == points.at(42));
+
+        DynamicKDTree<Event,3,double,SquaredDist> empty(8);
+        REQUIRE(empty.FindNearest(points.front()).has_value() == false);
+        REQUIRE(empty.FindNNearest(points.front(),3).empty());
+    }
+}
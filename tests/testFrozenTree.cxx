@@ -0,0 +1,268 @@
+#include "testsHeader.hxx"
+#include "FrozenKDTree.hxx"
+#include "OutOfCoreBuilder.hxx"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+// =====================================================================================================
+// FrozenKDTree class tests
+// =====================================================================================================
+
+template <typename Leaf, std::size_t Dims, typename T, typename Distance> using FrozenKDTree = JJDataStruct::KDTree::FrozenKDTree<Leaf,Dims,T,Distance>;
+template <typename Leaf, std::size_t Dims, typename T> using OutOfCoreBuilder = JJDataStruct::KDTree::OutOfCoreBuilder<Leaf,Dims,T>;
+
+TEST_CASE("FrozenKDTree class test","[kdtree][frozen]")
+{
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<double> coord(-10.,10.);
+    std::vector<Point<Event,double,3> > points, queries;
+    for (std::size_t i = 0; i < 2000; ++i)
+    {
+        Event evt{i,coord(gen),coord(gen),coord(gen)};
+        points.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+    }
+    for (std::size_t i = 0; i < 50; ++i)
+    {
+        Event evt{10000 + i,coord(gen),coord(gen),coord(gen)};
+        queries.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+    }
+
+    KDTree<Event,3,double,SquaredDist> tree(8,points.begin(),points.end());
+
+    SECTION("Frozen tree gives the same results as the tree it was made from")
+    {
+        const FrozenKDTree<Event,3,double,SquaredDist> frozen(tree);
+        REQUIRE(frozen.size() == tree.size());
+        REQUIRE(frozen.GetNodes().GetNumberOfNodes() == tree.GetNodes().GetNumberOfNodes());
+
+        for (const auto &query : queries)
+        {
+            CHECK(frozen.FindNearest(query).value() == tree.FindNearest(query).value());
+
+            auto frozenNNearest = frozen.FindNNearest(query,7);
+            auto nNearest = tree.FindNNearest(query,7);
+            CHECK(std::equal(frozenNNearest.begin(),frozenNNearest.end(),nNearest.begin(),nNearest.end()));
+
+            auto frozenWithin = frozen.FindWithinDistance(query,6.);
+            auto within = tree.FindWithinDistance(query,6.);
+            auto byId = [](const Point<Event,double,3> &p1, const Point<Event,double,3> &p2){return p1.object.id < p2.object.id;};
+            std::sort(frozenWithin.begin(),frozenWithin.end(),byId);
+            std::sort(within.begin(),within.end(),byId);
+            CHECK(std::equal(frozenWithin.begin(),frozenWithin.end(),within.begin(),within.end()));
+        }
+    }
+
+    SECTION("Points of the leaves are packed from left to right")
+    {
+        const FrozenKDTree<Event,3,double,SquaredDist> frozen(tree);
+        const auto &nodes = frozen.GetNodes();
+
+        // walking the leaves from left to right has to visit the packed points in order
+        std::size_t nextPosition = 0;
+        std::vector<std::uint32_t> stack = {nodes.GetRootIndex()};
+        while (!stack.empty())
+        {
+            const auto node = nodes[stack.back()];
+            stack.pop_back();
+            if (node.IsSplit())
+            {
+                stack.push_back(node.GetRightIndex());
+                stack.push_back(node.GetLeftIndex());
+            }
+            else
+            {
+                node.ForEachDistance(queries.front(),[&nextPosition](std::size_t i, double){CHECK(i == nextPosition++);});
+            }
+        }
+        REQUIRE(nextPosition == points.size());
+    }
+
+    SECTION("Top of the tree is stored first")
+    {
+        const FrozenKDTree<Event,3,double,SquaredDist> frozen(tree);
+        const auto &nodes = frozen.GetNodes();
+
+        // the top 4 levels come first and are split again into 2 levels on top of four subtrees of 2 levels, each stored in one piece
+        REQUIRE(nodes[0].IsSplit());
+        REQUIRE(nodes[0].GetLeftIndex() == 1);
+        REQUIRE(nodes[0].GetRightIndex() == 2);
+        REQUIRE(nodes[1].GetLeftIndex() == 3);
+        REQUIRE(nodes[3].GetLeftIndex() == 4);
+        REQUIRE(nodes[3].GetRightIndex() == 5);
+        REQUIRE(nodes[1].GetRightIndex() == 6);
+        REQUIRE(nodes[6].GetLeftIndex() == 7);
+        REQUIRE(nodes[6].GetRightIndex() == 8);
+    }
+
+    SECTION("Freezing a tree which was modified after the split")
+    {
+        for (std::size_t i = 0; i < 1500; ++i)
+            REQUIRE(tree.RemovePoint(points.at(i)).has_value());
+        for (std::size_t i = 0; i < 100; ++i)
+        {
+            Event evt{20000 + i,coord(gen),coord(gen),coord(gen)};
+            REQUIRE(tree.AddPoint(Point<Event,double,3>{evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}}));
+        }
+
+        const FrozenKDTree<Event,3,double,SquaredDist> frozen(tree);
+        REQUIRE(frozen.size() == 600);
+        for (const auto &query : queries)
+            CHECK(frozen.FindNearest(query).value() == tree.FindNearest(query).value());
+    }
+
+    SECTION("Freezing a tree which is not split")
+    {
+        KDTree<Event,3,double,SquaredDist> smallTree(4);
+        for (std::size_t i = 0; i < 20; ++i)
+            smallTree.AddPoint(points.at(i));
+        REQUIRE(smallTree.IsSplit() == false);
+
+        const FrozenKDTree<Event,3,double,SquaredDist> frozen(smallTree);
+        REQUIRE(frozen.size() == 20);
+        REQUIRE(frozen.GetNodes()[0].IsSplit());
+        REQUIRE(frozen.FindNearest(points.at(3)).value() == points.at(3));
+    }
+
+    SECTION("Copies share the frozen tree")
+    {
+        const FrozenKDTree<Event,3,double,SquaredDist> frozen(8,points.begin(),points.end());
+        const FrozenKDTree<Event,3,double,SquaredDist> copy = frozen;
+        REQUIRE(copy.GetNodes().GetRecords() == frozen.GetNodes().GetRecords());
+        REQUIRE(copy.FindNearest(queries.front()).value() == tree.FindNearest(queries.front()).value());
+    }
+
+    SECTION("Frozen tree stored in a file and mapped back")
+    {
+        const std::string path = "testFrozenTree.kdtree";
+        const FrozenKDTree<Event,3,double,SquaredDist> frozen(tree);
+        frozen.Save(path);
+
+        {
+            const auto mapped = FrozenKDTree<Event,3,double,SquaredDist>::Map(path);
+            REQUIRE(mapped.size() == frozen.size());
+            REQUIRE(mapped.GetNodes().GetNumberOfNodes() == frozen.GetNodes().GetNumberOfNodes());
+            for (const auto &query : queries)
+            {
+                CHECK(mapped.FindNearest(query).value() == frozen.FindNearest(query).value());
+                auto mappedNNearest = mapped.FindNNearest(query,7);
+                auto nNearest = frozen.FindNNearest(query,7);
+                CHECK(std::equal(mappedNNearest.begin(),mappedNNearest.end(),nNearest.begin(),nNearest.end()));
+                CHECK(mapped.FindWithinDistance(query,6.).size() == frozen.FindWithinDistance(query,6.).size());
+            }
+        }
+
+        // the padding at the end of every node record is written as zeros, so the same tree always gives the same file
+        {
+            using Record = JJDataStruct::KDTree::FrozenNodeRecord<double>;
+            std::ifstream in(path,std::ios::binary);
+            std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(in)),std::istreambuf_iterator<char>());
+            JJDataStruct::KDTree::FileFormat::Header header;
+            std::memcpy(&header,bytes.data(),sizeof(header));
+            REQUIRE(header.recordSize == sizeof(Record));
+            for (std::uint64_t record = 0; record < header.nRecords; ++record)
+                for (std::size_t byte = offsetof(Record,second) + sizeof(std::uint32_t); byte < sizeof(Record); ++byte)
+                    CHECK(bytes.at(static_cast<std::size_t>(header.recordsOffset + record * sizeof(Record)) + byte) == 0);
+
+            // a child index or a range of points outside of the tree is rejected before any search can follow it
+            const std::string corruptedPath = "testFrozenTreeCorrupted.kdtree";
+            for (std::size_t field : {offsetof(Record,first),offsetof(Record,second)})
+            {
+                std::vector<unsigned char> corrupted = bytes;
+                const std::uint32_t outside = static_cast<std::uint32_t>(header.nRecords + header.nPoints);
+                std::memcpy(corrupted.data() + header.recordsOffset + field,&outside,sizeof(outside));
+                {
+                    std::ofstream out(corruptedPath,std::ios::binary | std::ios::trunc);
+                    out.write(reinterpret_cast<const char*>(corrupted.data()),static_cast<std::streamsize>(corrupted.size()));
+                }
+                REQUIRE_THROWS_AS((FrozenKDTree<Event,3,double,SquaredDist>::Map(corruptedPath)),std::runtime_error);
+            }
+            std::remove(corruptedPath.c_str());
+        }
+
+        // a tree of different types, a truncated file and a file which is not a tree at all are all rejected
+        REQUIRE_THROWS_AS((FrozenKDTree<Event,3,float,SquaredDist>::Map(path)),std::runtime_error);
+        REQUIRE_THROWS_AS((FrozenKDTree<Event,2,double,SquaredDist>::Map(path)),std::runtime_error);
+        {
+            std::ifstream in(path,std::ios::binary);
+            std::vector<char> bytes((std::istreambuf_iterator<char>(in)),std::istreambuf_iterator<char>());
+            std::ofstream out(path,std::ios::binary | std::ios::trunc);
+            out.write(bytes.data(),static_cast<std::streamsize>(bytes.size() / 2));
+        }
+        REQUIRE_THROWS_AS((FrozenKDTree<Event,3,double,SquaredDist>::Map(path)),std::runtime_error);
+        {
+            std::ofstream out(path,std::ios::binary | std::ios::trunc);
+            out << "definitely not a tree, but long enough to hold a header of a tree file......................................................";
+        }
+        REQUIRE_THROWS_AS((FrozenKDTree<Event,3,double,SquaredDist>::Map(path)),std::runtime_error);
+        REQUIRE_THROWS_AS((FrozenKDTree<Event,3,double,SquaredDist>::Map("does/not/exist.kdtree")),std::runtime_error);
+
+        std::remove(path.c_str());
+    }
+
+    SECTION("Tree built out of core from a file of points")
+    {
+        // many points share the same x coordinate, so some splits have to divide points lying on the median
+        for (auto &point : points)
+            point.coords[0] = std::round(point.coords[0] / 4.);
+
+        const std::string inputPath = "testFrozenTreeInput.points";
+        const std::string path = "testFrozenTreeOutOfCore.kdtree";
+        {
+            std::ofstream input(inputPath,std::ios::binary | std::ios::trunc);
+            input.write(reinterpret_cast<const char*>(points.data()),static_cast<std::streamsize>(points.size() * sizeof(Point<Event,double,3>)));
+        }
+
+        // a budget of 64 points: the file is partitioned on disk down to parts of 32 points
+        OutOfCoreBuilder<Event,3,double> builder(8,64 * sizeof(Point<Event,double,3>),".");
+        builder.Build(inputPath,path);
+
+        const auto mapped = FrozenKDTree<Event,3,double,SquaredDist>::Map(path);
+        REQUIRE(mapped.size() == points.size());
+        for (const auto &query : queries)
+        {
+            auto byDistance = [&query](const Point<Event,double,3> &p1, const Point<Event,double,3> &p2){return SquaredDist::distance(p1,query) < SquaredDist::distance(p2,query);};
+            std::vector<Point<Event,double,3> > sorted = points;
+            std::sort(sorted.begin(),sorted.end(),byDistance);
+
+            CHECK(SquaredDist::distance(mapped.FindNearest(query).value(),query) == SquaredDist::distance(sorted.front(),query));
+            auto nNearest = mapped.FindNNearest(query,7);
+            REQUIRE(nNearest.size() == 7);
+            for (std::size_t i = 0; i < nNearest.size(); ++i)
+                CHECK(SquaredDist::distance(nNearest[i],query) == SquaredDist::distance(sorted[i],query));
+            const auto nWithin = static_cast<std::size_t>(std::count_if(points.begin(),points.end(),[&query](const Point<Event,double,3> &point){return SquaredDist::distance(point,query) <= 6.;}));
+            CHECK(mapped.FindWithinDistance(query,6.).size() == nWithin);
+        }
+
+        // building from a range gives the same tree
+        const std::string rangePath = "testFrozenTreeRange.kdtree";
+        builder.Build(points.begin(),points.end(),rangePath);
+        {
+            const auto rangeMapped = FrozenKDTree<Event,3,double,SquaredDist>::Map(rangePath);
+            REQUIRE(rangeMapped.GetNodes().GetNumberOfNodes() == mapped.GetNodes().GetNumberOfNodes());
+            for (const auto &query : queries)
+                CHECK(rangeMapped.FindNearest(query).value() == mapped.FindNearest(query).value());
+        }
+
+        REQUIRE_THROWS_AS(builder.Build("does/not/exist.points",path),std::runtime_error);
+
+        // an empty file of points gives an empty tree
+        {
+            std::ofstream input(inputPath,std::ios::binary | std::ios::trunc);
+        }
+        builder.Build(inputPath,path);
+        {
+            const auto emptyMapped = FrozenKDTree<Event,3,double,SquaredDist>::Map(path);
+            REQUIRE(emptyMapped.size() == 0);
+            REQUIRE_FALSE(emptyMapped.FindNearest(queries.front()).has_value());
+            REQUIRE(emptyMapped.FindWithinDistance(queries.front(),6.).empty());
+        }
+
+        std::remove(inputPath.c_str());
+        std::remove(path.c_str());
+        std::remove(rangePath.c_str());
+    }
+}
@@ -1,3 +1,5 @@
+#include <random>
+
 #include "testsHeader.hxx"
 
 // =====================================================================================================
@@ -14,39 +16,39 @@ TEST_CASE("Node class tests","[node][point][distance]")
 
     SECTION("Empty node state")
     {
-        Node<Event,double,3,SquaredDist> node({},nullptr,0,32);
+        NodeArray<Event,double,3,SquaredDist> nodes({},32);
 
-        REQUIRE_THAT(node.GetMedian(), Catch::Matchers::WithinRel(double())); // GetMedian should be equal to T() [T = double]
-        REQUIRE(node.IsSplit() == false); // node is not split
-        REQUIRE(node.GetLeftNode() == nullptr); // no children
-        REQUIRE(node.GetRightNode() == nullptr); // ibid.
-        REQUIRE(node.GetData().size() == 0); // passed data was empty
+        REQUIRE_THAT(nodes[0].GetMedian(), Catch::Matchers::WithinRel(double())); // GetMedian should be equal to T() [T = double]
+        REQUIRE(nodes[0].IsSplit() == false); // node is not split
+        REQUIRE(nodes[0].GetLeftIndex() == InvalidIndex); // no children
+        REQUIRE(nodes[0].GetRightIndex() == InvalidIndex); // ibid.
+        REQUIRE(nodes[0].GetData().size() == 0); // passed data was empty
     }
 
     SECTION("Adding point ot the node where stored data <= bucket size")
     {
         Point<Event,double,3> point1 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({},nullptr,0,1);
+        NodeArray<Event,double,3,SquaredDist> nodes({},1);
 
-        REQUIRE(node.AddPoint(std::move(point1)) == true); // point was added successfuly
-        REQUIRE(node.IsSplit() == false); // node is not split
-        REQUIRE(node.GetLeftNode() == nullptr); // no children
-        REQUIRE(node.GetRightNode() == nullptr); // ibid.
-        REQUIRE(node.GetData().size() == 1); // stored data has one element
+        REQUIRE(nodes.AddPoint(0,std::move(point1)) == true); // point was added successfuly
+        REQUIRE(nodes[0].IsSplit() == false); // node is not split
+        REQUIRE(nodes[0].GetLeftIndex() == InvalidIndex); // no children
+        REQUIRE(nodes[0].GetRightIndex() == InvalidIndex); // ibid.
+        REQUIRE(nodes[0].GetData().size() == 1); // stored data has one element
     }
 
     SECTION("Node size and data size should be equal")
     {
         Point<Event,double,3> point1 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
 
-        Node<Event,double,3,SquaredDist> node({},nullptr,0,32);
+        NodeArray<Event,double,3,SquaredDist> nodes({},32);
 
-        REQUIRE(node.GetData().size() == 0); // passed data was empty
-        REQUIRE(node.size() == 0); // node is empty
-        CHECK(node.AddPoint(std::move(point1)) == true);
-        REQUIRE(node.GetData().size() == 1); // data has 1 elem
-        REQUIRE(node.size() == 1); // node has 1 elem
+        REQUIRE(nodes[0].GetData().size() == 0); // passed data was empty
+        REQUIRE(nodes[0].size() == 0); // node is empty
+        CHECK(nodes.AddPoint(0,std::move(point1)) == true);
+        REQUIRE(nodes[0].GetData().size() == 1); // data has 1 elem
+        REQUIRE(nodes[0].size() == 1); // node has 1 elem
     }
 
     SECTION("Creating node with data.size() > bucket size")
@@ -54,11 +56,11 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point1 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
         Point<Event,double,3> point2 = {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1,point2},nullptr,0,1);
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2},1);
 
-        REQUIRE(node.IsSplit()); // node should be split
-        REQUIRE(node.GetLeftNode()->size() == 1); // children should have one point each
-        REQUIRE(node.GetRightNode()->size() == 1); // idib.
+        REQUIRE(nodes[0].IsSplit()); // node should be split
+        REQUIRE(nodes.GetLeftNode(0).size() == 1); // children should have one point each
+        REQUIRE(nodes.GetRightNode(0).size() == 1); // idib.
     }
 
     SECTION("Node correctly calculates the median value")
@@ -66,9 +68,9 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point1 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
         Point<Event,double,3> point2 = {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1,point2},nullptr,0,1);
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2},1);
 
-        REQUIRE_THAT(node.GetMedian(),Catch::Matchers::WithinRel(0.5)); // median of x_1 = 0 and x_2 = 1 is 0.5
+        REQUIRE_THAT(nodes[0].GetMedian(),Catch::Matchers::WithinRel(0.5)); // median of x_1 = 0 and x_2 = 1 is 0.5
     }
 
     SECTION("Node should join if sum of points in its children is less than bucket size")
@@ -76,16 +78,16 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point1 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
         Point<Event,double,3> point2 = {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1,point2},nullptr,0,1);
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2},1);
 
-        CHECK(node.IsSplit());
-        CHECK(node.IsEmpty());
+        CHECK(nodes[0].IsSplit());
+        CHECK(nodes[0].IsEmpty());
 
-        auto removed_point = node.GetLeftNode()->RemovePoint(point1);
+        auto removed_point = nodes.GetLeftNode(0).RemovePoint(point1);
         REQUIRE(removed_point.has_value()); // point removal was successful
 
-        REQUIRE(node.TryJoin()); // node has joined
-        REQUIRE_FALSE(node.IsEmpty()); // note is not empty anymore
+        REQUIRE(nodes.TryJoin(0)); // node has joined
+        REQUIRE_FALSE(nodes[0].IsEmpty()); // note is not empty anymore
     }
 
     SECTION("Node should not join if sum of points in its children is more than bucket size")
@@ -95,17 +97,17 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point3 = {event3,{event3.Xvertex,event3.Yvertex,event3.Zvertex}};
         Point<Event,double,3> point4 = {event4,{event4.Xvertex,event4.Yvertex,event4.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1,point2,point3,point4},nullptr,0,2);
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2,point3,point4},2);
 
-        CHECK(node.IsSplit());
-        CHECK(node.IsEmpty());
+        CHECK(nodes[0].IsSplit());
+        CHECK(nodes[0].IsEmpty());
 
-        auto removed_point = node.GetRightNode()->RemovePoint(point1);
+        auto removed_point = nodes.GetRightNode(0).RemovePoint(point1);
         REQUIRE(removed_point.has_value()); // point removal was successful
         REQUIRE(removed_point.value() == point1);
 
-        REQUIRE_FALSE(node.TryJoin()); // node hasn't joined
-        REQUIRE(node.IsEmpty()); // note is still empty
+        REQUIRE_FALSE(nodes.TryJoin(0)); // node hasn't joined
+        REQUIRE(nodes[0].IsEmpty()); // note is still empty
     }
 
     SECTION("Adding point ot the node where stored data > bucket size")
@@ -113,25 +115,25 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point1 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
         Point<Event,double,3> point2 = {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({},nullptr,0,1);
+        NodeArray<Event,double,3,SquaredDist> nodes({},1);
 
-        CHECK(node.AddPoint(std::move(point1)) == true); // point was added successfuly
-        REQUIRE(node.IsSplit() == false); // node is not split
+        CHECK(nodes.AddPoint(0,std::move(point1)) == true); // point was added successfuly
+        REQUIRE(nodes[0].IsSplit() == false); // node is not split
 
-        CHECK(node.AddPoint(std::move(point2)) == true); // point was added successfuly
-        REQUIRE(node.IsSplit() == true); // node is split
+        CHECK(nodes.AddPoint(0,std::move(point2)) == true); // point was added successfuly
+        REQUIRE(nodes[0].IsSplit() == true); // node is split
 
-        REQUIRE_THAT(node.GetMedian(),Catch::Matchers::WithinRel(double(0.5))); // median should be equal to 0+1/2
+        REQUIRE_THAT(nodes[0].GetMedian(),Catch::Matchers::WithinRel(double(0.5))); // median should be equal to 0+1/2
 
-        CHECK_FALSE(node.GetLeftNode() == nullptr); // children exist
-        CHECK(node.GetLeftNode()->size() == 1); // half is passed to left
-        REQUIRE(node.GetLeftNode()->IsSplit() == false); // children are not split
+        CHECK_FALSE(nodes[0].GetLeftIndex() == InvalidIndex); // children exist
+        CHECK(nodes.GetLeftNode(0).size() == 1); // half is passed to left
+        REQUIRE(nodes.GetLeftNode(0).IsSplit() == false); // children are not split
 
-        CHECK_FALSE(node.GetRightNode() == nullptr); // children exist
-        CHECK(node.GetRightNode()->size() == 1); // half is passed to right
-        REQUIRE(node.GetRightNode()->IsSplit() == false); // children are not split
+        CHECK_FALSE(nodes[0].GetRightIndex() == InvalidIndex); // children exist
+        CHECK(nodes.GetRightNode(0).size() == 1); // half is passed to right
+        REQUIRE(nodes.GetRightNode(0).IsSplit() == false); // children are not split
 
-        REQUIRE(node.size() == 0); // stored data has no elements
+        REQUIRE(nodes[0].size() == 0); // stored data has no elements
     }
 
     SECTION("Split node should guide new point to correct child node")
@@ -141,11 +143,11 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point3 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
         Point<Event,double,3> point4 = {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1,point2},nullptr,0,1);
-        REQUIRE(node.IsSplit() == true); // testing again, this time data is passed in ctor
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2},1);
+        REQUIRE(nodes[0].IsSplit() == true); // testing again, this time data is passed in ctor
 
-        REQUIRE(node.GetChild(point3) == node.GetLeftNode()); // point3 == point1 and point3 < median therefore it will point to left node
-        REQUIRE(node.GetChild(point4) == node.GetRightNode()); // point4 == point2 and point4 > median therefore it will point to right node
+        REQUIRE(nodes[0].GetChildIndex(point3) == nodes[0].GetLeftIndex()); // point3 == point1 and point3 < median therefore it will point to left node
+        REQUIRE(nodes[0].GetChildIndex(point4) == nodes[0].GetRightIndex()); // point4 == point2 and point4 > median therefore it will point to right node
     }
 
     SECTION("Adding points to split node should be impossible")
@@ -154,9 +156,9 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point2 = {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}};
         Point<Event,double,3> point3 = {event3,{event3.Xvertex,event3.Yvertex,event3.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1,point2},nullptr,0,1);
-        REQUIRE(node.AddPoint(std::move(point3)) == false); // node is split, AddPoint should return false
-        REQUIRE(node.size() == 0); // data should still be empty
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2},1);
+        REQUIRE(nodes.AddPoint(0,std::move(point3)) == false); // node is split, AddPoint should return false
+        REQUIRE(nodes[0].size() == 0); // data should still be empty
     }
 
     SECTION("Removing point from node")
@@ -165,17 +167,17 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point2 = {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}};
         Point<Event,double,3> point3 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1},nullptr,0,1);
+        NodeArray<Event,double,3,SquaredDist> nodes({point1},1);
 
-        CHECK(node.size() == 1);
-        REQUIRE_FALSE(node.RemovePoint(point2).has_value()); // removing point which is not in tree shoudl eval to false
-        CHECK(node.size() == 1);
-        auto point = node.RemovePoint(point3);
+        CHECK(nodes[0].size() == 1);
+        REQUIRE_FALSE(nodes[0].RemovePoint(point2).has_value()); // removing point which is not in tree shoudl eval to false
+        CHECK(nodes[0].size() == 1);
+        auto point = nodes[0].RemovePoint(point3);
         REQUIRE(point.has_value()); // removing point with same ID should be possible (Leaf class impelmentation dependent)
         REQUIRE(point.value() == point3);
-        CHECK(node.size() == 0);
-        CHECK(node.IsEmpty());
-        REQUIRE(node.GetData().size() == 0); //check again if it was removed from data
+        CHECK(nodes[0].size() == 0);
+        CHECK(nodes[0].IsEmpty());
+        REQUIRE(nodes[0].GetData().size() == 0); //check again if it was removed from data
     }
 
     SECTION("Small enough children will be joined back up to parent")
@@ -184,21 +186,21 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point2 = {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}};
         Point<Event,double,3> point3 = {event3,{event3.Xvertex,event3.Yvertex,event3.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1,point2,point3},nullptr,0,2);
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2,point3},2);
 
-        CHECK(node.IsSplit());
-        CHECK(node.size() == 0);
-        CHECK(node.GetLeftNode()->size() == 1);
-        CHECK(node.GetRightNode()->size() == 2); // one point went left, two went right
+        CHECK(nodes[0].IsSplit());
+        CHECK(nodes[0].size() == 0);
+        CHECK(nodes.GetLeftNode(0).size() == 1);
+        CHECK(nodes.GetRightNode(0).size() == 2); // one point went left, two went right
 
-        auto removed_point = node.GetRightNode()->RemovePoint(point1);
+        auto removed_point = nodes.GetRightNode(0).RemovePoint(point1);
         CHECK(removed_point.has_value());
         CHECK(removed_point.value() == point1); // we have successfully removed the point we wanted
 
-        REQUIRE(node.TryJoin()); // now the total number of elements is equal to bucket, so we will join
+        REQUIRE(nodes.TryJoin(0)); // now the total number of elements is equal to bucket, so we will join
 
-        REQUIRE_FALSE(node.IsSplit());
-        REQUIRE(node.size() == 2); // check if all is good
+        REQUIRE_FALSE(nodes[0].IsSplit());
+        REQUIRE(nodes[0].size() == 2); // check if all is good
     }
 
     SECTION("Big enough children will not be joined back up tu parent")
@@ -208,19 +210,19 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point3 = {event3,{event3.Xvertex,event3.Yvertex,event3.Zvertex}};
         Point<Event,double,3> point4 = {event4,{event4.Xvertex,event4.Yvertex,event4.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1,point2,point3,point4},nullptr,0,2);
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2,point3,point4},2);
 
-        CHECK(node.IsSplit());
-        CHECK(node.size() == 0);
-        CHECK(node.GetLeftNode()->size() == 2);
-        CHECK(node.GetRightNode()->size() == 2); // split evenly
+        CHECK(nodes[0].IsSplit());
+        CHECK(nodes[0].size() == 0);
+        CHECK(nodes.GetLeftNode(0).size() == 2);
+        CHECK(nodes.GetRightNode(0).size() == 2); // split evenly
 
-        REQUIRE_FALSE(node.TryJoin()); // will not join because there are still too many points
+        REQUIRE_FALSE(nodes.TryJoin(0)); // will not join because there are still too many points
 
-        REQUIRE(node.IsSplit());
-        REQUIRE(node.size() == 0);
-        REQUIRE(node.GetLeftNode()->size() == 2);
-        REQUIRE(node.GetRightNode()->size() == 2); // check if all is the same
+        REQUIRE(nodes[0].IsSplit());
+        REQUIRE(nodes[0].size() == 0);
+        REQUIRE(nodes.GetLeftNode(0).size() == 2);
+        REQUIRE(nodes.GetRightNode(0).size() == 2); // check if all is the same
     }
 
     SECTION("Branches which are not leaves will not be joined")
@@ -229,19 +231,19 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point2 = {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}};
         Point<Event,double,3> point3 = {event3,{event3.Xvertex,event3.Yvertex,event3.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1,point2,point3},nullptr,0,1);
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2,point3},1);
 
-        CHECK(node.IsSplit());
-        CHECK(node.GetRightNode()->IsSplit()); // right node is split further; left one is a leaf
+        CHECK(nodes[0].IsSplit());
+        CHECK(nodes.GetRightNode(0).IsSplit()); // right node is split further; left one is a leaf
 
-        auto removed_point = node.GetLeftNode()->RemovePoint(point3);
+        auto removed_point = nodes.GetLeftNode(0).RemovePoint(point3);
         CHECK(removed_point.has_value());
         CHECK(removed_point.value() == point3); // successfully removed point from the left node (now is empty)
 
-        REQUIRE_FALSE(node.TryJoin()); // will not join because the right node is still split
+        REQUIRE_FALSE(nodes.TryJoin(0)); // will not join because the right node is still split
 
-        REQUIRE(node.IsSplit());
-        REQUIRE(node.GetRightNode()->IsSplit());
+        REQUIRE(nodes[0].IsSplit());
+        REQUIRE(nodes.GetRightNode(0).IsSplit());
     }
 
     SECTION("Nearest point in node which has points")
@@ -250,10 +252,10 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point2 = {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}};
         Point<Event,double,3> point3 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1,point2},nullptr,0,2);
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2},2);
 
-        std::optional<Point<Event,double,3> > nearestPoint = node.FindNearest(point3);
-        CHECK(node.size() == 2);
+        std::optional<Point<Event,double,3> > nearestPoint = nodes[0].FindNearest(point3);
+        CHECK(nodes[0].size() == 2);
         CHECK(point1 == point3);
         REQUIRE(nearestPoint.value() == point1); // nearest point should be the one which has the same value as point we use to search
     }
@@ -264,10 +266,10 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point2 = {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}};
         Point<Event,double,3> point3 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1,point2},nullptr,0,1);
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2},1);
 
-        std::optional<Point<Event,double,3> > nearestPoint = node.FindNearest(point3);
-        CHECK(node.size() == 0);
+        std::optional<Point<Event,double,3> > nearestPoint = nodes[0].FindNearest(point3);
+        CHECK(nodes[0].size() == 0);
         REQUIRE_FALSE(nearestPoint.has_value()); // nearest point should be empty
     }
 
@@ -275,9 +277,9 @@ TEST_CASE("Node class tests","[node][point][distance]")
     {
         Point<Event,double,3> point1 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({},nullptr,0,1);
+        NodeArray<Event,double,3,SquaredDist> nodes({},1);
 
-        std::optional<Point<Event,double,3> > nearestPoint = node.FindNearest(point1);
+        std::optional<Point<Event,double,3> > nearestPoint = nodes[0].FindNearest(point1);
         REQUIRE_FALSE(nearestPoint.has_value()); // returned point should be empty
     }
 
@@ -290,12 +292,12 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point5 = {event5,{event5.Xvertex,event5.Yvertex,event5.Zvertex}};
         Point<Event,double,3> point6 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1,point2,point3,point4,point5},nullptr,0,5);
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2,point3,point4,point5},5);
 
-        CHECK(node.size() == 5);
+        CHECK(nodes[0].size() == 5);
 
-        std::optional<Point<Event,double,3> > nearestPoint = node.FindNearest(point6);
-        std::vector<Point<Event,double,3> > nearestPointVec = node.FindNNearest(point6,1);
+        std::optional<Point<Event,double,3> > nearestPoint = nodes[0].FindNearest(point6);
+        std::vector<Point<Event,double,3> > nearestPointVec = nodes[0].FindNNearest(point6,1);
         CHECK(nearestPointVec.size() == 1); // make sure that vector has the same size as number of requested points
         REQUIRE(nearestPoint.value() == nearestPointVec.front()); // with N=1 both methods should give the same result
     }
@@ -309,11 +311,11 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point5 = {event5,{event5.Xvertex,event5.Yvertex,event5.Zvertex}};
         Point<Event,double,3> point6 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1,point2,point3,point4,point5},nullptr,0,5);
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2,point3,point4,point5},5);
 
-        CHECK(node.size() == 5);
+        CHECK(nodes[0].size() == 5);
 
-        std::vector<Point<Event,double,3> > nearestPointVec = node.FindNNearest(point6,3);
+        std::vector<Point<Event,double,3> > nearestPointVec = nodes[0].FindNNearest(point6,3);
         CHECK(nearestPointVec.size() == 3); // make sure that vector has the same size as number of requested points
         REQUIRE(nearestPointVec.at(0) == point1); // same position
         REQUIRE(nearestPointVec.at(1) == point2); // 2nd closest position
@@ -326,11 +328,11 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point2 = {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}};
         Point<Event,double,3> point3 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1,point2},nullptr,0,5);
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2},5);
 
-        CHECK(node.size() == 2);
+        CHECK(nodes[0].size() == 2);
 
-        std::vector<Point<Event,double,3> > nearestPointVec = node.FindNNearest(point3,3);
+        std::vector<Point<Event,double,3> > nearestPointVec = nodes[0].FindNNearest(point3,3);
         CHECK(nearestPointVec.size() == 2); // make sure that vector has the same size node
         REQUIRE(nearestPointVec.at(0) == point1); // same position
         REQUIRE(nearestPointVec.at(1) == point2); // 2nd closest position
@@ -342,10 +344,10 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point2 = {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}};
         Point<Event,double,3> point3 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1,point2},nullptr,0,1);
-        CHECK(node.size() == 0);
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2},1);
+        CHECK(nodes[0].size() == 0);
 
-        std::vector<Point<Event,double,3> > nearestPointVec = node.FindNNearest(point3,2);
+        std::vector<Point<Event,double,3> > nearestPointVec = nodes[0].FindNNearest(point3,2);
         REQUIRE(nearestPointVec.empty() == true);
         REQUIRE(nearestPointVec.size() == 0);
     }
@@ -354,10 +356,10 @@ TEST_CASE("Node class tests","[node][point][distance]")
     {
         Point<Event,double,3> point1 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({},nullptr,0,1);
-        CHECK(node.size() == 0);
+        NodeArray<Event,double,3,SquaredDist> nodes({},1);
+        CHECK(nodes[0].size() == 0);
 
-        std::vector<Point<Event,double,3> > nearestPointVec = node.FindNNearest(point1,2);
+        std::vector<Point<Event,double,3> > nearestPointVec = nodes[0].FindNNearest(point1,2);
         REQUIRE(nearestPointVec.empty() == true);
         REQUIRE(nearestPointVec.size() == 0);
     }
@@ -368,9 +370,9 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point2 = {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}};
         Point<Event,double,3> point3 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1,point2},nullptr,0,5);
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2},5);
 
-        std::vector<Point<Event,double,3> > nearestPointVec = node.FindWithinDistance(point3,3);
+        std::vector<Point<Event,double,3> > nearestPointVec = nodes[0].FindWithinDistance(point3,3);
         CHECK(nearestPointVec.size() == 2);
         REQUIRE(nearestPointVec.at(0) == point1);
         REQUIRE(nearestPointVec.at(1) == point2);
@@ -385,12 +387,161 @@ TEST_CASE("Node class tests","[node][point][distance]")
         Point<Event,double,3> point5 = {event5,{event5.Xvertex,event5.Yvertex,event5.Zvertex}};
         Point<Event,double,3> point6 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
         
-        Node<Event,double,3,SquaredDist> node({point1,point2,point3,point4,point5},nullptr,0,5);
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2,point3,point4,point5},5);
 
-        std::vector<Point<Event,double,3> > nearestPointVec = node.FindWithinDistance(point6,3);
+        std::vector<Point<Event,double,3> > nearestPointVec = nodes[0].FindWithinDistance(point6,3);
         CHECK(nearestPointVec.size() == 3);
         REQUIRE(nearestPointVec.at(0) == point1);
         REQUIRE(nearestPointVec.at(1) == point2);
         REQUIRE(nearestPointVec.at(2) == point3);
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("NodeArray class tests","[node][point][distance]")
+{
+    Event event1 = {.id = 1, .Xvertex = 0.0, .Yvertex = 0.0, .Zvertex = 0.0};
+    Event event2 = {.id = 2, .Xvertex = 1.0, .Yvertex = 1.0, .Zvertex = 1.0};
+    Event event3 = {.id = 3, .Xvertex = -1.0, .Yvertex = -1.0, .Zvertex = -1.0};
+
+    Point<Event,double,3> point1 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
+    Point<Event,double,3> point2 = {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}};
+    Point<Event,double,3> point3 = {event3,{event3.Xvertex,event3.Yvertex,event3.Zvertex}};
+
+    SECTION("Array without data has no nodes")
+    {
+        NodeArray<Event,double,3,SquaredDist> nodes(1);
+
+        REQUIRE(nodes.IsEmpty());
+        REQUIRE(nodes.GetNumberOfNodes() == 0);
+        REQUIRE_FALSE(nodes.IsValidIndex(nodes.GetRootIndex()));
+    }
+
+    SECTION("Root node sits at index 0 and its children refer back to it")
+    {
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2,point3},2);
+
+        REQUIRE(nodes.GetRootIndex() == 0);
+        REQUIRE(nodes[0].GetParentIndex() == InvalidIndex); // root has no parent
+        REQUIRE(nodes.GetNumberOfNodes() == 3); // root and two leaves
+        REQUIRE(nodes.GetLeftNode(0).GetParentIndex() == 0);
+        REQUIRE(nodes.GetRightNode(0).GetParentIndex() == 0);
+        REQUIRE(nodes.GetLeftNode(0).GetDepth() == 1);
+        REQUIRE(nodes.GetRightNode(0).GetDimensionIndex() == 1); // children split along the next dimension
+    }
+
+    SECTION("Nodes released by a join are reused by the next split")
+    {
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2},1);
+
+        CHECK(nodes.GetNumberOfNodes() == 3);
+        CHECK(nodes.GetLeftNode(0).RemovePoint(point1).has_value());
+        CHECK(nodes.TryJoin(0));
+        REQUIRE(nodes.GetNumberOfNodes() == 1); // children were released
+
+        CHECK(nodes.AddPoint(0,point3));
+        REQUIRE(nodes[0].IsSplit()); // split again
+        REQUIRE(nodes.GetNumberOfNodes() == 3);
+        REQUIRE(nodes[0].GetLeftIndex() < 3); // no new slots were appended
+        REQUIRE(nodes[0].GetRightIndex() < 3);
+    }
+
+    SECTION("Bulk build lays the nodes out in pre-order without spare slots")
+    {
+        Event event4 = {.id = 4, .Xvertex = -2.0, .Yvertex = -2.0, .Zvertex = -1.0};
+        Event event5 = {.id = 5, .Xvertex = 2.0, .Yvertex = 2.0, .Zvertex = 2.0};
+        Point<Event,double,3> point4 = {event4,{event4.Xvertex,event4.Yvertex,event4.Zvertex}};
+        Point<Event,double,3> point5 = {event5,{event5.Xvertex,event5.Yvertex,event5.Zvertex}};
+
+        NodeArray<Event,double,3,SquaredDist> nodes({point1,point2,point3,point4,point5},1);
+
+        REQUIRE(nodes.GetNumberOfNodes() == 9); // 5 leaves and 4 split nodes
+        REQUIRE(nodes[0].GetLeftIndex() == 1); // left child follows its parent
+        REQUIRE(nodes[0].GetRightIndex() == 4); // right child follows the left subtree (two points: 2 leaves + 1 split node)
+        REQUIRE_THAT(nodes[0].GetMedian(),Catch::Matchers::WithinRel(0.0)); // x = {-2,-1,0,1,2} so the median is at point
+        REQUIRE(nodes.GetLeftNode(0).GetLeftIndex() == 2);
+        REQUIRE(nodes.GetRightNode(0).IsSplit());
+    }
+
+    SECTION("Parallel build produces the same tree as the serial one")
+    {
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<double> uniform(-10.,10.);
+        std::vector<Point<Event,double,3> > points;
+        for (std::size_t i = 0; i < 100000; ++i)
+        {
+            Event event = {.id = i, .Xvertex = uniform(gen), .Yvertex = uniform(gen), .Zvertex = uniform(gen)};
+            points.push_back({event,{event.Xvertex,event.Yvertex,event.Zvertex}});
+        }
+
+        NodeArray<Event,double,3,SquaredDist> serialNodes(8), parallelNodes(8);
+        serialNodes.Build(std::vector<Point<Event,double,3> >(points));
+        parallelNodes.Build(std::vector<Point<Event,double,3> >(points),4);
+
+        REQUIRE(serialNodes.GetNumberOfNodes() == parallelNodes.GetNumberOfNodes());
+        bool identical = true;
+        for (std::uint32_t index = 0; index < serialNodes.GetNumberOfNodes(); ++index)
+        {
+            identical = identical && serialNodes[index].GetLeftIndex() == parallelNodes[index].GetLeftIndex() 
+                && serialNodes[index].GetRightIndex() == parallelNodes[index].GetRightIndex()
+                && serialNodes[index].GetMedian() == parallelNodes[index].GetMedian()
+                && serialNodes[index].GetData() == parallelNodes[index].GetData();
+        }
+        REQUIRE(identical); // same layout, same medians and the same points in the same order
+    }
+}
+
+TEST_CASE("Bucket class tests","[node][point]")
+{
+    Event event1 = {.id = 1, .Xvertex = 0.0, .Yvertex = 0.5, .Zvertex = 1.0};
+    Event event2 = {.id = 2, .Xvertex = 1.0, .Yvertex = 1.5, .Zvertex = 2.0};
+    Event event3 = {.id = 3, .Xvertex = 2.0, .Yvertex = 2.5, .Zvertex = 3.0};
+
+    Point<Event,double,3> point1 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
+    Point<Event,double,3> point2 = {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}};
+    Point<Event,double,3> point3 = {event3,{event3.Xvertex,event3.Yvertex,event3.Zvertex}};
+
+    JJDataStruct::KDTree::Bucket<Event,double,3> bucket(std::vector<Point<Event,double,3> >{point1,point2,point3});
+
+    SECTION("Coordinates are stored in a separate array for each dimension")
+    {
+        REQUIRE(bucket.size() == 3);
+        for (std::size_t dim = 0; dim < 3; ++dim)
+        {
+            const double *column = bucket.GetColumn(dim);
+            CHECK(column[0] == point1.coords[dim]);
+            CHECK(column[1] == point2.coords[dim]);
+            CHECK(column[2] == point3.coords[dim]);
+        }
+        REQUIRE(bucket.GetObject(1) == event2);
+        REQUIRE(bucket.GetPoint(2).coords == point3.coords);
+    }
+
+    SECTION("Erasing a point keeps the order of the others")
+    {
+        REQUIRE(bucket.Find(point2).value() == 1);
+
+        auto removed = bucket.Erase(1);
+
+        REQUIRE(removed == point2);
+        REQUIRE(removed.coords == point2.coords);
+        REQUIRE(bucket.GetPoints() == std::vector<Point<Event,double,3> >{point1,point3});
+        REQUIRE(bucket.GetCoordinate(1,2) == point3.coords[2]);
+        REQUIRE_FALSE(bucket.Find(point2).has_value());
+    }
+
+    SECTION("Moving points between buckets")
+    {
+        JJDataStruct::KDTree::Bucket<Event,double,3> other(std::vector<Point<Event,double,3> >{point2});
+        bucket.Append(std::move(other));
+
+        REQUIRE(other.IsEmpty());
+        REQUIRE(bucket.size() == 4);
+        REQUIRE(bucket.GetPoint(3).coords == point2.coords);
+
+        std::vector<Point<Event,double,3> > points;
+        bucket.MoveTo(points);
+
+        REQUIRE(bucket.IsEmpty());
+        REQUIRE(points == std::vector<Point<Event,double,3> >{point1,point2,point3,point2});
+    }
+}
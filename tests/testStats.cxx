@@ -0,0 +1,144 @@
+#define KDTREE_ENABLE_STATS
+
+#include "testsHeader.hxx"
+
+#include <random>
+
+// =====================================================================================================
+// Query and tree shape statistics tests
+// =====================================================================================================
+
+using QueryStats = JJDataStruct::KDTree::QueryStats;
+
+TEST_CASE("Statistics test","[kdtree][stats]")
+{
+    std::mt19937 gen(31);
+    std::uniform_real_distribution<double> coord(-10.,10.);
+    std::vector<Point<Event,double,3> > points, queries;
+    for (std::size_t i = 0; i < 2000; ++i)
+    {
+        Event evt{i,coord(gen),coord(gen),coord(gen)};
+        points.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+    }
+    for (std::size_t i = 0; i < 40; ++i)
+    {
+        Event evt{10000 + i,coord(gen),coord(gen),coord(gen)};
+        queries.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+    }
+    KDTree<Event,3,double,SquaredDist> tree(8,points.begin(),points.end());
+
+    SECTION("Tree shape covers every leaf and point")
+    {
+        const auto shape = tree.GetTreeShape();
+        REQUIRE(shape.GetNumberOfLeaves() == shape.nInternalNodes + 1);
+        REQUIRE(shape.GetNumberOfLeaves() + shape.nInternalNodes == tree.GetNodes().GetNumberOfNodes());
+
+        std::size_t nPoints = 0;
+        for (std::size_t fill = 0; fill < shape.fillHistogram.size(); ++fill)
+            nPoints += fill * shape.fillHistogram[fill];
+        REQUIRE(nPoints == points.size());
+        REQUIRE(shape.fillHistogram.size() <= 9);
+
+        // a balanced build puts all the leaves on at most two neighbouring levels
+        std::size_t nLevels = 0;
+        for (std::size_t count : shape.depthHistogram)
+            nLevels += (count > 0) ? 1 : 0;
+        REQUIRE(nLevels <= 2);
+        REQUIRE(shape.GetMaxDepth() == 8);
+
+        KDTree<Event,3,double,SquaredDist> unsplit(8);
+        REQUIRE(unsplit.GetTreeShape().GetNumberOfLeaves() == 0);
+    }
+
+    SECTION("Every query counts its work")
+    {
+        for (const auto &query : queries)
+        {
+            const auto closestPoints = tree.FindNNearest(query,5);
+            const QueryStats &stats = tree.GetLastQueryStats();
+            CHECK(stats.resultSize == closestPoints.size());
+            // every visited node either descends into both children or prunes one of them
+            CHECK(stats.leavesScanned == stats.nodesVisited - stats.prunedSubtrees + 1);
+            CHECK(stats.distanceEvaluations >= stats.resultSize);
+            CHECK(stats.distanceEvaluations < points.size() / 4);
+
+            (void)tree.FindNearest(query);
+            CHECK(tree.GetLastQueryStats().resultSize == 1);
+            CHECK(tree.GetLastQueryStats().prunedSubtrees > 0);
+        }
+
+        const auto everything = tree.FindWithinDistance(queries.front(),1e6);
+        REQUIRE(everything.size() == points.size());
+        REQUIRE(tree.GetLastQueryStats().prunedSubtrees == 0);
+        REQUIRE(tree.GetLastQueryStats().distanceEvaluations == points.size());
+        REQUIRE(tree.GetLastQueryStats().leavesScanned == tree.GetTreeShape().GetNumberOfLeaves());
+
+        // counting takes the cells lying inside the region at once
+        REQUIRE(tree.CountWithinDistance(queries.front(),1e6) == points.size());
+        REQUIRE(tree.GetLastQueryStats().resultSize == points.size());
+        REQUIRE(tree.GetLastQueryStats().leavesScanned == 0);
+        REQUIRE(tree.GetLastQueryStats().distanceEvaluations == 0);
+        REQUIRE(tree.CountInBox({-20.,-20.,-20.},{20.,20.,20.}) == points.size());
+        REQUIRE(tree.GetLastQueryStats().leavesScanned == 0);
+
+        // approximate searches keep to their budget and look at fewer leaves
+        JJDataStruct::KDTree::SearchOptions options;
+        options.maxLeaves = 2;
+        std::size_t nExactLeaves = 0, nApproximateLeaves = 0;
+        for (const auto &query : queries)
+        {
+            REQUIRE(tree.FindNNearest(query,5,options).size() > 0);
+            CHECK(tree.GetLastQueryStats().leavesScanned <= 2);
+
+            options.maxLeaves = 0;
+            options.epsilon = 1.;
+            (void)tree.FindNNearest(query,5,options);
+            nApproximateLeaves += tree.GetLastQueryStats().leavesScanned;
+            (void)tree.FindNNearest(query,5);
+            nExactLeaves += tree.GetLastQueryStats().leavesScanned;
+
+            options.epsilon = 0.;
+            options.maxDistanceEvaluations = 10;
+            REQUIRE(tree.FindNearest(query,options).has_value());
+            CHECK(tree.GetLastQueryStats().distanceEvaluations <= 10);
+            options.maxDistanceEvaluations = 3; // runs out inside the first leaf
+            REQUIRE(tree.FindNNearest(query,5,options).size() == 3);
+            CHECK(tree.GetLastQueryStats().distanceEvaluations == 3);
+            options.maxDistanceEvaluations = 0;
+            options.maxLeaves = 2;
+        }
+        REQUIRE(nApproximateLeaves < nExactLeaves);
+    }
+
+    SECTION("Statistics are aggregated over the queries")
+    {
+        tree.ResetQueryStats();
+        REQUIRE(tree.GetQueryStats().nQueries == 0);
+
+        std::size_t nResults = 0, maxScanned = 0;
+        for (const auto &query : queries)
+        {
+            nResults += tree.FindWithinDistance(query,4.).size();
+            maxScanned = std::max(maxScanned,tree.GetLastQueryStats().leavesScanned);
+        }
+
+        auto summary = tree.GetQueryStats();
+        REQUIRE(summary.nQueries == queries.size());
+        REQUIRE(summary.total.resultSize == nResults);
+        REQUIRE(summary.max.leavesScanned == maxScanned);
+        REQUIRE_THAT(summary.Mean(&QueryStats::resultSize),Catch::Matchers::WithinRel(static_cast<double>(nResults) / static_cast<double>(queries.size())));
+
+        // queries split across threads are recorded too
+        std::vector<JJDataStruct::KDTree::PointLocation> outLocations;
+        std::vector<double> outDistances;
+        tree.FindNNearest(queries.begin(),queries.end(),3,outLocations,outDistances,4);
+        summary = tree.GetQueryStats();
+        REQUIRE(summary.nQueries == 2 * queries.size());
+        REQUIRE(summary.total.resultSize == nResults + 3 * queries.size());
+        REQUIRE(summary.max.leavesScanned >= maxScanned);
+        REQUIRE(summary.max.resultSize >= 3);
+
+        tree.ResetQueryStats();
+        REQUIRE(tree.GetQueryStats().total.leavesScanned == 0);
+    }
+}
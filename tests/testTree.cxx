@@ -1,5 +1,8 @@
 #include "testsHeader.hxx"
 
+#include <memory_resource>
+#include <random>
+
 // =====================================================================================================
 // KDTree class tests
 // =====================================================================================================
@@ -131,6 +134,500 @@ TEST_CASE("KDTree class test","[kdtree][node][point][distance]")
         CHECK(tree.size() == 0);
     }
 
+    SECTION("Building a tree from a range of points")
+    {
+        std::vector<Point<Event,double,3> > points = {
+            {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}},
+            {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}},
+            {event3,{event3.Xvertex,event3.Yvertex,event3.Zvertex}},
+            {event4,{event4.Xvertex,event4.Yvertex,event4.Zvertex}},
+            {event5,{event5.Xvertex,event5.Yvertex,event5.Zvertex}}};
+
+        KDTree<Event,3,double,SquaredDist> tree(2,points.begin(),points.end());
+
+        REQUIRE(tree.IsSplit() == true); // range constructor builds the tree right away
+        REQUIRE(tree.size() == 5);
+        REQUIRE(tree.FindNearest(points.at(3)).value() == points.at(3));
+    }
+
+    SECTION("Bulk build merges the points collected before")
+    {
+        Point<Event,double,3> point1 = {event1,{event1.Xvertex,event1.Yvertex,event1.Zvertex}};
+        Point<Event,double,3> point2 = {event2,{event2.Xvertex,event2.Yvertex,event2.Zvertex}};
+        std::vector<Point<Event,double,3> > points = {
+            {event6,{event6.Xvertex,event6.Yvertex,event6.Zvertex}},
+            {event7,{event7.Xvertex,event7.Yvertex,event7.Zvertex}},
+            {event8,{event8.Xvertex,event8.Yvertex,event8.Zvertex}}};
+
+        KDTree<Event,3,double,SquaredDist> tree(1,10000,{point1,point2});
+        CHECK(tree.IsSplit() == false);
+
+        tree.BuildTree(points.begin(),points.end());
+
+        REQUIRE(tree.IsSplit() == true);
+        REQUIRE(tree.size() == 5);
+        REQUIRE(tree.FindNearest(point2).value() == point2);
+        REQUIRE(tree.FindNearest(points.at(2)).value() == points.at(2));
+
+        tree.BuildTree(points.end(),points.end()); // rebuilding a split tree keeps its points
+        REQUIRE(tree.size() == 5);
+    }
+
+    SECTION("Batched queries give the same results as single queries")
+    {
+        std::mt19937 gen(7);
+        std::uniform_real_distribution<double> coord(-10.,10.);
+        std::vector<Point<Event,double,3> > points, queries;
+        for (std::size_t i = 0; i < 2000; ++i)
+        {
+            Event evt{i,coord(gen),coord(gen),coord(gen)};
+            points.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+        }
+        for (std::size_t i = 0; i < 50; ++i)
+        {
+            Event evt{10000 + i,coord(gen),coord(gen),coord(gen)};
+            queries.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+        }
+
+        const KDTree<Event,3,double,SquaredDist> tree(8,points.begin(),points.end()); // searching does not modify the tree
+        std::vector<JJDataStruct::KDTree::PointLocation> outLocations;
+        std::vector<double> outDistances;
+        std::vector<std::size_t> outOffsets;
+
+        for (unsigned nThreads : {1u,3u})
+        {
+            tree.FindNearest(queries.begin(),queries.end(),outLocations,outDistances,nThreads);
+            REQUIRE(outLocations.size() == queries.size());
+            for (std::size_t i = 0; i < queries.size(); ++i)
+            {
+                REQUIRE(outLocations.at(i).IsValid());
+                CHECK(tree.GetPoint(outLocations.at(i)) == tree.FindNearest(queries.at(i)).value());
+                CHECK(outDistances.at(i) == SquaredDist::distance(queries.at(i).coords,tree.GetCoordinates(outLocations.at(i))));
+            }
+
+            const std::size_t stride = tree.FindNNearest(queries.begin(),queries.end(),5,outLocations,outDistances,nThreads);
+            REQUIRE(stride == 5);
+            REQUIRE(outLocations.size() == queries.size() * stride);
+            for (std::size_t i = 0; i < queries.size(); ++i)
+            {
+                auto single = tree.FindNNearest(queries.at(i),5);
+                for (std::size_t j = 0; j < stride; ++j)
+                {
+                    CHECK(tree.GetObject(outLocations.at(i * stride + j)) == single.at(j).object);
+                    CHECK(outDistances.at(i * stride + j) == SquaredDist::distance(queries.at(i),single.at(j)));
+                }
+            }
+
+            tree.FindWithinDistance(queries.begin(),queries.end(),4.,outLocations,outDistances,outOffsets,nThreads);
+            REQUIRE(outOffsets.size() == queries.size() + 1);
+            REQUIRE(outOffsets.back() == outLocations.size());
+            REQUIRE(outDistances.size() == outLocations.size());
+            for (std::size_t i = 0; i < queries.size(); ++i)
+            {
+                auto single = tree.FindWithinDistance(queries.at(i),4.);
+                REQUIRE(outOffsets.at(i + 1) - outOffsets.at(i) == single.size());
+                for (std::size_t j = outOffsets.at(i); j < outOffsets.at(i + 1); ++j)
+                {
+                    CHECK(tree.GetPoint(outLocations.at(j)) == single.at(j - outOffsets.at(i)));
+                    CHECK(outDistances.at(j) == SquaredDist::distance(queries.at(i).coords,tree.GetCoordinates(outLocations.at(j))));
+                    CHECK(outDistances.at(j) <= 4.);
+                }
+            }
+        }
+
+        // a query without a result is told apart from an exact hit, also for integer coordinates
+        std::vector<Point<Event,int,2> > noPoints;
+        const KDTree<Event,2,int,SquaredDist> emptyTree(8,noPoints.begin(),noPoints.end());
+        std::vector<Point<Event,int,2> > intQueries = {{{0,0.,0.,0.},{0,0}}};
+        std::vector<int> intDistances;
+        emptyTree.FindNearest(intQueries.begin(),intQueries.end(),outLocations,intDistances);
+        REQUIRE(outLocations.size() == 1);
+        REQUIRE_FALSE(outLocations.front().IsValid());
+        REQUIRE(intDistances.front() == std::numeric_limits<int>::max());
+    }
+
+    SECTION("Nodes and buckets are allocated from the given memory resource")
+    {
+        std::mt19937 gen(11);
+        std::uniform_real_distribution<double> coord(-10.,10.);
+        std::vector<Point<Event,double,3> > points;
+        for (std::size_t i = 0; i < 500; ++i)
+        {
+            Event evt{i,coord(gen),coord(gen),coord(gen)};
+            points.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+        }
+        const KDTree<Event,3,double,SquaredDist> reference(4,points.begin(),points.end());
+
+        // any bucket allocated from the default resource would throw std::bad_alloc
+        struct DefaultResourceGuard
+        {
+            std::pmr::memory_resource *previous = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+            ~DefaultResourceGuard() {std::pmr::set_default_resource(previous);}
+        };
+
+        std::pmr::unsynchronized_pool_resource pool;
+        {
+            DefaultResourceGuard guard;
+            KDTree<Event,3,double,SquaredDist> tree(4,points.begin(),points.begin() + 250,&pool);
+            REQUIRE(tree.GetMemoryResource() == &pool);
+            for (auto it = points.begin() + 250; it != points.end(); ++it)
+                REQUIRE(tree.AddPoint(*it)); // splits
+            for (std::size_t i = 0; i < 400; ++i)
+                REQUIRE(tree.RemovePoint(points.at(i)).has_value()); // joins
+            for (std::size_t i = 0; i < 400; ++i)
+                REQUIRE(tree.AddPoint(points.at(i)));
+
+            REQUIRE(tree.size() == points.size());
+            for (std::size_t i = 0; i < points.size(); i += 25)
+                CHECK(tree.FindNearest(points.at(i)).value() == reference.FindNearest(points.at(i)).value());
+        }
+
+        // with a monotonic arena the whole tree is dropped without freeing its buckets one by one
+        std::pmr::monotonic_buffer_resource arena;
+        {
+            DefaultResourceGuard guard;
+            KDTree<Event,3,double,SquaredDist> tree(4,points.begin(),points.end(),&arena);
+            CHECK(tree.FindNNearest(points.front(),5).size() == 5);
+        }
+        arena.release();
+    }
+
+    SECTION("Tree with fixed-capacity buckets gives the same results")
+    {
+        std::mt19937 gen(13);
+        std::uniform_real_distribution<double> coord(-10.,10.);
+        std::vector<Point<Event,double,3> > points;
+        for (std::size_t i = 0; i < 1000; ++i)
+        {
+            Event evt{i,coord(gen),coord(gen),coord(gen)};
+            points.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+        }
+
+        KDTree<Event,3,double,SquaredDist> tree(6,100);
+        JJDataStruct::KDTree::KDTree<Event,3,double,SquaredDist,6> fixedTree(6,100);
+        for (const auto &point : points)
+        {
+            REQUIRE(tree.AddPoint(point));
+            REQUIRE(fixedTree.AddPoint(point));
+        }
+        for (std::size_t i = 0; i < points.size(); i += 3)
+            REQUIRE(fixedTree.RemovePoint(points.at(i)) == tree.RemovePoint(points.at(i)));
+
+        REQUIRE(fixedTree.size() == tree.size());
+        REQUIRE(fixedTree.GetNodes().GetNumberOfNodes() == tree.GetNodes().GetNumberOfNodes());
+        for (std::size_t i = 0; i < points.size(); i += 10)
+        {
+            auto fixedNNearest = fixedTree.FindNNearest(points.at(i),5);
+            auto nNearest = tree.FindNNearest(points.at(i),5);
+            CHECK(std::equal(fixedNNearest.begin(),fixedNNearest.end(),nNearest.begin(),nNearest.end()));
+        }
+
+        REQUIRE_THROWS_AS((JJDataStruct::KDTree::KDTree<Event,3,double,SquaredDist,6>(7)),std::length_error);
+    }
+
+    SECTION("Sliding window keeps only the most recently added points")
+    {
+        std::mt19937 gen(17);
+        std::uniform_real_distribution<double> coord(-10.,10.);
+        std::vector<Point<Event,double,3> > points;
+        for (std::size_t i = 0; i < 300; ++i)
+        {
+            Event evt{i,coord(gen),coord(gen),coord(gen)};
+            points.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+        }
+
+        KDTree<Event,3,double,SquaredDist> tree(4,50);
+        tree.SetWindowSize(100);
+        REQUIRE(tree.GetWindowSize() == 100);
+        for (const auto &point : points)
+            REQUIRE(tree.AddPoint(point));
+
+        REQUIRE(tree.size() == 100);
+        for (std::size_t i = 0; i < points.size(); ++i)
+            CHECK((tree.FindNearest(points.at(i)).value() == points.at(i)) == (i >= 200));
+
+        tree.SetWindowSize(30); // the oldest points go right away
+        REQUIRE(tree.size() == 30);
+        REQUIRE(tree.FindNearest(points.at(269)).value() != points.at(269));
+        REQUIRE(tree.FindNearest(points.at(270)).value() == points.at(270));
+
+        tree.SetWindowSize(0);
+        REQUIRE(tree.AddPoint(points.front()));
+        REQUIRE(tree.size() == 31);
+
+        // the window follows its own points, even when an equal point is stored outside of it or one of its points is removed by hand
+        KDTree<Event,3,double,SquaredDist> windowTree(4,50);
+        Point<Event,double,3> seven = points.at(7);
+        REQUIRE(windowTree.AddPoint(seven));
+        windowTree.SetWindowSize(2);
+        REQUIRE(windowTree.RemovePoint(windowTree.AddPointWithHandle(seven)).has_value());
+        REQUIRE(windowTree.size() == 1);
+        const JJDataStruct::KDTree::PointHandle handle = windowTree.AddPointWithHandle(points.at(8));
+        REQUIRE(windowTree.AddPoint(points.at(9)));
+        REQUIRE(windowTree.size() == 3);
+        REQUIRE(windowTree.AddPoint(points.at(10))); // the window is full: the point 8 leaves, the point 7 stored before the window stays
+        REQUIRE(windowTree.size() == 3);
+        REQUIRE_FALSE(windowTree.IsValidHandle(handle));
+        REQUIRE(windowTree.FindNearest(seven).value() == seven);
+        REQUIRE(windowTree.FindNearest(points.at(8)).value() != points.at(8));
+    }
+
+    SECTION("Points are removed through their handles")
+    {
+        std::mt19937 gen(19);
+        std::uniform_real_distribution<double> coord(-10.,10.);
+        std::vector<Point<Event,double,3> > points;
+        for (std::size_t i = 0; i < 500; ++i)
+        {
+            Event evt{i,std::round(coord(gen)),coord(gen),coord(gen)}; // many points share the x coordinate
+            points.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+        }
+
+        // the handles have to follow the points through the splits of the growing tree
+        KDTree<Event,3,double,SquaredDist> tree(4);
+        std::vector<JJDataStruct::KDTree::PointHandle> handles;
+        for (const auto &point : points)
+            handles.push_back(tree.AddPointWithHandle(point));
+        REQUIRE(tree.IsSplit());
+        REQUIRE(tree.size() == points.size());
+
+        // removing every other point by handle, then through the points themselves (the handles of which become invalid)
+        for (std::size_t i = 0; i < points.size(); i += 2)
+            REQUIRE(tree.RemovePoint(handles.at(i)).value() == points.at(i));
+        for (std::size_t i = 1; i < points.size(); i += 4)
+            REQUIRE(tree.RemovePoint(points.at(i)).has_value());
+        REQUIRE(tree.size() == 125);
+
+        for (std::size_t i = 0; i < points.size(); ++i)
+        {
+            CHECK(tree.IsValidHandle(handles.at(i)) == (i % 4 == 3));
+            CHECK((tree.FindNearest(points.at(i)).value() == points.at(i)) == (i % 4 == 3));
+        }
+
+        // a stale handle stays invalid, even once its slot holds a new point
+        REQUIRE(tree.RemovePoint(handles.at(0)).has_value() == false);
+        const auto newHandle = tree.AddPointWithHandle(points.at(0));
+        REQUIRE(newHandle != handles.at(0));
+        REQUIRE(tree.RemovePoint(handles.at(0)).has_value() == false);
+
+        // the joins have to keep the handles of the remaining points
+        for (std::size_t i = 3; i < points.size(); i += 4)
+            REQUIRE(tree.RemovePoint(handles.at(i)).value() == points.at(i));
+        REQUIRE(tree.RemovePoint(newHandle).value() == points.at(0));
+        REQUIRE(tree.size() == 0);
+        REQUIRE(tree.GetNodes().GetNumberOfNodes() < 10);
+
+        // rebuilding the tree invalidates the handles
+        const auto handle = tree.AddPointWithHandle(points.at(1));
+        tree.BuildTree(points.begin(),points.end());
+        REQUIRE(tree.IsValidHandle(handle) == false);
+    }
+
+    SECTION("Tree rebalances itself when the points drift")
+    {
+        // the points arrive sorted along x, so all of them end up in the rightmost leaves of the first split
+        std::mt19937 gen(23);
+        std::uniform_real_distribution<double> coord(-10.,10.);
+        std::vector<Point<Event,double,3> > points;
+        for (std::size_t i = 0; i < 2000; ++i)
+        {
+            Event evt{i,static_cast<double>(i) / 100.,coord(gen),coord(gen)};
+            points.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+        }
+
+        auto maxDepth = [](const auto &nodes)
+        {
+            std::size_t depth = 0;
+            std::vector<std::uint32_t> stack = {nodes.GetRootIndex()};
+            while (!stack.empty())
+            {
+                const auto &node = nodes[stack.back()];
+                stack.pop_back();
+                depth = std::max(depth,node.GetDepth());
+                if (node.IsSplit())
+                {
+                    CHECK(node.GetSubtreeSize() == nodes[node.GetLeftIndex()].GetSubtreeSize() + nodes[node.GetRightIndex()].GetSubtreeSize());
+                    stack.push_back(node.GetLeftIndex());
+                    stack.push_back(node.GetRightIndex());
+                }
+                else
+                {
+                    CHECK(node.GetSubtreeSize() == node.size());
+                }
+            }
+            return depth;
+        };
+
+        KDTree<Event,3,double,SquaredDist> drifting(4,10), balanced(4,10);
+        balanced.SetBalanceFactor(0.7);
+        REQUIRE(balanced.GetBalanceFactor() == 0.7);
+        std::vector<JJDataStruct::KDTree::PointHandle> handles;
+        for (const auto &point : points)
+        {
+            REQUIRE(drifting.AddPoint(point));
+            handles.push_back(balanced.AddPointWithHandle(point));
+        }
+
+        REQUIRE(balanced.GetNodes()[0].GetSubtreeSize() == points.size());
+        REQUIRE(maxDepth(balanced.GetNodes()) <= 14);
+        REQUIRE(maxDepth(drifting.GetNodes()) > maxDepth(balanced.GetNodes()) + 5);
+
+        // removing the older half by handle and a few points by value keeps the tree balanced and the handles valid
+        for (std::size_t i = 0; i < 1000; ++i)
+            REQUIRE(balanced.RemovePoint(handles.at(i)).value() == points.at(i));
+        for (std::size_t i = 1000; i < 1100; ++i)
+            REQUIRE(balanced.RemovePoint(points.at(i)).has_value());
+
+        REQUIRE(balanced.GetNodes()[0].GetSubtreeSize() == 900);
+        REQUIRE(maxDepth(balanced.GetNodes()) <= 13);
+        for (std::size_t i = 1100; i < points.size(); ++i)
+        {
+            REQUIRE(balanced.IsValidHandle(handles.at(i)));
+            CHECK(balanced.FindNearest(points.at(i)).value() == points.at(i));
+        }
+    }
+
+    SECTION("Split policies give the same results")
+    {
+        // vertex-like points: spread along the beam axis (z) much more than across it
+        std::mt19937 gen(31);
+        std::normal_distribution<double> transverse(0.,0.5), longitudinal(0.,20.);
+        std::vector<Point<Event,double,3> > points, queries;
+        for (std::size_t i = 0; i < 3000; ++i)
+        {
+            Event evt{i,transverse(gen),transverse(gen),longitudinal(gen)};
+            (i < 2000 ? points : queries).push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+        }
+
+        auto checkTree = [&points,&queries](auto &tree)
+        {
+            // half of the points are added one by one after the build, so the policy also splits the full leaves
+            tree.BuildTree(points.begin(),points.begin() + 1000);
+            for (std::size_t i = 1000; i < points.size(); ++i)
+                REQUIRE(tree.AddPoint(points.at(i)));
+            REQUIRE(tree.size() == points.size());
+
+            for (const auto &query : queries)
+            {
+                auto byDistance = [&query](const Point<Event,double,3> &p1, const Point<Event,double,3> &p2){return SquaredDist::distance(p1,query) < SquaredDist::distance(p2,query);};
+                std::vector<Point<Event,double,3> > sorted(points.begin(),points.end());
+                std::partial_sort(sorted.begin(),sorted.begin() + 5,sorted.end(),byDistance);
+
+                CHECK(tree.FindNearest(query).value() == sorted.front());
+                auto nNearest = tree.FindNNearest(query,5);
+                CHECK(std::equal(nNearest.begin(),nNearest.end(),sorted.begin(),sorted.begin() + 5));
+                const auto nWithin = static_cast<std::size_t>(std::count_if(points.begin(),points.end(),[&query](const Point<Event,double,3> &point){return SquaredDist::distance(point,query) <= 1.;}));
+                CHECK(tree.FindWithinDistance(query,1.).size() == nWithin);
+            }
+            for (std::size_t i = 0; i < points.size(); i += 2)
+                REQUIRE(tree.RemovePoint(points.at(i)).has_value());
+            REQUIRE(tree.size() == points.size() / 2);
+        };
+
+        JJDataStruct::KDTree::KDTree<Event,3,double,SquaredDist,0,JJDataStruct::KDTree::CyclicMedianSplit> cyclic(8);
+        JJDataStruct::KDTree::KDTree<Event,3,double,SquaredDist,0,JJDataStruct::KDTree::MaxSpreadSplit> maxSpread(8);
+        JJDataStruct::KDTree::KDTree<Event,3,double,SquaredDist,0,JJDataStruct::KDTree::SlidingMidpointSplit> slidingMidpoint(8);
+        JJDataStruct::KDTree::KDTree<Event,3,double,SquaredDist,0,JJDataStruct::KDTree::SurfaceAreaSplit<> > surfaceArea(8);
+        checkTree(cyclic);
+        checkTree(maxSpread);
+        checkTree(slidingMidpoint);
+        checkTree(surfaceArea);
+
+        // the policies looking at the spread split the long axis first
+        REQUIRE(cyclic.GetNodes()[0].GetDimensionIndex() == 0);
+        REQUIRE(maxSpread.GetNodes()[0].GetDimensionIndex() == 2);
+        REQUIRE(slidingMidpoint.GetNodes()[0].GetDimensionIndex() == 2);
+        REQUIRE(surfaceArea.GetNodes()[0].GetDimensionIndex() == 2);
+    }
+
+    SECTION("Size and ranks follow the insertions and removals")
+    {
+        // integer coordinates, so many points lie exactly on the medians
+        std::mt19937 gen(37);
+        std::uniform_int_distribution<int> coord(0,19);
+        std::vector<Point<Event,double,3> > points;
+        for (std::size_t i = 0; i < 1500; ++i)
+        {
+            Event evt{i,static_cast<double>(coord(gen)),static_cast<double>(coord(gen)),static_cast<double>(coord(gen))};
+            points.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+        }
+
+        auto checkRanks = [](const auto &tree, const std::vector<Point<Event,double,3> > &stored)
+        {
+            REQUIRE(tree.size() == stored.size());
+            for (std::size_t dim = 0; dim < 3; ++dim)
+                for (double value = -1.; value <= 21.; value += 0.5)
+                {
+                    const auto expected = static_cast<std::size_t>(std::count_if(stored.begin(),stored.end(),[dim,value](const Point<Event,double,3> &point){return point.coords[dim] < value;}));
+                    CHECK(tree.CountBelow(dim,value) == expected);
+                }
+        };
+
+        KDTree<Event,3,double,SquaredDist> tree(4,100);
+        std::vector<Point<Event,double,3> > stored;
+        for (const auto &point : points)
+        {
+            REQUIRE(tree.AddPoint(point));
+            stored.push_back(point);
+            if (stored.size() == 50)
+                checkRanks(tree,stored);
+        }
+        REQUIRE(tree.IsSplit());
+        checkRanks(tree,stored);
+
+        for (std::size_t i = 0; i < points.size(); i += 3)
+            REQUIRE(tree.RemovePoint(points.at(i)).has_value());
+        stored.clear();
+        for (std::size_t i = 0; i < points.size(); ++i)
+            if (i % 3 != 0)
+                stored.push_back(points.at(i));
+        checkRanks(tree,stored);
+
+        REQUIRE_THROWS_AS(tree.CountBelow(3,0.),std::runtime_error);
+    }
+
+    SECTION("Box queries give the same results as checking every point")
+    {
+        // integer coordinates, so many points lie exactly on the medians and on the walls of the boxes
+        std::mt19937 gen(41);
+        std::uniform_int_distribution<int> coord(0,19);
+        std::vector<Point<Event,double,3> > points;
+        for (std::size_t i = 0; i < 2000; ++i)
+        {
+            Event evt{i,static_cast<double>(coord(gen)),static_cast<double>(coord(gen)),static_cast<double>(coord(gen))};
+            points.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+        }
+        const KDTree<Event,3,double,SquaredDist> tree(8,points.begin(),points.end());
+
+        for (std::size_t q = 0; q < 50; ++q)
+        {
+            std::array<double,3> lower, upper;
+            for (std::size_t dim = 0; dim < 3; ++dim)
+            {
+                const auto [low,high] = std::minmax(coord(gen),coord(gen));
+                lower[dim] = static_cast<double>(low);
+                upper[dim] = static_cast<double>(high);
+            }
+
+            std::vector<std::size_t> expected;
+            for (const auto &point : points)
+                if (std::equal(lower.begin(),lower.end(),point.coords.begin(),std::less_equal<double>()) && std::equal(point.coords.begin(),point.coords.end(),upper.begin(),std::less_equal<double>()))
+                    expected.push_back(point.object.id);
+
+            std::vector<std::size_t> found;
+            for (const auto &point : tree.FindInBox(lower,upper))
+                found.push_back(point.object.id);
+            std::sort(found.begin(),found.end());
+
+            CHECK(found == expected);
+            CHECK(tree.CountInBox(lower,upper) == expected.size());
+        }
+
+        REQUIRE(tree.CountInBox({-1.,-1.,-1.},{20.,20.,20.}) == points.size());
+        REQUIRE(tree.FindInBox({-1.,-1.,-1.},{20.,20.,20.}).size() == points.size());
+        REQUIRE(tree.CountInBox({5.,5.,5.},{4.,20.,20.}) == 0);
+    }
+
     // remove from split tree
 
     // pruning
@@ -140,4 +637,131 @@ TEST_CASE("KDTree class test","[kdtree][node][point][distance]")
     // find n nearest
 
     // find within distance
-}
\ No newline at end of file
+}
+
+// metric without regionDistance, the finders fall back to the largest axis distance seen so far
+struct ChebyshevDist
+{
+    template <typename T, std::size_t Dims>
+    static T distance(const std::array<T,Dims> &p1, const std::array<T,Dims> &p2) noexcept
+    {
+        T dist = 0;
+        for (std::size_t dim = 0; dim < Dims; ++dim)
+            dist = std::max(dist,axisDistance(p1[dim],p2[dim]));
+
+        return dist;
+    }
+    template <typename T>
+    static T axisDistance(T x1, T x2) noexcept
+    {
+        return (x1 > x2) ? x1 - x2 : x2 - x1;
+    }
+};
+
+TEMPLATE_TEST_CASE("Searching the tree gives the same results as checking every point","[kdtree][distance]",SquaredDist,RootSquaredDist,ChebyshevDist)
+{
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<double> coord(-10.,10.);
+    std::vector<Point<Event,double,3> > points;
+    for (std::size_t i = 0; i < 3000; ++i)
+    {
+        Event evt{i,coord(gen),coord(gen),coord(gen)};
+        points.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+    }
+
+    const KDTree<Event,3,double,TestType> tree(8,points.begin(),points.end());
+    for (std::size_t q = 0; q < 30; ++q)
+    {
+        // queries are also placed outside of the data, where the cells are the furthest away
+        Point<Event,double,3> query = {Event{10000 + q,0.,0.,0.},{3 * coord(gen),coord(gen),coord(gen)}};
+
+        std::vector<std::pair<double,std::size_t> > expected;
+        for (const auto &pt : points)
+            expected.emplace_back(TestType::distance(query.coords,pt.coords),pt.object.id);
+        std::sort(expected.begin(),expected.end());
+
+        auto nearest = tree.FindNearest(query);
+        REQUIRE(nearest.has_value());
+        CHECK(TestType::distance(query.coords,nearest.value().coords) == expected.front().first);
+
+        auto nNearest = tree.FindNNearest(query,10);
+        REQUIRE(nNearest.size() == 10);
+        for (std::size_t i = 0; i < nNearest.size(); ++i)
+            CHECK(TestType::distance(query.coords,nNearest.at(i).coords) == expected.at(i).first);
+
+        const double radius = expected.at(50).first;
+        auto within = tree.FindWithinDistance(query,radius);
+        const auto nWithin = static_cast<std::size_t>(std::count_if(expected.begin(),expected.end(),[radius](const auto &entry){return entry.first <= radius;}));
+        CHECK(within.size() == nWithin);
+        CHECK(tree.CountWithinDistance(query,radius) == nWithin);
+
+        std::size_t nVisited = 0;
+        tree.ForEachWithinDistance(query,radius,[&nVisited,radius](const Event &, const std::array<double,3> &, double dist)
+        {
+            ++nVisited;
+            CHECK(dist <= radius);
+        });
+        CHECK(nVisited == nWithin);
+
+        // approximate searches stay within (1 + epsilon) of the true distances, a budget of one leaf still finds something
+        JJDataStruct::KDTree::SearchOptions options;
+        options.epsilon = 0.5;
+        const double nearestDistance = TestType::distance(query.coords,tree.FindNearest(query,options).value().coords);
+        CHECK(nearestDistance <= JJDataStruct::KDTree::ScaleDistance<TestType>(expected.front().first,1.5));
+        auto approximate = tree.FindNNearest(query,10,options);
+        REQUIRE(approximate.size() == 10);
+        for (std::size_t i = 0; i < approximate.size(); ++i)
+            CHECK(TestType::distance(query.coords,approximate.at(i).coords) <= JJDataStruct::KDTree::ScaleDistance<TestType>(expected.at(i).first,1.5));
+
+        CHECK(tree.FindNNearest(query,10,JJDataStruct::KDTree::SearchOptions()) == nNearest);
+        options.epsilon = 0.;
+        options.maxLeaves = 1;
+        CHECK(tree.FindNearest(query,options).has_value());
+        CHECK_FALSE(tree.FindNNearest(query,10,options).empty());
+
+        // a large sphere holds whole cells, which are counted without visiting them
+        const double largeRadius = expected.at(2000).first;
+        const auto nLarge = static_cast<std::size_t>(std::count_if(expected.begin(),expected.end(),[largeRadius](const auto &entry){return entry.first <= largeRadius;}));
+        CHECK(tree.CountWithinDistance(query,largeRadius) == nLarge);
+    }
+}
+
+TEST_CASE("Points exactly at the search radius are found behind a split","[kdtree][distance]")
+{
+    // on a grid the splitting planes go through the points, so the far cells often lie exactly at the radius (a point lying on a median may even sit behind the split from itself)
+    std::vector<Point<Event,double,3> > points;
+    for (std::size_t i = 0; i < 16 * 16; ++i)
+    {
+        Event evt{i,static_cast<double>(i % 16),static_cast<double>(i / 16),0.};
+        points.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+    }
+
+    const KDTree<Event,3,double,SquaredDist> tree(4,points.begin(),points.end());
+    const JJDataStruct::KDTree::DistanceFinder<Event,double,3,SquaredDist> finder;
+    for (const auto &query : points)
+    {
+        for (double radius : {0.,1.,2.,4.,5.})
+        {
+            const auto nWithin = static_cast<std::size_t>(std::count_if(points.begin(),points.end(),[&query,radius](const auto &pt){return SquaredDist::distance(query,pt) <= radius;}));
+            CHECK(tree.FindWithinDistance(query,radius).size() == nWithin);
+            CHECK(finder.FindIf(tree.GetNodes(),tree.GetNodes().GetRootIndex(),query,radius,[](const auto&, const auto&){return true;}).size() == nWithin);
+        }
+    }
+}
+
+TEST_CASE("Points lying on a median are removed from either side of it","[kdtree][remove]")
+{
+    // many points share their coordinates, so the bulk build puts some of those equal to a median into the right child
+    std::vector<Point<Event,double,3> > points;
+    for (std::size_t i = 0; i < 400; ++i)
+    {
+        Event evt{i,static_cast<double>(i % 5),static_cast<double>(i % 7),static_cast<double>(i % 3)};
+        points.push_back({evt,{evt.Xvertex,evt.Yvertex,evt.Zvertex}});
+    }
+
+    KDTree<Event,3,double,SquaredDist> tree(4,points.begin(),points.end());
+    for (const auto &point : points)
+        REQUIRE(tree.RemovePoint(point).has_value());
+
+    REQUIRE(tree.size() == 0);
+}
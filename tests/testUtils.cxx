@@ -0,0 +1,81 @@
+#include "testsHeader.hxx"
+
+// =====================================================================================================
+// JJUtils tests
+// =====================================================================================================
+
+TEST_CASE("bounded_priority_queue class tests","[utils]")
+{
+    JJUtils::bounded_priority_queue<int> queue(3);
+
+    REQUIRE(queue.empty());
+    REQUIRE(queue.capacity() == 3);
+    REQUIRE_FALSE(queue.full());
+
+    SECTION("Queue keeps the smallest elements with the largest one at the top")
+    {
+        for (int value : {5,9,1,7,3,8})
+            queue.push(value);
+
+        REQUIRE(queue.full());
+        REQUIRE(queue.size() == 3);
+        REQUIRE(queue.top() == 5);
+
+        REQUIRE_FALSE(queue.push(6)); // larger than the top, so it is dropped
+        REQUIRE(queue.push(2));
+        REQUIRE(queue.top() == 3);
+
+        queue.sort();
+        REQUIRE(std::vector<int>(queue.begin(),queue.end()) == std::vector<int>{1,2,3});
+    }
+
+    SECTION("Reset changes the capacity and removes all elements")
+    {
+        queue.push(1);
+        queue.reset(1);
+
+        REQUIRE(queue.empty());
+        REQUIRE(queue.push(4));
+        REQUIRE(queue.push(2));
+        REQUIRE(queue.size() == 1);
+        REQUIRE(queue.top() == 2);
+    }
+
+    SECTION("Queue with zero capacity keeps nothing")
+    {
+        queue.reset(0);
+
+        REQUIRE_FALSE(queue.push(1));
+        REQUIRE(queue.empty());
+    }
+}
+
+TEST_CASE("fixed_size_deque class tests","[utils]")
+{
+    JJUtils::fixed_size_deque<int> deque(3);
+
+    REQUIRE(deque.empty());
+    REQUIRE(deque.max_size() == 3);
+
+    SECTION("Elements pushed over the max size push out the oldest ones")
+    {
+        for (int value : {1,2,3})
+            REQUIRE_FALSE(deque.push_back(value).has_value());
+
+        REQUIRE(deque.push_back(4) == std::optional<int>(1));
+        REQUIRE(deque.push_back(5) == std::optional<int>(2));
+        REQUIRE(deque.size() == 3);
+        REQUIRE(deque.front() == 3);
+        REQUIRE(std::vector<int>(deque.begin(),deque.end()) == std::vector<int>{3,4,5});
+    }
+
+    SECTION("Elements can be popped from the front")
+    {
+        deque.push_back(1);
+        deque.push_back(2);
+
+        REQUIRE(deque.pop_front() == 1);
+        REQUIRE(deque.size() == 1);
+        REQUIRE(deque.front() == 2);
+    }
+}
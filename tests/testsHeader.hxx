@@ -9,9 +9,22 @@
 
 template <typename Leaf, typename T, std::size_t Dims> using Point = JJDataStruct::KDTree::Point<Leaf,T,Dims>;
 template <typename Leaf, typename T, std::size_t Dims, typename Distance> using Node = JJDataStruct::KDTree::Node<Leaf,T,Dims,Distance>;
+template <typename Leaf, typename T, std::size_t Dims, typename Distance> using NodeArray = JJDataStruct::KDTree::NodeArray<Leaf,T,Dims,Distance>;
 template <typename Leaf, std::size_t Dims, typename T, typename Distance> using KDTree = JJDataStruct::KDTree::KDTree<Leaf,Dims,T,Distance>;
 using SquaredDist = JJDataStruct::KDTree::SquaredDist;
 using RootSquaredDist = JJDataStruct::KDTree::RootSquaredDist;
+using JJDataStruct::KDTree::InvalidIndex;
+
+// follows a path of 'L' and 'R' steps from the root node and returns the index of the node it ends at
+template <typename Nodes>
+std::uint32_t Descend(const Nodes &nodes, const std::string &path)
+{
+    std::uint32_t index = nodes.GetRootIndex();
+    for (char step : path)
+        index = (step == 'L') ? nodes[index].GetLeftIndex() : nodes[index].GetRightIndex();
+
+    return index;
+}
 
 struct Event
 {